@@ -9,11 +9,17 @@
 #include <DeepLearning/TrainParameters.h>
 #include <DeepLearning/PretrainParameters.h>
 #include <DeepLearning/Progress.h> // Progress tracking function
+#include <DeepLearning/MappedDataset.h> // Out-of-core datasets
+#include <DeepLearning/BatchSource.h>
 
 // Core DBN stuff
 #include <DeepLearning/Layer.h>
 #include <DeepLearning/RBM.h>
 #include <DeepLearning/DeepBeliefNet.h>
+#include <DeepLearning/CompactDeepBeliefNet.h> // 16 bits weights for inference
+#include <DeepLearning/PrunedDeepBeliefNet.h> // Sparse weights for inference
+#include <DeepLearning/QuantizedDeepBeliefNet.h> // 8 bits integer weights for inference
+#include <DeepLearning/MappedDeepBeliefNet.h> // Model files
 
 // Conversions from/to R
 #include <RcppEigen.h> // This is used for conversions in RcppExports.cpp
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <DeepLearning/MappedDataset.h>
+#include <DeepLearning/typedefs.h>
+
+
+namespace DeepLearning {
+	/** Where the batches of the pre-training and of the training are gathered from: data in memory (see DataRef), sparse data
+	 * (see SparseMatrixXs), whose batches are scattered into dense columns, or a MappedDataset read on demand. The samples of a MappedDataset can be passed through the RBMs of someLayersBelow as they are gathered,
+	 * so that the upper layers of a DBN are pre-trained without propagating the whole dataset.
+	 *
+	 * The source only keeps pointers to the data, the dataset and the RBMs: they must outlive it.
+	 * gather may be called from several threads at once.
+	 *
+	 * SamplingType is how the pre-training and the training draw the batches (see Random::setSampling): replacement draws each column at random,
+	 * epoch takes the batches in the order of a permutation of the samples drawn at each epoch, and shuffled does the same from a copy of
+	 * the data gathered in the order of the permutation, which requires a dense matrix in memory (see checkSampling).
+	 */
+	class BatchSource {
+		public:
+			enum SamplingType {replacement, epoch, shuffled};
+			static std::string SamplingTypeToString(SamplingType);
+			static SamplingType SamplingTypeFromString(std::string aString);
+			const static std::string invalid_sampling;
+
+		private:
+			const DataRef* data;
+			const SparseMatrixXs* sparseData;
+			const MappedDataset* dataset;
+			std::vector<const RBM*> layersBelow;
+
+		public:
+			BatchSource(const DataRef& someData): data(&someData), sparseData(nullptr), dataset(nullptr), layersBelow() {}
+			explicit BatchSource(const SparseMatrixXs& someData): data(nullptr), sparseData(&someData), dataset(nullptr), layersBelow() {}
+			explicit BatchSource(const MappedDataset& aDataset, const std::vector<const RBM*>& someLayersBelow = std::vector<const RBM*>()):
+				data(nullptr), sparseData(nullptr), dataset(&aDataset), layersBelow(someLayersBelow) {}
+
+			Eigen_size_type nSamples() const {return data ? data->cols() : sparseData ? sparseData->cols() : dataset->nSamples();}
+			/** Whether the samples are sparse: the pre-training then runs the products with the batch on its non-zeros */
+			bool isSparse() const {return sparseData != nullptr;}
+			/** Whether the samples are a dense matrix in memory: the shuffled sampling only copies those (see Random::setEpochs) */
+			bool isDense() const {return data != nullptr;}
+			/** Throws std::invalid_argument if the batches of this source can't be drawn with aSampling */
+			void checkSampling(SamplingType aSampling) const;
+
+			/** Copies the nColumns samples listed in columns to the columns of dest starting at firstColumn.
+			 * When data has the samples as rows (see samplesAsColumns), they are gathered one feature at a time,
+			 * so that the loads are independent and overlap rather than walking each strided sample in turn.
+			 */
+			void gather(const Eigen_size_type* columns, Eigen_size_type nColumns, MatrixXs& dest, Eigen_size_type firstColumn) const;
+	};
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <Eigen/Dense>
+
+#include <cstdint> // uint16_t
+#include <string>
+#include <vector>
+
+#include <DeepLearning/DeepBeliefNet.h>
+#include <DeepLearning/InferenceDeepBeliefNet.h>
+#include <DeepLearning/Layer.h>
+#include <DeepLearning/typedefs.h>
+#include <shared_array_ptr.h>
+
+
+namespace DeepLearning {
+	/** Class CompactDeepBeliefNet
+	 * An inference-only copy of a DeepBeliefNet (see InferenceDeepBeliefNet) where the weight matrices W are stored as 16 bits floating
+	 * point numbers (bfloat16 or IEEE 754 half precision) and the biases b and c stay in Scalar.
+	 * The weights are widened back to Scalar one block of columns at a time inside the matrix products, so the memory traffic of the
+	 * predictions is 2 bytes per weight instead of sizeof(Scalar).
+	 *
+	 * Storage: the W of all the RBMs are concatenated in a single array of 16 bits values, each in the same column-major
+	 * (output x input) layout as RBM::getW(). The biases are concatenated as b, c of the first RBM, then b, c of the second, etc.
+	 *
+	 * Constructors:
+	 *   - CompactDeepBeliefNet(const DeepBeliefNet& aDBN, WeightFormat aFormat) // converts the weights of aDBN
+	 *   - CompactDeepBeliefNet(layers, aFormat, someWeights, someBiases, isUnrolled) // existing 16 bits weights, not copied
+	 */
+	class CompactDeepBeliefNet: public InferenceDeepBeliefNet {
+		public:
+			enum WeightFormat {bfloat16, float16};
+
+		private:
+			WeightFormat myFormat;
+			shared_array_ptr<uint16_t> myWeights;
+			std::vector<size_t> myWeightOffsets; // where the W of each RBM starts in myWeights
+
+			void computeWeightOffsets();
+			void forwardsProductInPlace(size_t i, const MatrixXs& data, MatrixXs& activations) const;
+			void backwardsProductInPlace(size_t i, const MatrixXs& hidden, MatrixXs& activations) const;
+
+		public:
+			CompactDeepBeliefNet(const DeepBeliefNet& aDBN, WeightFormat aFormat);
+			CompactDeepBeliefNet(const std::vector<Layer>& layers, WeightFormat aFormat, const shared_array_ptr<uint16_t>& someWeights,
+			                     const std::vector<Scalar>& someBiases, bool isUnrolled);
+
+			/* Accessors */
+			WeightFormat getFormat() const {return myFormat;}
+			std::string getFormatAsString() const;
+			/** The 16 bits weights, as described in the class documentation */
+			shared_array_ptr<uint16_t> getWeights() const {return myWeights;}
+			/** The biases, as described in the class documentation */
+			std::vector<Scalar> getBiases() const;
+
+			/** Conversions between Scalar and the 16 bits formats. Narrowing rounds to nearest, ties to even.
+			 * Values out of the float16 range become infinite. bfloat16 has the same range as float.
+			 */
+			static uint16_t narrow(Scalar aValue, WeightFormat aFormat);
+			static Scalar widen(uint16_t aValue, WeightFormat aFormat);
+			static WeightFormat formatFromString(const std::string&);
+			static size_t computeWeightsSize(const std::vector<Layer>&);
+			static size_t computeBiasesSize(const std::vector<Layer>&);
+	};
+}
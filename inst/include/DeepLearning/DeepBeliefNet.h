@@ -2,6 +2,7 @@
 
 #include <Eigen/Dense>
 
+#include <cstdint> // uint64_t
 #include <vector>
 
 #include <DeepLearning/ContinueFunction.h>
@@ -15,13 +16,15 @@
 
 
 namespace DeepLearning {
+	class ThreadPool;
+	struct PartitionGradients;
 
 	/** Class DeepBeliefNet
 	 * Encodes a Deep Belief Network composed of a pointer to a the data (weights & biases) and a vector of RestrictedBolzmanMachines
 	 * 
 	 * Constructors:
 	 *   - DeepBeliefNet(const std::vector<Layer> &layers)
-	 *   - DeepBeliefNet(const std::vector<Layer> &layers, std::vector<double>& aData)
+	 *   - DeepBeliefNet(const std::vector<Layer> &layers, std::vector<Scalar>& aData)
 	 *   - DeepBeliefNet(const DeepBeliefNet& anOtherDeepBeliefNet) // copy constructor
 	 */
 	
@@ -29,7 +32,7 @@ namespace DeepLearning {
 		private:
 			std::vector<Layer> myLayers;
 			//size_t myDataSize;
-			shared_array_ptr<double> myData;
+			shared_array_ptr<Scalar> myData;
 			std::vector<RBM> myRBMs; // the Bolzman Machines
 			bool pretrained, unrolled, finetuned;
 	
@@ -38,25 +41,29 @@ namespace DeepLearning {
 				return computeDataSize(myLayers);
 			}*/
 			void constructRBMs();
+			/** Prints the layers skipped by pretrain */
+			static void printSkipped(const std::vector<size_t>& skip);
+			/** Pre-trains layer i from someData, unless it is in skip */
+			void pretrainLayer(size_t i, const BatchSource& someData, const PretrainParameters&, PretrainProgress&, ContinueFunction&, const std::vector<size_t>& skip);
 			//bool cleanUp = false; // CleanUp if we created *myData ourself - not by default, if it was provided at construction time
 	
 		public:
 			/** Constructs the RBMs as given by the Layers with the given data. Does not return the RBM but modifies it in place */
-			static void constructRBMs(std::vector<RBM>& someRBMs, const std::vector<Layer>& someLayers, const shared_array_ptr<double>& someData);
+			static void constructRBMs(std::vector<RBM>& someRBMs, const std::vector<Layer>& someLayers, const shared_array_ptr<Scalar>& someData);
 			/* Consructors */
 			explicit DeepBeliefNet(const std::vector<Layer> &layers): myLayers(layers), myData(computeDataSize(layers)), myRBMs(),
 			pretrained(false), unrolled(false), finetuned(false) {
 				//cleanUp = true;
 				constructRBMs();
 			}
-			DeepBeliefNet(const std::vector<Layer> &layers, std::vector<double>& aData, bool isAlreadyPretrained = false, 
+			DeepBeliefNet(const std::vector<Layer> &layers, std::vector<Scalar>& aData, bool isAlreadyPretrained = false, 
 			              bool isAlreadyUnrolled = false, bool isAlreadyFinetuned = false):
 				myLayers(layers), myData(aData), myRBMs(), pretrained(isAlreadyPretrained), unrolled(isAlreadyUnrolled),
 				finetuned(isAlreadyFinetuned) {
 				//cleanUp = false; // aData vector will do it anyway
 				constructRBMs();
 			}
-			DeepBeliefNet(const std::vector<Layer> &layers, shared_array_ptr<double>& aData, bool isAlreadyPretrained = false, 
+			DeepBeliefNet(const std::vector<Layer> &layers, shared_array_ptr<Scalar>& aData, bool isAlreadyPretrained = false, 
 			              bool isAlreadyUnrolled = false, bool isAlreadyFinetuned = false):
 				myLayers(layers), myData(aData), myRBMs(), pretrained(isAlreadyPretrained), unrolled(isAlreadyUnrolled), 
 				finetuned(isAlreadyFinetuned) {
@@ -75,40 +82,66 @@ namespace DeepLearning {
 			Layer getLayer(size_t aLayer) const {return myLayers[aLayer];}
 			std::vector<RBM> getRBMs() const {return myRBMs;}
 			RBM getRBM(size_t anRBM) const {return myRBMs[anRBM];}
-			shared_array_ptr<double> getData() const {return myData;}
+			shared_array_ptr<Scalar> getData() const {return myData;}
 			bool isPretrained() const {return pretrained;}
 			bool isUnrolled() const {return unrolled;}
 			bool isFinetuned() const {return finetuned;}
 			
 			/* Setters */
 			/** Apply the given data to the DBN. Assumes that the data is of the proper length - it cannot be specified here */
-			DeepBeliefNet& applyData(double*);
-			DeepBeliefNet& applyData(shared_array_ptr<double>& newData);
-			DeepBeliefNet& applyDataIfNeeded(double*);
-			DeepBeliefNet& applyDataIfNeeded(shared_array_ptr<double>& newData);
+			DeepBeliefNet& applyData(Scalar*);
+			DeepBeliefNet& applyData(shared_array_ptr<Scalar>& newData);
+			DeepBeliefNet& applyDataIfNeeded(Scalar*);
+			DeepBeliefNet& applyDataIfNeeded(shared_array_ptr<Scalar>& newData);
 		
 			/* Training the net */
 			/** pretrain and train the DBN
 			 * 
 			 * Modify the DBN in place and return a reference to it (so you can chain dbn.pretrain(...).train(...).)
-			 * @param someData an Eigen MatrixXd or Map<MatrixXd> representing the data
+			 * @param someData the data with the samples as columns, such as a MatrixXs, or as rows through samplesAsColumns.
+			 *        It is never copied: the batches are drawn from it in place, and the data of the next layers is propagated in the same layout
 			 * @param someParameters a PretrainParameters object
 			 * 
 			 */
-			//DeepBeliefNet& pretrain(const MatrixXdMap& someData, const PretrainParameters& someParameters);
-			DeepBeliefNet& pretrain(Eigen::MatrixXd someData, const std::vector<PretrainParameters>& someParameters, PretrainProgress& aProgressFunctor = NoOpPretrainProgress::getInstance(), ContinueFunction& aContinueFunction = ContinueFunction::getInstance(), const std::vector<size_t>& skip = std::vector<size_t>());
-			DeepBeliefNet& pretrainModifyingData(Eigen::MatrixXd& someData, const std::vector<PretrainParameters>& params, PretrainProgress& aProgressFunctor = NoOpPretrainProgress::getInstance(), ContinueFunction& aContinueFunction = ContinueFunction::getInstance(), const std::vector<size_t>& skip = std::vector<size_t>());
-			DeepBeliefNet& train(const Eigen::MatrixXd& someData, const TrainParameters&, TrainProgress& aProgressFunctor = NoOpTrainProgress::getInstance(), const ContinueFunction& aContinueFunction = ContinueFunction::getInstance());
+			//DeepBeliefNet& pretrain(const MatrixXsMap& someData, const PretrainParameters& someParameters);
+			DeepBeliefNet& pretrain(const DataRef& someData, const std::vector<PretrainParameters>& someParameters, PretrainProgress& aProgressFunctor = NoOpPretrainProgress::getInstance(), ContinueFunction& aContinueFunction = ContinueFunction::getInstance(), const std::vector<size_t>& skip = std::vector<size_t>());
+			/** Same, from a dataset read on demand: rather than propagating it, the batches of each layer are passed through the layers below as they are drawn.
+			 * This costs a forward pass of the layers below per batch, but no memory besides the batches.
+			 */
+			DeepBeliefNet& pretrain(const MappedDataset& aDataset, const std::vector<PretrainParameters>& someParameters, PretrainProgress& aProgressFunctor = NoOpPretrainProgress::getInstance(), ContinueFunction& aContinueFunction = ContinueFunction::getInstance(), const std::vector<size_t>& skip = std::vector<size_t>());
+			/** Same, from sparse data: the first layer is pre-trained on the non-zeros of the batches (see RBM::pretrain), and the data is propagated
+			 * to the next layers, whose activities are dense, as a MatrixXs.
+			 */
+			DeepBeliefNet& pretrain(const SparseMatrixXs& someData, const std::vector<PretrainParameters>& someParameters, PretrainProgress& aProgressFunctor = NoOpPretrainProgress::getInstance(), ContinueFunction& aContinueFunction = ContinueFunction::getInstance(), const std::vector<size_t>& skip = std::vector<size_t>());
+			DeepBeliefNet& train(const DataRef& someData, const TrainParameters&, TrainProgress& aProgressFunctor = NoOpTrainProgress::getInstance(), const ContinueFunction& aContinueFunction = ContinueFunction::getInstance());
+			/** Same, with the batches gathered from a BatchSource, such as a MappedDataset */
+			DeepBeliefNet& train(const BatchSource& someData, const TrainParameters&, TrainProgress& aProgressFunctor = NoOpTrainProgress::getInstance(), const ContinueFunction& aContinueFunction = ContinueFunction::getInstance());
+			/** Same, from sparse data, whose batches are scattered into dense columns: the unrolled network reconstructs all the inputs */
+			DeepBeliefNet& train(const SparseMatrixXs& someData, const TrainParameters&, TrainProgress& aProgressFunctor = NoOpTrainProgress::getInstance(), const ContinueFunction& aContinueFunction = ContinueFunction::getInstance());
 			
 			/** Returns the gradient of the DeepBeliefNet related with the provided data in a vector<RBM>
 			 * This gradient can be used for backpropagation or other puroposes
 			 */
-			std::vector<RBM> getGradient(const Eigen::MatrixXd& data, shared_array_ptr<double> df);
+			std::vector<RBM> getGradient(const MatrixXs& data, shared_array_ptr<Scalar> df);
 	
 			/** Computes the gradient of the DeepBeliefNet related with the provided data into gradientRBMs (vector<RBM>)
 			 * This gradient can be used for backpropagation or other puroposes.
 			 */
-			void getGradient(const Eigen::MatrixXd& data, std::vector<RBM>& gradientRBMs, double* f = nullptr);
+			void getGradient(const MatrixXs& data, std::vector<RBM>& gradientRBMs, double* f = nullptr);
+			/** Same as above, but the columns of data are split across the threads of the pool.
+			 * Each partition computes the gradient of its own columns, and the partial gradients are summed into gradientRBMs.
+			 */
+			void getGradient(const MatrixXs& data, std::vector<RBM>& gradientRBMs, ThreadPool& pool, double* f = nullptr);
+			/** Same, with the gradients of the partitions in buffers that are allocated at the first call and reused by the next ones */
+			void getGradient(const MatrixXs& data, std::vector<RBM>& gradientRBMs, ThreadPool& pool, PartitionGradients& buffers, double* f = nullptr);
+			/** The two halves of getGradient. forwards computes the activations (before the activity function) and the activities of all the layers
+			 * of the unrolled network, with activities[0] = data and the reconstructions in activities.back().
+			 * backwards backpropagates the error of the reconstructions of data from such a forward pass into gradientRBMs.
+			 */
+			void forwards(const MatrixXs& data, std::vector<MatrixXs>& activations, std::vector<MatrixXs>& activities) const;
+			void backwards(const MatrixXs& data, const std::vector<MatrixXs>& activations, const std::vector<MatrixXs>& activities, std::vector<RBM>& gradientRBMs) const;
+			/** errorSum(data), with the columns of data split across the threads of the pool */
+			double errorSum(const MatrixXs& data, ThreadPool& pool) const;
 	
 			/* Predictions & cie */
 			/** Computes the squared error of the reconstruction, per data point, and return it in a vector.
@@ -117,34 +150,41 @@ namespace DeepLearning {
 			 *  to get the reconstructions. This is done through the reconstruct() function.
 			 *  Note that if reconstructions is not supplied, it will be computed with the reconstruct() function.
 			 */
-			ArrayX1d error(const Eigen::MatrixXd&) const;
-			double errorSum(const Eigen::MatrixXd&) const;
-			ArrayX1d error(const Eigen::MatrixXd& data, const Eigen::MatrixXd& reconstructions) const;
-			double errorSum(const Eigen::MatrixXd& data, const Eigen::MatrixXd& reconstructions) const;
+			ArrayX1s error(const MatrixXs&) const;
+			double errorSum(const MatrixXs&) const;
+			ArrayX1s error(const MatrixXs& data, const MatrixXs& reconstructions) const;
+			double errorSum(const MatrixXs& data, const MatrixXs& reconstructions) const;
 			/** Computes the enery of the network, per data point, and return it in a vector 
 			 * energySum computes the sum of error over all data points and returns a single double.
 			 * energy() takes a copy of the argument and thus does not modify it
 			 */
-			ArrayX1d energy(Eigen::MatrixXd) const;
-			double energySum(const Eigen::MatrixXd&) const;
+			ArrayX1s energy(MatrixXs) const;
+			double energySum(const MatrixXs&) const;
 			/** Predicts the data points given in the matrix (in column).
 			* The versions that takes a matrix makes a copy of it first, and returns this copy. The *InPlace versions take operate on a reference to the object
 			* The reverse_* versions take a hidden layer and predicts the visible layer. 
 			* For an unrolled network, predict propagates through half of the network, and reverse_predict propagates through the other half.
 			*/
-			Eigen::MatrixXd predict(Eigen::MatrixXd) const;
-			void predictInPlace(Eigen::MatrixXd&) const;
-			Eigen::MatrixXd reverse_predict(Eigen::MatrixXd) const;
-			void reverse_predictInPlace(Eigen::MatrixXd&) const;
+			MatrixXs predict(MatrixXs) const;
+			void predictInPlace(MatrixXs&) const;
+			/** Predicts sparse data, with the first layer going through its non-zeros only */
+			MatrixXs predict(const SparseMatrixXs&) const;
+			MatrixXs reverse_predict(MatrixXs) const;
+			void reverse_predictInPlace(MatrixXs&) const;
+			/** Predicts samples given as rows (samples x features, as R stores them) into predictions (samples x outputs), without transposing anything */
+			void predictSamplesAsRows(const Eigen::Ref<const MatrixXs>& samples, MatrixXs& predictions) const;
 			/** Returns a reconstruction of the input data.
 			 * On an unrolled network this is exactly the same as predict() because the hidden layer is the reconstruction by definition.
 			 * On networks that haven't been unrolled, it is the result of predict() followed by reverse_predict.
 			 */
-			Eigen::MatrixXd reconstruct(Eigen::MatrixXd) const;
-			void reconstructInPlace(Eigen::MatrixXd&) const;
+			MatrixXs reconstruct(MatrixXs) const;
+			void reconstructInPlace(MatrixXs&) const;
 			/** Samples the input data into the hidden state */
-			Eigen::MatrixXd sample(Eigen::MatrixXd) const;
-			void sampleInPlace(Eigen::MatrixXd&) const;
+			MatrixXs sample(MatrixXs) const;
+			void sampleInPlace(MatrixXs&) const;
+			/** Reproducible sampling: the random numbers only depend on aSeed */
+			MatrixXs sample(MatrixXs, uint64_t aSeed) const;
+			void sampleInPlace(MatrixXs&, uint64_t aSeed) const;
 			
 			/* Architecture */
 			//void push_back(const RBM&);
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Eigen/Dense>
+
+#include <vector>
+
+#include <DeepLearning/Layer.h>
+#include <DeepLearning/typedefs.h>
+
+
+namespace DeepLearning {
+	/** Class InferenceDeepBeliefNet
+	 * Base of the inference-only copies of a DeepBeliefNet (CompactDeepBeliefNet, PrunedDeepBeliefNet, QuantizedDeepBeliefNet).
+	 * It holds the layers and the full precision biases, and goes through the layers for predict, reverse_predict and reconstruct,
+	 * with the same semantics as in DeepBeliefNet. Each model only implements the matrix products with its own storage of the weights.
+	 */
+	class InferenceDeepBeliefNet {
+		protected:
+			std::vector<Layer> myLayers;
+			std::vector<ArrayX1s> myB, myC;
+			bool unrolled;
+
+			InferenceDeepBeliefNet(const std::vector<Layer>& layers, bool isUnrolled): myLayers(layers), myB(), myC(), unrolled(isUnrolled) {}
+
+			/** Computes the product W * data of RBM i into activations. The bias c is added with the activities, by RBM::biasAndActivitiesInPlace */
+			virtual void forwardsProductInPlace(size_t i, const MatrixXs& data, MatrixXs& activations) const = 0;
+			/** Computes the product W^T * hidden of RBM i into activations. The bias b is added with the activities.
+			 * Never called on unrolled networks, which only go forwards.
+			 */
+			virtual void backwardsProductInPlace(size_t i, const MatrixXs& hidden, MatrixXs& activations) const = 0;
+
+		public:
+			virtual ~InferenceDeepBeliefNet() {}
+
+			/* Accessors */
+			size_t nLayers() const {return myLayers.size();}
+			size_t nRBMs() const {return myLayers.size() - 1;}
+			std::vector<Layer> getLayers() const {return myLayers;}
+			bool isUnrolled() const {return unrolled;}
+
+			/** Predictions, with the same semantics as in DeepBeliefNet */
+			MatrixXs predict(MatrixXs) const;
+			void predictInPlace(MatrixXs&) const;
+			MatrixXs reverse_predict(MatrixXs) const;
+			void reverse_predictInPlace(MatrixXs&) const;
+			MatrixXs reconstruct(MatrixXs) const;
+			void reconstructInPlace(MatrixXs&) const;
+	};
+}
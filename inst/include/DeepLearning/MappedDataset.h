@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef> // std::size_t
+#include <string>
+
+#include <DeepLearning/MappedFile.h>
+#include <DeepLearning/typedefs.h>
+
+
+namespace DeepLearning {
+	/** A dataset read on demand from a memory-mapped binary file, for datasets larger than the memory.
+	 *
+	 * The file holds nSamples samples of nFeatures values of one element type (double, float or 8 bits unsigned integers) in the native byte order,
+	 * after a header of anOffset bytes that is skipped. With samplesAsRows = false the values of each sample are contiguous (a column-major
+	 * features x samples matrix, or a row-major samples x features one as written by C or numpy); with samplesAsRows = true each feature is contiguous,
+	 * as R stores a samples x features matrix. The first layout is the one to prefer: a sample is then read from a single page of the file.
+	 *
+	 * Nothing is read upon construction. gather converts the requested samples to Scalar, multiplied by scale (1 / 255 maps bytes to [0, 1]),
+	 * and the operating system pages the file in and out as needed. The mapping is read-only and can be shared by several threads.
+	 * Copy and assignment are forbidden, the dataset owns its mapping (see MappedFile).
+	 */
+	class MappedDataset {
+		public:
+			enum ElementType {float64, float32, uint8};
+			static std::string ElementTypeToString(ElementType);
+			static ElementType ElementTypeFromString(const std::string& aString);
+			static size_t elementSize(ElementType);
+
+			MappedDataset(const std::string& aPath, Eigen_size_type aNFeatures, Eigen_size_type aNSamples, ElementType aType,
+				bool aSamplesAsRows = false, double aScale = 1, size_t anOffset = 0);
+			MappedDataset(const MappedDataset&) = delete;
+			MappedDataset& operator=(const MappedDataset&) = delete;
+
+			Eigen_size_type nFeatures() const {return myNFeatures;}
+			Eigen_size_type nSamples() const {return myNSamples;}
+			ElementType getType() const {return type;}
+			const std::string& getPath() const {return file.getPath();}
+
+			/** Copies the nColumns samples listed in columns to the columns of dest starting at firstColumn. dest must have nFeatures rows */
+			void gather(const Eigen_size_type* columns, Eigen_size_type nColumns, MatrixXs& dest, Eigen_size_type firstColumn) const;
+
+		private:
+			const MappedFile file;
+			const Eigen_size_type myNFeatures, myNSamples;
+			const ElementType type;
+			const bool samplesAsRows;
+			const Scalar scale;
+			const unsigned char* values; // the file after the offset
+
+			template <typename T> void gatherAs(const Eigen_size_type* columns, Eigen_size_type nColumns, MatrixXs& dest, Eigen_size_type firstColumn) const;
+	};
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint> // uint32_t, uint64_t
+#include <memory> // std::unique_ptr
+#include <string>
+
+#include <DeepLearning/DeepBeliefNet.h>
+#include <DeepLearning/MappedFile.h>
+#include <DeepLearning/typedefs.h>
+
+
+namespace DeepLearning {
+	/** Class MappedDeepBeliefNet
+	 * A DeepBeliefNet whose weights are read from a model file written by write(), memory-mapped rather than loaded: opening a model
+	 * only reads its header, whatever its size, and the weights are shared read-only with the other processes mapping the same file.
+	 *
+	 * File format, version 1, in the native byte order (all the integers are unsigned):
+	 *   - header: 8 bytes magic "DLDBN\0\0\0", 4 bytes version, 4 bytes byte order mark 0x01020304, 4 bytes sizeof(Scalar) of the weights (4 or 8),
+	 *     4 bytes flags (1: pretrained, 2: unrolled, 4: finetuned), then 8 bytes each: number of layers, number of weights, offset of the weights in bytes.
+	 *   - the layers: 4 bytes size and 4 bytes type (Layer::Type: 0 binary, 1 gaussian, 2 continuous) each.
+	 *   - the RBMs: 4 x 8 bytes each, the offsets of b, W, c and of the end of the RBM in the weights (as in RBM::computeOffsets, but counted from the first weight).
+	 *   - the weights of DeepBeliefNet::getData(), at an offset aligned on 64 bytes.
+	 *
+	 * When the file holds weights of another precision than Scalar (see DEEPLEARNING_FLOAT) they are converted into memory instead.
+	 * The DeepBeliefNet points into the mapping and is only valid as long as this object: clone() it to keep or modify it.
+	 * Copy and assignment are forbidden, the object owns its mapping.
+	 */
+	class MappedDeepBeliefNet {
+		public:
+			static const uint32_t version = 1;
+
+			/** Maps the model in aPath. Throws std::invalid_argument if the file is not a valid model */
+			explicit MappedDeepBeliefNet(const std::string& aPath);
+			MappedDeepBeliefNet(const MappedDeepBeliefNet&) = delete;
+			MappedDeepBeliefNet& operator=(const MappedDeepBeliefNet&) = delete;
+
+			const DeepBeliefNet& getDeepBeliefNet() const {return *dbn;}
+			/** false if the weights were converted to Scalar rather than mapped */
+			bool isMapped() const {return mapped;}
+			const std::string& getPath() const {return file.getPath();}
+
+			/** Writes aDBN to aPath in the format above. The file is replaced at once, so that it can be overwritten while other processes map it.
+			 * Throws std::runtime_error if the file cannot be written */
+			static void write(const DeepBeliefNet& aDBN, const std::string& aPath);
+
+		private:
+			const MappedFile file;
+			std::unique_ptr<DeepBeliefNet> dbn;
+			bool mapped;
+	};
+}
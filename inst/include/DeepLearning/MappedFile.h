@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef> // std::size_t
+#include <string>
+
+
+namespace DeepLearning {
+	/** A read-only memory mapping of a whole file.
+	 *
+	 * Nothing is read upon construction: the operating system pages the file in as it is accessed, and the pages are shared with
+	 * the other processes mapping the same file. With randomAccess the system is told not to read ahead, for files accessed in scattered places.
+	 * Throws std::runtime_error if the file cannot be opened or mapped, and std::invalid_argument if it is empty.
+	 * Copy and assignment are forbidden, the object owns its mapping.
+	 */
+	class MappedFile {
+		public:
+			explicit MappedFile(const std::string& aPath, bool randomAccess = false);
+			MappedFile(const MappedFile&) = delete;
+			MappedFile& operator=(const MappedFile&) = delete;
+			~MappedFile();
+
+			const unsigned char* data() const {return static_cast<const unsigned char*>(view);}
+			size_t size() const {return viewLength;}
+			const std::string& getPath() const {return path;}
+
+		private:
+			const std::string path;
+			void* view;
+			size_t viewLength;
+	};
+}
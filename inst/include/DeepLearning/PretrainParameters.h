@@ -1,9 +1,13 @@
 #pragma once 
 
+#include <cstdint> // uint64_t
 #include <stdexcept>
 #include <string> 
 #include <vector>
 
+#include <DeepLearning/BatchSource.h> // SamplingType
+#include <DeepLearning/utils.h> // randomSeed
+
 
 namespace DeepLearning {
 	/**
@@ -17,6 +21,32 @@ namespace DeepLearning {
 	 *   - unsigned int nProcs: default 0 (special Eigen value = no parallel execution)
 	 *	 - enum penalization {l1, l2}: default l1;
 	 *   - bool trainB, trainC: default TRUE;
+	 *   - enum parallelization {sequential, hogwild, synchronous}: default sequential;
+	 *     hogwild runs nbThreads contrastive divergence loops drawing their own batches and updating the weights concurrently without locks.
+	 *     synchronous splits each batch in shards of shardSize columns processed by nbThreads threads, bit-identical whatever nbThreads.
+	 *   - size_t shardSize: default 64;
+	 *   - bool persistent: default false; persistent contrastive divergence (Tieleman, 2008): the negative phase continues a set of
+	 *     fantasy chains kept from one iteration to the next, instead of restarting from the batch at each iteration;
+	 *   - unsigned int gibbsSteps: default 1; the number of Gibbs steps of the negative phase (CD-k);
+	 *   - bool meanFieldLastStep: default false; reconstruct the visible layer of the last Gibbs step from the probabilities of the hidden
+	 *     layer rather than from a sample of it (except when it starts from the persistent chains, whose state is always a sample);
+	 *   - enum optimizer {sgd, adagrad, rmsprop, adam}: default sgd; how the gradients are turned into steps. sgd scales them by epsilon*,
+	 *     adagrad (Duchi, Hazan and Singer, 2011) and rmsprop (Tieleman and Hinton, 2012) divide them by the root of the sum or of the moving average
+	 *     of their squares, element-wise. adam (Kingma and Ba, 2015) uses moving averages of the gradients and of their squares, and ignores the momentums.
+	 *     The learning rates epsilon* still apply, but they bound the size of the steps rather than scale the gradients;
+	 *   - double beta1, beta2: default 0.9 and 0.999; the decay of the moving averages of the gradients (adam) and of their squares (rmsprop and adam);
+	 *   - double optimizerEpsilon: default 1e-8; added to the root of the squares to avoid divisions by 0;
+	 *   - bool nesterov: default false; use Nesterov's accelerated gradient rather than the classical momentum (see momentums below);
+	 *   - uint64_t seed: default a random one; the key of the random number generators. Together with the layer, the iteration and
+	 *     the shard, it fully defines the batches and samples drawn: a sequential or synchronous pre-training with a given seed is reproducible,
+	 *     and so are the random numbers drawn in hogwild mode (but not the order of the updates);
+	 *   - size_t layer: default 0; the layer of the RBM in its DBN. Set by DeepBeliefNet::pretrain so the layers draw different numbers from the same seed.
+	 *   - BatchSource::SamplingType sampling {replacement, epoch, shuffled}: default replacement; how the batches are drawn. replacement draws each column at random.
+	 *     epoch permutes the samples once per epoch and takes the batches in the order of the permutation, so each sample is seen once per epoch.
+	 *     shuffled does the same from a copy of the data shuffled at each epoch, whose batches are contiguous columns: it reads the data in order,
+	 *     at the cost of the copy, shared by the hogwild threads. epoch and shuffled draw the same batches. shuffled requires dense data in memory.
+	 *   - bool prefetch: default true; assemble the next batch in a background thread during the current iteration (sequential and synchronous modes).
+	 *     The batches are the same either way.
 	 * 
 	 * All members can be set directly or trough the set* functions.
 	 * Note the convenience functions setLambda and setEpsilon that will set all 
@@ -32,6 +62,8 @@ namespace DeepLearning {
 	 *   - a valid momentums vector of size maxIters can be accessed with getValidMomentums()
 	 *   - invalid momentums might be set, and could prevent getValidMomentums() from working later (this is because momentums / maxIters might be set separately)
 	 *   - use validate() to ensure the structure is correct, or better ensureValidity() just after setting momentums or maxIters.
+	 *   - the increments of b, c and W are velocities: increment = momentum * increment + epsilon * gradient. The weights move by the increment,
+	 *     or with nesterov by the look-ahead momentum * increment + epsilon * gradient. A momentum of 0 is plain stochastic gradient ascent.
 	 */
 	
 	struct PretrainParameters {
@@ -46,6 +78,24 @@ namespace DeepLearning {
 		static std::string PenalizationTypeToString(PenalizationType);
 		static PenalizationType PenalizationTypeFromString(std::string aString);
 		bool trainB, trainC;
+		enum ParallelizationType {sequential, hogwild, synchronous};
+		ParallelizationType parallelization;
+		size_t shardSize;
+		bool persistent;
+		unsigned int gibbsSteps;
+		bool meanFieldLastStep;
+		bool nesterov;
+		enum OptimizerType {sgd, adagrad, rmsprop, adam};
+		OptimizerType optimizer;
+		double beta1, beta2, optimizerEpsilon;
+		uint64_t seed;
+		size_t layer;
+		BatchSource::SamplingType sampling;
+		bool prefetch;
+		static std::string ParallelizationTypeToString(ParallelizationType);
+		static ParallelizationType ParallelizationTypeFromString(std::string aString);
+		static std::string OptimizerTypeToString(OptimizerType);
+		static OptimizerType OptimizerTypeFromString(std::string aString);
 		
 		PretrainParameters& setLambda(double newLambda) {lambdaB = lambdaC = lambdaW = newLambda; return *this;}
 		PretrainParameters& setLambdaB(double newLambdaB) {lambdaB = newLambdaB; return *this;}
@@ -66,6 +116,32 @@ namespace DeepLearning {
 			penalization = PenalizationTypeFromString(newPenalization);
 			return *this;
 		}
+		PretrainParameters& setShardSize(size_t newShardSize) {shardSize = newShardSize; return *this;}
+		PretrainParameters& setPersistent(bool newPersistent) {persistent = newPersistent; return *this;}
+		PretrainParameters& setGibbsSteps(unsigned int newGibbsSteps) {gibbsSteps = newGibbsSteps; return *this;}
+		PretrainParameters& setMeanFieldLastStep(bool newMeanFieldLastStep) {meanFieldLastStep = newMeanFieldLastStep; return *this;}
+		PretrainParameters& setNesterov(bool newNesterov) {nesterov = newNesterov; return *this;}
+		PretrainParameters& setOptimizer(OptimizerType newOptimizer) {optimizer = newOptimizer; return *this;}
+		PretrainParameters& setOptimizer(std::string newOptimizer) {
+			optimizer = OptimizerTypeFromString(newOptimizer);
+			return *this;
+		}
+		PretrainParameters& setBeta1(double newBeta1) {beta1 = newBeta1; return *this;}
+		PretrainParameters& setBeta2(double newBeta2) {beta2 = newBeta2; return *this;}
+		PretrainParameters& setOptimizerEpsilon(double newOptimizerEpsilon) {optimizerEpsilon = newOptimizerEpsilon; return *this;}
+		PretrainParameters& setSeed(uint64_t newSeed) {seed = newSeed; return *this;}
+		PretrainParameters& setLayer(size_t newLayer) {layer = newLayer; return *this;}
+		PretrainParameters& setSampling(BatchSource::SamplingType newSampling) {sampling = newSampling; return *this;}
+		PretrainParameters& setSampling(std::string newSampling) {
+			sampling = BatchSource::SamplingTypeFromString(newSampling);
+			return *this;
+		}
+		PretrainParameters& setPrefetch(bool newPrefetch) {prefetch = newPrefetch; return *this;}
+		PretrainParameters& setParallelization(ParallelizationType newParallelization) {parallelization = newParallelization; return *this;}
+		PretrainParameters& setParallelization(std::string newParallelization) {
+			parallelization = ParallelizationTypeFromString(newParallelization);
+			return *this;
+		}
 		PretrainParameters& setMomentum(double newMomentum) {momentums.clear(); momentums.push_back(newMomentum); return *this;}
 		PretrainParameters& setMomentum(std::vector<double> newMomentums) {momentums =newMomentums; return *this;}
 		void ensureValidity() const {
@@ -91,7 +167,7 @@ namespace DeepLearning {
 		PretrainParameters() : lambdaB(0.0), lambdaC(0.0), lambdaW(0.0), 
 							epsilonB(0.001)	, epsilonC(0.001), epsilonW(0.001), momentums(1, 0.0),
 							minIters(100), maxIters(100), batchSize(100), nbThreads(0), penalization(l1),
-							trainB(true), trainC(true) {}
+							trainB(true), trainC(true), parallelization(sequential), shardSize(64), persistent(false), gibbsSteps(1), meanFieldLastStep(false), nesterov(false), optimizer(sgd), beta1(0.9), beta2(0.999), optimizerEpsilon(1e-8), seed(randomSeed()), layer(0), sampling(BatchSource::replacement), prefetch(true) {}
 		
 		private:
 			std::vector<double> getMomentumsFromLengthTwo(const std::vector<double>& someMomentums) const {
@@ -107,5 +183,7 @@ namespace DeepLearning {
 			}
 			const static std::string invalid_momentums;
 			const static std::string invalid_penalization;
+			const static std::string invalid_parallelization;
+			const static std::string invalid_optimizer;
 	};
 }
@@ -17,31 +17,31 @@ namespace DeepLearning {
 	 * 
 	 *
 	 * In PretrainProgress, the following members must be implemented:
-	 * - virtual void operator()(const RBM&, const Eigen::MatrixXd& b, const unsigned int i); // b = batch; i = batch number
+	 * - virtual void operator()(const RBM&, const MatrixXs& b, const unsigned int i); // b = batch; i = batch number
 	 * - virtual void setLayer(const size_t); // Keep track of the layer when pre-training a DBN
 	 * - virtual void setBatchSize(const size_t); // Keep track of the batch size
 	 * - virtual void setMaxIters(const unsigned int); // Keep track of the layer max # iterations
-	 * - virtual void setData(const Eigen::MatrixXd&); // Test dataset
+	 * - virtual void setData(const MatrixXs&); // Test dataset
 	 * - virtual void propagateData(const RBM&); // When a layer is trained, this function is called and updates the test data so that it can be used in the next layer
 	 * - virtual void setFunction(const pretrainDiagFunctionType&); // a function to evaluate
 	 * - virtual void reset(); // restarts the counter if any
 	 * 
 	 * In TrainProgress:
-	 * - virtual void operator()(const DeepBeliefNet&, const Eigen::MatrixXd& b, const unsigned int i); // b = batch; i = batch number
+	 * - virtual void operator()(const DeepBeliefNet&, const MatrixXs& b, const unsigned int i); // b = batch; i = batch number
 	 * - virtual void setBatchSize(const size_t); // Keep track of the batch size
 	 * - virtual void setMaxIters(const unsigned int); // Keep track of the layer max # iterations
-	 * - virtual void setData(const Eigen::MatrixXd&); // Test dataset
+	 * - virtual void setData(const MatrixXs&); // Test dataset
 	 * - virtual void setFunction(const trainDiagFunctionType&); // a function to evaluate
 	 * - virtual void reset(); // restarts the counter if any
 	 */
 	                                                 
 	class PretrainProgress {
 		public:
-	    virtual void operator()(const RBM&, const Eigen::MatrixXd&, const unsigned int) = 0;
+	    virtual void operator()(const RBM&, const MatrixXs&, const unsigned int) = 0;
 	    virtual void setLayer(const size_t) = 0;
 	    virtual void setBatchSize(const size_t) = 0;
 	    virtual void setMaxIters(const unsigned int) = 0;
-	    virtual void setData(const Eigen::MatrixXd&) = 0;
+	    virtual void setData(const MatrixXs&) = 0;
 	    virtual void setFunction(const pretrainDiagFunctionType&) = 0;
 	    virtual void propagateData(const RBM&) = 0; 
 	    virtual void reset() = 0;
@@ -51,10 +51,10 @@ namespace DeepLearning {
 	
 	class TrainProgress {
 		public:
-	    virtual void operator()(const DeepBeliefNet&, const Eigen::MatrixXd&, const unsigned int) = 0;
+	    virtual void operator()(const DeepBeliefNet&, const MatrixXs&, const unsigned int) = 0;
 	    virtual void setBatchSize(const size_t) = 0;
 	    virtual void setMaxIters(const unsigned int) = 0;
-	    virtual void setData(const Eigen::MatrixXd&) = 0;
+	    virtual void setData(const MatrixXs&) = 0;
 	    virtual void setFunction(const trainDiagFunctionType&) = 0;
 	    virtual void reset() = 0;
 	    virtual ~TrainProgress() = 0;
@@ -67,11 +67,11 @@ namespace DeepLearning {
 	
 	class NoOpPretrainProgress: public PretrainProgress {
 		public:
-	    void operator()(const RBM&, const Eigen::MatrixXd&, const unsigned int) {return;}
+	    void operator()(const RBM&, const MatrixXs&, const unsigned int) {return;}
 	    void setLayer(const size_t) {return;}
 	    void setBatchSize(const size_t) {return;}
 	    void setMaxIters(const unsigned int) {return;}
-	    void setData(const Eigen::MatrixXd&) {return;}
+	    void setData(const MatrixXs&) {return;}
 	    void propagateData(const RBM&) {return;}
 	    void setFunction(const pretrainDiagFunctionType&) {return;}
 	    void reset() {return;}
@@ -83,10 +83,10 @@ namespace DeepLearning {
 	
 	class NoOpTrainProgress: public TrainProgress {
 		public:
-	    void operator()(const DeepBeliefNet&, const Eigen::MatrixXd&, const unsigned int) {return;}
+	    void operator()(const DeepBeliefNet&, const MatrixXs&, const unsigned int) {return;}
 	    void setBatchSize(const size_t) {return;}
 	    void setMaxIters(const unsigned int) {return;}
-	    void setData(const Eigen::MatrixXd&) {return;}
+	    void setData(const MatrixXs&) {return;}
 	    void setFunction(const trainDiagFunctionType&) {return;}
 	    void reset() {return;}
 	    static NoOpTrainProgress& getInstance() {
@@ -103,12 +103,12 @@ namespace DeepLearning {
 		double storeImage;
 		unsigned int maxIters;
 		size_t currentLayer, batchSize;
-		Eigen::MatrixXd testData;
+		MatrixXs testData;
 		pretrainDiagFunctionType function;
 		constexpr static double InitialStoreImage = 1; // initialize storeImage to 1
 		
 		public:	
-	    void operator()(const RBM& anRBM, const Eigen::MatrixXd& aBatch, const unsigned int iter) {
+	    void operator()(const RBM& anRBM, const MatrixXs& aBatch, const unsigned int iter) {
 	    	if (storeImage >= 1 || iter == maxIters || iter == 0) {
 	    		function(anRBM, aBatch, testData, iter, batchSize, maxIters, currentLayer);
 	    		storeImage = 100.0 / iter;
@@ -116,7 +116,7 @@ namespace DeepLearning {
 	    	storeImage += 100.0 / iter;
 	    }
 	    void setLayer(const size_t aLayer) {currentLayer = aLayer;}
-	    void setData(const Eigen::MatrixXd& aTestData) {testData = aTestData;}
+	    void setData(const MatrixXs& aTestData) {testData = aTestData;}
 	    void propagateData(const RBM& anRBM);
 	    void setBatchSize(const size_t aBatchSize) {batchSize = aBatchSize;}
 	    void setMaxIters(const unsigned int aMaxIters) {maxIters = aMaxIters;}
@@ -129,20 +129,20 @@ namespace DeepLearning {
 		double storeImage;
 		unsigned int maxIters;
 		size_t batchSize;
-		Eigen::MatrixXd testData;
+		MatrixXs testData;
 		trainDiagFunctionType function;
 		constexpr static double InitialStoreImage = 1; // initialize storeImage to 1
 		//AccelerateTrainProgress(AccelerateTrainProgress&) = delete;
 		
 		public:	
-	    void operator()(const DeepBeliefNet& aDBN, const Eigen::MatrixXd &aBatch, unsigned int iter) {
+	    void operator()(const DeepBeliefNet& aDBN, const MatrixXs &aBatch, unsigned int iter) {
 	    	if (storeImage >= 1 || iter == maxIters || iter == 0) {
 	    		function(aDBN, aBatch, testData, iter, batchSize, maxIters);
 	    		storeImage = 100.0 / iter;
 	    	}
 	    	storeImage += 100.0 / iter;
 	    }
-	    void setData(const Eigen::MatrixXd& aTestData) {testData = aTestData;}
+	    void setData(const MatrixXs& aTestData) {testData = aTestData;}
 	    void setBatchSize(const size_t aBatchSize) {batchSize = aBatchSize;}
 	    void setMaxIters(const unsigned int aMaxIters) {maxIters = aMaxIters;}
 	    void setFunction(const trainDiagFunctionType& aFunction) {function = aFunction;}
@@ -156,18 +156,18 @@ namespace DeepLearning {
 		private:
 		unsigned int maxIters;
 		size_t currentLayer, batchSize;
-		Eigen::MatrixXd testData;
+		MatrixXs testData;
 		pretrainDiagFunctionType function;
 		
 		public:
-		void operator()(const RBM& anRBM, const Eigen::MatrixXd& aBatch, const unsigned int iter) {
+		void operator()(const RBM& anRBM, const MatrixXs& aBatch, const unsigned int iter) {
 	    	function(anRBM, aBatch, testData, iter, batchSize, maxIters, currentLayer);
 	    }
 	    
 	    void setLayer(const size_t aLayer) {currentLayer = aLayer;}
 	    void setBatchSize(const size_t aBatchSize) {batchSize = aBatchSize;}
 	    void setMaxIters(const unsigned int aMaxIters) {maxIters = aMaxIters;}
-	    void setData(const Eigen::MatrixXd& aTestData) {testData = aTestData;}
+	    void setData(const MatrixXs& aTestData) {testData = aTestData;}
 	    void propagateData(const RBM& anRBM);
 	    void setFunction(const pretrainDiagFunctionType& aFunction) {function = aFunction;}
 	    void reset() {return;}
@@ -177,16 +177,16 @@ namespace DeepLearning {
 		private:
 		unsigned int maxIters;
 		size_t batchSize;
-		Eigen::MatrixXd testData;
+		MatrixXs testData;
 		trainDiagFunctionType function;
 	
 		public:
-	    void operator()(const DeepBeliefNet& aDBN, const Eigen::MatrixXd &aBatch, unsigned int iter) {
+	    void operator()(const DeepBeliefNet& aDBN, const MatrixXs &aBatch, unsigned int iter) {
 	    	function(aDBN, aBatch, testData, iter, batchSize, maxIters);
 	    }
 	    void setBatchSize(const size_t aBatchSize) {batchSize = aBatchSize;}
 	    void setMaxIters(const unsigned int aMaxIters) {maxIters = aMaxIters;}
-	    void setData(const Eigen::MatrixXd& aTestData) {testData = aTestData;}
+	    void setData(const MatrixXs& aTestData) {testData = aTestData;}
 	    void setFunction(const trainDiagFunctionType& aFunction) {function = aFunction;}
 	    void reset() {return;}
 	};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Eigen/Dense>
+
+#include <vector>
+
+#include <DeepLearning/DeepBeliefNet.h>
+#include <DeepLearning/InferenceDeepBeliefNet.h>
+#include <DeepLearning/Layer.h>
+#include <DeepLearning/typedefs.h>
+
+
+namespace DeepLearning {
+	/** Class PrunedDeepBeliefNet
+	 * An inference-only copy of a DeepBeliefNet (see InferenceDeepBeliefNet) where the weights W of magnitude below a threshold are removed,
+	 * and the W of each RBM is stored in compressed sparse columns when the fraction of its weights that are zero reaches minSparsity.
+	 * Each matrix product then only goes through the remaining weights. The other RBMs keep a dense W, which multiplies faster below about 80% of zeros.
+	 * With a threshold of 0, only the weights that are exactly zero are removed, as with the l1 penalization of the pre-training,
+	 * and the predictions are those of the DeepBeliefNet up to the order of the sums.
+	 *
+	 * Constructors:
+	 *   - PrunedDeepBeliefNet(const DeepBeliefNet& aDBN, aThreshold, aMinSparsity) // prunes the weights of aDBN
+	 *   - PrunedDeepBeliefNet(layers, someDenseW, someSparseW, someB, someC, isUnrolled) // existing weights: for each RBM,
+	 *     either the dense or the sparse W is empty
+	 */
+	class PrunedDeepBeliefNet: public InferenceDeepBeliefNet {
+		private:
+			std::vector<MatrixXs> myDenseW; // empty (0 x 0) for the sparse RBMs
+			std::vector<SparseMatrixXs> mySparseW; // empty (0 x 0) for the dense RBMs
+
+			void forwardsProductInPlace(size_t i, const MatrixXs& data, MatrixXs& activations) const;
+			void backwardsProductInPlace(size_t i, const MatrixXs& hidden, MatrixXs& activations) const;
+
+		public:
+			PrunedDeepBeliefNet(const DeepBeliefNet& aDBN, Scalar aThreshold, double aMinSparsity);
+			PrunedDeepBeliefNet(const std::vector<Layer>& layers, const std::vector<MatrixXs>& someDenseW, const std::vector<SparseMatrixXs>& someSparseW,
+			                    const std::vector<ArrayX1s>& someB, const std::vector<ArrayX1s>& someC, bool isUnrolled);
+
+			/* Accessors */
+			bool isSparse(size_t i) const {return myDenseW[i].size() == 0;}
+			/** The W of RBM i: getDenseW if !isSparse(i), getSparseW otherwise */
+			const MatrixXs& getDenseW(size_t i) const {return myDenseW[i];}
+			const SparseMatrixXs& getSparseW(size_t i) const {return mySparseW[i];}
+			const ArrayX1s& getB(size_t i) const {return myB[i];}
+			const ArrayX1s& getC(size_t i) const {return myC[i];}
+			/** The fraction of the weights of RBM i that are zero */
+			double getSparsity(size_t i) const;
+	};
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <Eigen/Dense>
+
+#include <cstdint> // int8_t, int32_t
+#include <vector>
+
+#include <DeepLearning/DeepBeliefNet.h>
+#include <DeepLearning/InferenceDeepBeliefNet.h>
+#include <DeepLearning/Layer.h>
+#include <DeepLearning/typedefs.h>
+#include <shared_array_ptr.h>
+
+
+namespace DeepLearning {
+	/** Class QuantizedDeepBeliefNet
+	 * An inference-only copy of a DeepBeliefNet (see InferenceDeepBeliefNet) where the matrix products are computed on 8 bits integers,
+	 * accumulated in 32 bits and dequantized before the bias and the activation function.
+	 *   - The weights are quantized symmetrically with a scale per row: W(r, j) ~ rowScale(r) * Q(r, j), Q in [-127, 127].
+	 *   - The data entering each product is quantized to unsigned 8 bits with a scale and a zero point calibrated on sample data:
+	 *     x ~ dataScale * (q - zeroPoint), q in [0, 255], so that the activities of the binary and continuous layers use the whole range.
+	 *     Data beyond the calibrated range saturates.
+	 * W * x is then rowScale * dataScale * (Q * q - zeroPoint * rowSum(Q)): the unsigned by signed 8 bits products are those of the
+	 * dot product instructions of the processors (VNNI), that the compilers use when they are enabled (e.g. -march=native).
+	 * The 32 bits sums are exact up to 66000 units per layer.
+	 *
+	 * Each RBM has a forward product, with Q ~ W, and unless the network is unrolled, a backward product for reverse_predict with Q ~ W^T,
+	 * quantized with its own row scales, so that both products are dot products of contiguous rows.
+	 *
+	 * Storage: the Q of the forward products of all the RBMs are concatenated in a single array, each in row-major (rows x columns) order,
+	 * followed by the Q of the backward products. The row scales, data scales and zero points are in the same order (forward, then backward),
+	 * and the biases as in CompactDeepBeliefNet: b, c of the first RBM, then b, c of the second, etc.
+	 *
+	 * Constructors:
+	 *   - QuantizedDeepBeliefNet(const DeepBeliefNet& aDBN, const MatrixXs& someData) // quantizes aDBN, calibrated on someData (samples as columns)
+	 *   - QuantizedDeepBeliefNet(layers, someWeights, someRowScales, someDataScales, someZeroPoints, someBiases, isUnrolled) // existing
+	 *     8 bits weights, not copied
+	 */
+	class QuantizedDeepBeliefNet: public InferenceDeepBeliefNet {
+		public:
+			/** The largest layer for which the 32 bits sums cannot overflow */
+			static const Eigen_size_type maxLayerSize = 66000;
+
+		private:
+			shared_array_ptr<int8_t> myWeights;
+			std::vector<size_t> myWeightOffsets; // where the Q of each product starts in myWeights
+			std::vector<ArrayX1s> myRowScales;
+			std::vector<Eigen::Array<int32_t, Eigen::Dynamic, 1>> myRowSums; // sum of each row of Q, to subtract the zero points
+			std::vector<Scalar> myDataScales;
+			std::vector<int> myZeroPoints;
+
+			size_t nProducts() const {return unrolled ? nRBMs() : 2 * nRBMs();}
+			/** Rows and columns of the Q of product p: p < nRBMs() is the forward product of RBM p, otherwise the backward product of RBM p - nRBMs() */
+			Eigen_size_type productRows(size_t p) const {return p < nRBMs() ? myLayers[p + 1].getSize() : myLayers[p - nRBMs()].getSize();}
+			Eigen_size_type productColumns(size_t p) const {return p < nRBMs() ? myLayers[p].getSize() : myLayers[p - nRBMs() + 1].getSize();}
+			void computeWeightOffsets();
+			void computeRowSums();
+			/** Computes Q * data of product p, dequantized, into activations. The bias is added with the activities, by RBM::biasAndActivitiesInPlace */
+			void productInPlace(size_t p, const MatrixXs& data, MatrixXs& activations) const;
+			void forwardsProductInPlace(size_t i, const MatrixXs& data, MatrixXs& activations) const {productInPlace(i, data, activations);}
+			void backwardsProductInPlace(size_t i, const MatrixXs& hidden, MatrixXs& activations) const {productInPlace(nRBMs() + i, hidden, activations);}
+
+		public:
+			QuantizedDeepBeliefNet(const DeepBeliefNet& aDBN, const MatrixXs& someData);
+			QuantizedDeepBeliefNet(const std::vector<Layer>& layers, const shared_array_ptr<int8_t>& someWeights, const std::vector<Scalar>& someRowScales,
+			                       const std::vector<Scalar>& someDataScales, const std::vector<int>& someZeroPoints,
+			                       const std::vector<Scalar>& someBiases, bool isUnrolled);
+
+			/* Accessors */
+			/** The 8 bits weights, as described in the class documentation */
+			shared_array_ptr<int8_t> getWeights() const {return myWeights;}
+			/** The row scales of all the products, concatenated */
+			std::vector<Scalar> getRowScales() const;
+			const std::vector<Scalar>& getDataScales() const {return myDataScales;}
+			const std::vector<int>& getZeroPoints() const {return myZeroPoints;}
+			/** The biases, as described in the class documentation */
+			std::vector<Scalar> getBiases() const;
+
+			/** The number of 8 bits weights and of row scales of a network with these layers */
+			static size_t computeWeightsSize(const std::vector<Layer>&, bool isUnrolled);
+			static size_t computeRowScalesSize(const std::vector<Layer>&, bool isUnrolled);
+	};
+}
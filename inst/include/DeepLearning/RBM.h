@@ -3,10 +3,13 @@
 #include <Eigen/Dense>
 #include "boost/numeric/conversion/cast.hpp"
 
+#include <cstdint> // uint64_t
 #include <fstream>
 #include <memory>
 #include <string>
+#include <vector>
 
+#include <DeepLearning/BatchSource.h>
 #include <DeepLearning/Layer.h>
 #include <DeepLearning/PretrainParameters.h>
 #include <DeepLearning/ContinueFunction.h>
@@ -16,6 +19,8 @@
 
 
 namespace DeepLearning {
+	class ThreadPool;
+	
 	/** Class RBM
 	 * Encodes a Restricted Bolzman Machine. Contains an input and an output layer.
 	 * Does not make much sense (i.e probably not usable) outside the context of a DeepBeliefNet.
@@ -32,54 +37,62 @@ namespace DeepLearning {
 			/* Members */
 			const Layer input, output;
 			const offsets myOffsets; // quick access to offsets to get b (<0>), W (<1>) and c (<2>). <3> is total size of myData
-			shared_array_ptr<double> myData;
-			ArrayX1dMap b, c;
-			MatrixXdMap W;
+			shared_array_ptr<Scalar> myData;
+			ArrayX1sMap b, c;
+			MatrixXsMap W;
 			bool pretrained;
 	
 		public:
 			/** Forward pass functions */
-			/** Takes a visible layer data as MatrixXd and returns the hidden layer activities as an ArrayXXd. Takes a copy of the object first so it will not modify the input */
-			Eigen::MatrixXd forwardsDataToActivities(Eigen::MatrixXd) const;
-			/** Same as forwardsDataToActivities(), but instead of returning an ArrayXXd, takes it as second argument and modify it in place.
+			/** Takes a visible layer data as MatrixXs and returns the hidden layer activities as an ArrayXXs. Takes a copy of the object first so it will not modify the input */
+			MatrixXs forwardsDataToActivities(MatrixXs) const;
+			/** Same as forwardsDataToActivities(), but instead of returning an ArrayXXs, takes it as second argument and modify it in place.
 			 * The data is left unmodified.
 			 */
-			void forwardsDataToActivitiesInPlace(const Eigen::MatrixXd&, Eigen::MatrixXd&) const;
-			/** As forwardsDataToActivitiesInPlace(const MatrixXd, ArrayXXd), but modifies the data itself instead. */
-			void forwardsDataToActivitiesInPlace(Eigen::MatrixXd&) const;
+			void forwardsDataToActivitiesInPlace(const MatrixXs&, MatrixXs&) const;
+			/** As forwardsDataToActivitiesInPlace(const MatrixXs, ArrayXXs), but modifies the data itself instead. */
+			void forwardsDataToActivitiesInPlace(MatrixXs&) const;
 			
 			/** forwardsDataToActivations is as forwardsDataToActivities, only it goes only to the activations, and does not compute the activities.
 			 * Use the forwardsActivationsToActivities if you need the activities later on
 			 */
-			Eigen::MatrixXd forwardsDataToActivations(Eigen::MatrixXd) const;
-			void forwardsDataToActivationsInPlace(const Eigen::MatrixXd&, Eigen::MatrixXd&) const;
-			void forwardsDataToActivationsInPlace(Eigen::MatrixXd&) const;
+			MatrixXs forwardsDataToActivations(MatrixXs) const;
+			void forwardsDataToActivationsInPlace(const MatrixXs&, MatrixXs&) const;
+			void forwardsDataToActivationsInPlace(MatrixXs&) const;
+			/** Sparse data: W * data only goes through the non-zeros of the data */
+			void forwardsDataToActivationsInPlace(const SparseMatrixXs&, MatrixXs&) const;
+			void forwardsDataToActivitiesInPlace(const SparseMatrixXs&, MatrixXs&) const;
 			
-			/** Converts activations to activities, either in place or returning an ArrayXXd. 
+			/** Converts activations to activities, either in place or returning an ArrayXXs. 
 			 * The version that is not InPlace will make a copy of the object first so it will not modify the input
 			*/
-			Eigen::MatrixXd forwardsActivationsToActivities(Eigen::MatrixXd) const;
-			void forwardsActivationsToActivitiesInPlace(Eigen::MatrixXd&) const;
-			//void forwardsActivationsToActivitiesInPlace(Eigen::MatrixXd&) const;
+			MatrixXs forwardsActivationsToActivities(MatrixXs) const;
+			void forwardsActivationsToActivitiesInPlace(MatrixXs&) const;
+			//void forwardsActivationsToActivitiesInPlace(MatrixXs&) const;
 			
 	
 			/* Backward pass functions */
-			Eigen::MatrixXd backwardsHiddenToActivations(Eigen::MatrixXd) const;
-			void backwardsHiddenToActivationsInPlace(const Eigen::MatrixXd&, Eigen::MatrixXd&) const;
-			void backwardsHiddenToActivationsInPlace(Eigen::MatrixXd&) const;
+			MatrixXs backwardsHiddenToActivations(MatrixXs) const;
+			void backwardsHiddenToActivationsInPlace(const MatrixXs&, MatrixXs&) const;
+			void backwardsHiddenToActivationsInPlace(MatrixXs&) const;
 			
-			Eigen::MatrixXd backwardsActivationsToActivities(Eigen::MatrixXd) const;
-			void backwardsActivationsToActivitiesInPlace(Eigen::MatrixXd&) const;
+			MatrixXs backwardsActivationsToActivities(MatrixXs) const;
+			void backwardsActivationsToActivitiesInPlace(MatrixXs&) const;
 			
-			Eigen::MatrixXd backwardsHiddenToActivities(Eigen::MatrixXd) const;
-			void backwardsHiddenToActivitiesInPlace(const Eigen::MatrixXd&, Eigen::MatrixXd&) const;
-			void backwardsHiddenToActivitiesInPlace(Eigen::MatrixXd&) const;
+			MatrixXs backwardsHiddenToActivities(MatrixXs) const;
+			void backwardsHiddenToActivitiesInPlace(const MatrixXs&, MatrixXs&) const;
+			void backwardsHiddenToActivitiesInPlace(MatrixXs&) const;
 			
 			/* generic pass functions */
-			void genericActivationsToActivitiesInPlace(Eigen::MatrixXd&, const Layer::Type&) const;
+			/** Applies the activity function of the given layer type. Static as it depends only on the layer type, so that other models can reuse it */
+			static void genericActivationsToActivitiesInPlace(MatrixXs&, const Layer::Type&);
+			/** Adds aBias to each column of the products in act and applies the activity function of the given layer type, in a single pass.
+			 * The forward and backward passes compute their matrix product straight into act and finish with it.
+			 */
+			static void biasAndActivitiesInPlace(MatrixXs& act, const Eigen::Ref<const ArrayX1s>& aBias, const Layer::Type&);
 			
 			/* Sample pass functions */
-			void forwardsActivationsToActivitiesSampleInPlace(Eigen::MatrixXd&, Eigen::ArrayXXd) const;
+			void forwardsActivationsToActivitiesSampleInPlace(MatrixXs&, const ArrayXXs&) const;
 			
 			/* Some statics for the constructors */
 			static offsets computeOffsets(const Layer&, const Layer&);
@@ -89,17 +102,17 @@ namespace DeepLearning {
 			//	c(ac, aOutput.getSize()), W(aW, aOutput.getSize(), aInput.getSize()) {}
 			
 			// Pass no data
-			RBM(Layer aInput,  Layer aOutput): input(aInput), output(aOutput), myOffsets(computeOffsets(aInput, aOutput)), myData(new double[std::get<3>(myOffsets)], std::get<3>(myOffsets), true),
+			RBM(Layer aInput,  Layer aOutput): input(aInput), output(aOutput), myOffsets(computeOffsets(aInput, aOutput)), myData(new Scalar[std::get<3>(myOffsets)], std::get<3>(myOffsets), true),
 				b(myData.data(), nInput()), c(myData.data() + std::get<2>(myOffsets), nOutput()), W(myData.data() + std::get<1>(myOffsets), nOutput(), nInput()), pretrained(false) {}
 			
 			// Pass b, c and W as a single pointer - the others are computed from aInput and aOutput sizes
-			RBM(Layer aInput,  Layer aOutput, double* abcW, bool isAlreadyPretrained = false): input(aInput), output(aOutput), myOffsets(computeOffsets(aInput, aOutput)), myData(abcW, std::get<3>(myOffsets), false),
+			RBM(Layer aInput,  Layer aOutput, Scalar* abcW, bool isAlreadyPretrained = false): input(aInput), output(aOutput), myOffsets(computeOffsets(aInput, aOutput)), myData(abcW, std::get<3>(myOffsets), false),
 				b(abcW, nInput()), c(abcW + std::get<2>(myOffsets), nOutput()), W(abcW + std::get<1>(myOffsets), nOutput(), nInput()), pretrained(isAlreadyPretrained) {
 	//				std::cout << "RBM offsets: " << getRelativeOffsetB() << ", " << getRelativeOffsetW() << ", " << getRelativeOffsetC() << ", " << std::get<3>(myOffsets) << std::endl;
 				}
 			
 			// Pass a shared_array_ptr
-			RBM(Layer aInput,  Layer aOutput, shared_array_ptr<double> aData, bool isAlreadyPretrained = false): input(aInput), output(aOutput), myOffsets(computeOffsets(aInput, aOutput)), 
+			RBM(Layer aInput,  Layer aOutput, shared_array_ptr<Scalar> aData, bool isAlreadyPretrained = false): input(aInput), output(aOutput), myOffsets(computeOffsets(aInput, aOutput)), 
 				myData(aData > std::get<3>(myOffsets)),
 				b(aData.getOffsetData(), nInput()), c(aData.getOffsetData() + std::get<2>(myOffsets), nOutput()), W(aData.getOffsetData() + std::get<1>(myOffsets), nOutput(), nInput()),
 				pretrained(isAlreadyPretrained) {
@@ -117,54 +130,94 @@ namespace DeepLearning {
 			std::string sOutput() const {return output.getTypeAsString();}
 			Layer getInput() const {return input;}
 			Layer getOutput() const {return output;}
-			shared_array_ptr<double> getData() const {return myData;}
+			shared_array_ptr<Scalar> getData() const {return myData;}
 			/** Get the data. The following functions provide various ways to get it, as a raw pointer, shared_array_ptr or Eigen array/matrix */
-			double* getBAsPtr() const {return myData.getOffsetData() /* + std::get<0>(myOffsets) always 0 */;}
-			double* getWAsPtr() const {return myData.getOffsetData() + std::get<1>(myOffsets);}
-			double* getCAsPtr() const {return myData.getOffsetData() + std::get<2>(myOffsets);}
-			shared_array_ptr<double> getBAsSharedArrayPtr() const {return myData > boost::numeric_cast<std::size_t>(nInput());}
-			shared_array_ptr<double> getWAsSharedArrayPtr() const {return myData + std::get<1>(myOffsets) > boost::numeric_cast<std::size_t>(nWeights());}
-			shared_array_ptr<double> getCAsSharedArrayPtr() const {return myData + std::get<2>(myOffsets) > boost::numeric_cast<std::size_t>(nOutput());}
-			ArrayX1dMap getB() const {return b;}
-			ArrayX1dMap getC() const {return c;}
-			MatrixXdMap getW() const {return W;}
+			Scalar* getBAsPtr() const {return myData.getOffsetData() /* + std::get<0>(myOffsets) always 0 */;}
+			Scalar* getWAsPtr() const {return myData.getOffsetData() + std::get<1>(myOffsets);}
+			Scalar* getCAsPtr() const {return myData.getOffsetData() + std::get<2>(myOffsets);}
+			shared_array_ptr<Scalar> getBAsSharedArrayPtr() const {return myData > boost::numeric_cast<std::size_t>(nInput());}
+			shared_array_ptr<Scalar> getWAsSharedArrayPtr() const {return myData + std::get<1>(myOffsets) > boost::numeric_cast<std::size_t>(nWeights());}
+			shared_array_ptr<Scalar> getCAsSharedArrayPtr() const {return myData + std::get<2>(myOffsets) > boost::numeric_cast<std::size_t>(nOutput());}
+			ArrayX1sMap getB() const {return b;}
+			ArrayX1sMap getC() const {return c;}
+			MatrixXsMap getW() const {return W;}
 			/** Setting weights and biases directly with Eigen matrices with setB, setC and setW. */
-			RBM& setB(ArrayX1d aNewB);
-			RBM& setC(ArrayX1d aNewC);
-			RBM& setW(Eigen::MatrixXd aNewW);
-			RBM& setB(ArrayX1dMap aNewB);
-			RBM& setC(ArrayX1dMap aNewC);
-			RBM& setW(MatrixXdMap aNewW);
+			RBM& setB(ArrayX1s aNewB);
+			RBM& setC(ArrayX1s aNewC);
+			RBM& setW(MatrixXs aNewW);
+			RBM& setB(ArrayX1sMap aNewB);
+			RBM& setC(ArrayX1sMap aNewC);
+			RBM& setW(MatrixXsMap aNewW);
 			
-			size_t getRelativeOffsetB() const {return 0;} // Get offset in shared_array_ptr<double> or double* relative to the beginning of the shared_array_ptr of this RBM
+			size_t getRelativeOffsetB() const {return 0;} // Get offset in shared_array_ptr<Scalar> or Scalar* relative to the beginning of the shared_array_ptr of this RBM
 			size_t getRelativeOffsetW() const {return std::get<1>(myOffsets);} 
 			size_t getRelativeOffsetC() const {return std::get<2>(myOffsets);} 
 			offsets getOffsets() const {return myOffsets;}
 			bool isPretrained() const {return pretrained;}
 			
 			/* Training the net */
-			RBM& pretrain(const Eigen::MatrixXd&, const PretrainParameters&, PretrainProgress& aProgressFunctor = NoOpPretrainProgress::getInstance(), const ContinueFunction& aContinueFunction = ContinueFunction::getInstance());
+			/** The data can have the samples as columns, or as rows through samplesAsColumns: the batches are drawn from it in place */
+			RBM& pretrain(const DataRef&, const PretrainParameters&, PretrainProgress& aProgressFunctor = NoOpPretrainProgress::getInstance(), const ContinueFunction& aContinueFunction = ContinueFunction::getInstance());
+			/** Same, with the batches gathered from a BatchSource, such as a MappedDataset */
+			RBM& pretrain(const BatchSource&, const PretrainParameters&, PretrainProgress& aProgressFunctor = NoOpPretrainProgress::getInstance(), const ContinueFunction& aContinueFunction = ContinueFunction::getInstance());
+			/** Same, with sparse data: the batches are scattered into dense columns, but the products with the batch (the hidden activations and the positive phase of deltaW)
+			 * only go through its non-zeros */
+			RBM& pretrain(const SparseMatrixXs&, const PretrainParameters&, PretrainProgress& aProgressFunctor = NoOpPretrainProgress::getInstance(), const ContinueFunction& aContinueFunction = ContinueFunction::getInstance());
+		
+		private:
+			/** Pre-allocated batch, Gibbs chain and gradient buffers of one contrastive divergence loop, along with its random number generators.
+			 * There is one per thread when pre-training in parallel. Defined in RBM_pretrain.cpp.
+			 */
+			struct PretrainBuffers;
+			/** The pre-training loops. pretrain() prints the summary and dispatches to the one requested in the PretrainParameters.
+			 * pretrainSequential handles one batch after the other, either in a single thread or split in shards (synchronous mode).
+			 */
+			void pretrainSequential(const BatchSource&, const PretrainParameters&, PretrainProgress&, const ContinueFunction&);
+			void pretrainHogwild(const BatchSource&, const PretrainParameters&, PretrainProgress&, const ContinueFunction&);
+			/** One step of contrastive divergence on buffers.batch: Gibbs sampling, then deltaB, deltaC and deltaW.
+			 * The hidden samples are drawn from the part of the random streams reserved to iteration.
+			 */
+			void contrastiveDivergence(PretrainBuffers&, const PretrainParameters&, unsigned int iteration) const;
+			/** Same as contrastiveDivergence, but the batch is split in shards processed in parallel and reduced in a fixed order. */
+			void contrastiveDivergenceSharded(PretrainBuffers&, std::vector<PretrainBuffers>& shards, ThreadPool&, const PretrainParameters&, unsigned int iteration) const;
+			/** From buffers.batch and buffers.SampleAlpha, samples the hidden layer (Alpha), reconstructs the visible (Beta) and hidden (Alpha2) layers
+			 * after params.gibbsSteps Gibbs steps. In persistent mode, the reconstructions continue the fantasy chains of the buffers, and advance them.
+			 */
+			void gibbsSampling(PretrainBuffers&, const PretrainParameters&) const;
+			/** Computes deltaB, deltaC and deltaW from the Gibbs chain, divided by divisor */
+			void computeDeltas(PretrainBuffers&, const PretrainParameters&, const double divisor) const;
+			/** Applies the deltas in the buffers to b, c and W, with learning rates, penalization and momentum.
+			 * bInc, cInc and Winc of the buffers are the velocities, kept from one iteration to the next. Does not lock anything.
+			 */
+			void updateWeights(PretrainBuffers&, const PretrainParameters&, const double momentum);
+		
+		public:
 			
 			/* Predictions & cie */
-			Eigen::MatrixXd predict(Eigen::MatrixXd data) const {forwardsDataToActivitiesInPlace(data);return data;}
-			void predictInPlace(Eigen::MatrixXd& data) const {forwardsDataToActivitiesInPlace(data);}
-			Eigen::MatrixXd reverse_predict(Eigen::MatrixXd data) const {backwardsHiddenToActivitiesInPlace(data); return data;}
-			void reverse_predictInPlace(Eigen::MatrixXd& data) const {backwardsHiddenToActivitiesInPlace(data);}
-			Eigen::MatrixXd reconstruct(Eigen::MatrixXd data) const {predictInPlace(data); reverse_predictInPlace(data); return data;}
-			void reconstructInPlace(Eigen::MatrixXd& data) const {predictInPlace(data); reverse_predictInPlace(data);}
+			MatrixXs predict(MatrixXs data) const {forwardsDataToActivitiesInPlace(data);return data;}
+			void predictInPlace(MatrixXs& data) const {forwardsDataToActivitiesInPlace(data);}
+			MatrixXs predict(const SparseMatrixXs& data) const {MatrixXs act; forwardsDataToActivitiesInPlace(data, act); return act;}
+			MatrixXs reverse_predict(MatrixXs data) const {backwardsHiddenToActivitiesInPlace(data); return data;}
+			void reverse_predictInPlace(MatrixXs& data) const {backwardsHiddenToActivitiesInPlace(data);}
+			MatrixXs reconstruct(MatrixXs data) const {predictInPlace(data); reverse_predictInPlace(data); return data;}
+			void reconstructInPlace(MatrixXs& data) const {predictInPlace(data); reverse_predictInPlace(data);}
+			/** Predictions of samples given as rows (samples x features, as R stores them) into predictions (samples x outputs), without transposing anything */
+			void predictSamplesAsRows(const Eigen::Ref<const MatrixXs>& samples, MatrixXs& predictions) const;
 			/* Sampling */
-			Eigen::MatrixXd sample(const Eigen::MatrixXd& data) const;
-			//Eigen::MatrixXd sampleInPlace(Eigen::MatrixXd& data) const;
+			MatrixXs sample(const MatrixXs& data) const;
+			/** Reproducible sampling: the random numbers only depend on aSeed and aLayer (the layer of the RBM in its DBN) */
+			MatrixXs sample(const MatrixXs& data, uint64_t aSeed, size_t aLayer = 0) const;
+			//MatrixXs sampleInPlace(MatrixXs& data) const;
 
 			/** Computes the squared error of the reconstruction, per data point, and return it in a vector.
 			 *  errorSum computes the sum of error over all data points and returns a single double.
 			 *  The behaviour is different on unrolled networks: the hidden layer *is* the reconstruction, whereas on non-unrolled networks reverse_predict is used
 			 *  to get the reconstructions. This is done through the reconstruct() function.
 			 */
-			ArrayX1d error(const Eigen::MatrixXd&) const;
-			double errorSum(const Eigen::MatrixXd&) const;
-			ArrayX1d error(const Eigen::MatrixXd& data, const Eigen::MatrixXd& reconstructions) const;
-			double errorSum(const Eigen::MatrixXd& data, const Eigen::MatrixXd& reconstructions) const; 
+			ArrayX1s error(const MatrixXs&) const;
+			double errorSum(const MatrixXs&) const;
+			ArrayX1s error(const MatrixXs& data, const MatrixXs& reconstructions) const;
+			double errorSum(const MatrixXs& data, const MatrixXs& reconstructions) const; 
 			
 			/** The evidenceGradientSum function simply calculates the root of the squared gradient vectors (after penalization),
 			 * but without the training rate, and averages it per data point.
@@ -173,14 +226,14 @@ namespace DeepLearning {
 			 * In addition, it is not available outside the pre-training for now, so it is not a public method.
 			 */
 		private:
-			double evidenceGradientSum(const ArrayX1d&, const ArrayX1d& deltaC, const Eigen::ArrayXXd& deltaW) const;
+			double evidenceGradientSum(const ArrayX1s&, const ArrayX1s& deltaC, const ArrayXXs& deltaW) const;
 
 			/** Computes the enery of the network, per data point, and return it in a vector 
 			 * energySum computes the sum of error over all data points and returns a single double
 			 */
 		public:
-			ArrayX1d energy(const Eigen::MatrixXd&) const;
-			double energySum(const Eigen::MatrixXd&) const;
+			ArrayX1s energy(const MatrixXs&) const;
+			double energySum(const MatrixXs&) const;
 		
 			/* clone */
 			RBM clone() const;
@@ -1,13 +1,17 @@
 #pragma once 
 
 #include <algorithm> // std::find, std::tolower
+#include <cmath> // std::cos, std::exp
+#include <cstdint> // uint64_t
 #include <functional> // std::function
 #include <limits>
 #include <stdexcept> // std::invalid_argument
 #include <string>
 #include <vector>
 
+#include <DeepLearning/BatchSource.h> // SamplingType
 #include <DeepLearning/typedefs.h> // UNUSED(variables)
+#include <DeepLearning/utils.h> // randomSeed
 
 
 namespace DeepLearning {
@@ -27,17 +31,26 @@ namespace DeepLearning {
 	 *     - maxCgIters: default 10; number of iterations of the CG (per maxiter)
 	 *     - abstol: absolute tolerance, on the final error
 	 *     - intol: relative tolerance (reltol in ?optim), on the improvement at a particular step
+	 *     - method: cg (default) or lbfgs; lbfgs minimizes with limited-memory BFGS (see lbfgs in R_optim.h) instead of conjugate gradients.
+	 *       maxCgIters, trace, steplength (first step only), acctol (sufficient decrease), abstol and intol apply to both.
+	 *     - lmm: default 5; number of corrections kept in the history of L-BFGS (lmm in ?optim)
+	 *     - curvtol: default 0.9; the curvature condition of the strong Wolfe line search of L-BFGS
 	 * 
 	 * All members can be set directly or trough the set* functions.
 	 * 
 	 */
 	struct CgMinParams {
+		enum Method {cg, lbfgs};
+		
 		int type, trace;
 		unsigned int maxCgIters;
 		double steplength, stepredn, acctol, reltest, abstol, intol, setstep;
+		Method method;
+		unsigned int lmm;
+		double curvtol;
 	
 		CgMinParams(): type(2), trace(0), maxCgIters(10), steplength(1.0), stepredn(0.2), acctol(0.0001), reltest(10.0), abstol(-std::numeric_limits<double>::infinity()), 
-			intol(sqrt(std::numeric_limits<double>::epsilon())), setstep(1.7) {}
+			intol(sqrt(std::numeric_limits<double>::epsilon())), setstep(1.7), method(cg), lmm(5), curvtol(0.9) {}
 	
 		CgMinParams& setAlgorithmType(int newAlgorithmType) {
 			if (newAlgorithmType < 1 || newAlgorithmType > 3) {
@@ -72,6 +85,34 @@ namespace DeepLearning {
 		CgMinParams& setAbstol(double newAbstol) {abstol = newAbstol; return *this;}
 		CgMinParams& setIntol(double newIntol) {intol = newIntol; return *this;}
 		CgMinParams& setSetstep(double newSetstep) {setstep = newSetstep; return *this;}
+		CgMinParams& setMethod(Method newMethod) {method = newMethod; return *this;}
+		CgMinParams& setMethod(std::string newMethod) {
+			std::transform(newMethod.begin(), newMethod.end(), newMethod.begin(), ::tolower);
+			if (newMethod == "cg") {
+				method = cg;
+			}
+			else if (newMethod == "l-bfgs" || newMethod == "lbfgs") {
+				method = lbfgs;
+			}
+			else {
+				throw std::invalid_argument("Unknown method");
+			}
+			return *this;
+		}
+		CgMinParams& setLmm(unsigned int newLmm) {
+			if (newLmm < 1) {
+				throw std::invalid_argument("lmm must be at least 1");
+			}
+			lmm = newLmm;
+			return *this;
+		}
+		CgMinParams& setCurvtol(double newCurvtol) {
+			if (!(newCurvtol > 0 && newCurvtol < 1)) {
+				throw std::invalid_argument("curvtol must be between 0 and 1 (excluded)");
+			}
+			curvtol = newCurvtol;
+			return *this;
+		}
 	};
 	
 	/**
@@ -81,7 +122,22 @@ namespace DeepLearning {
 	 *	 - unsigned int minIters: default 100; The minimum number of iterations of the algorithm (number of batches we draw)
 	 *	 - unsigned int maxIters: default 1000; The maximum number of iterations of the algorithm (number of batches we draw)
 	 *   - unsigned int nProcs: default 0 (for Eigen, special value = no parallel execution)
-	 *   - cgMinParams: optimization parameters for the conjugate gradient algorithm. An object of class CgMinParams.
+	 *   - enum parallelization {sequential, synchronous}: default sequential;
+	 *     synchronous splits the columns of each batch across nbThreads threads to compute the error and gradient, instead of relying on Eigen's threads.
+	 *   - uint64_t seed: default a random one; the key of the random number generator drawing the batches. The batch of each iteration only depends on it.
+	 *   - BatchSource::SamplingType sampling {replacement, epoch, shuffled}: default replacement; how the batches are drawn, as in PretrainParameters:
+	 *     with replacement, or in the order of a permutation of the samples drawn at each epoch (from a shuffled copy of the data with shuffled, which requires dense data in memory).
+	 *   - bool prefetch: default true; assemble the next batch in a background thread during the current iteration. The batches are the same either way.
+	 *   - cgMinParams: optimization parameters for the conjugate gradient algorithm, or L-BFGS with method = lbfgs. An object of class CgMinParams.
+	 *   - enum optimizer {cgmin, sgd, adam}: default cgmin; cgmin minimizes the error of each batch with conjugate gradients or L-BFGS (see cgMinParams).
+	 *     sgd and adam make one step per batch along the gradient averaged over the batch: sgd with momentum, adam (Kingma and Ba, 2015) with
+	 *     moving averages of the gradients and of their squares. They cost one gradient per batch, against up to maxCgIters gradients and line searches for cgmin.
+	 *   - double learningRate: default 0.01; the size of the steps of sgd and adam, at the first iteration;
+	 *   - enum schedule {constant, exponential, inverse, cosine}: default constant; how the learning rate evolves with the iteration i (from 0):
+	 *     constant, learningRate * exp(-learningRateDecay * i), learningRate / (1 + learningRateDecay * i), or a cosine from learningRate to 0 at maxIters;
+	 *   - double learningRateDecay: default 0; the decay of the exponential and inverse schedules;
+	 *   - double momentum: default 0.9; the momentum of sgd;
+	 *   - double beta1, beta2, optimizerEpsilon: default 0.9, 0.999 and 1e-8; the decays of the moving averages of adam, and the term that avoids divisions by 0.
 	 * 
 	 * All members can be set directly or trough the set* functions.
 	 * 
@@ -90,17 +146,104 @@ namespace DeepLearning {
 	struct TrainParameters {
 		typedef std::function<bool(std::vector<double>, unsigned int, size_t)> continueFunctionType;
 	
+		enum ParallelizationType {sequential, synchronous};
+		enum OptimizerType {cgmin, sgd, adam};
+		enum ScheduleType {constant, exponential, inverse, cosine};
+		
 		CgMinParams myCgMinParams;
 		size_t batchSize;
 		int nbThreads;
 		unsigned int minIters, maxIters;
+		ParallelizationType parallelization;
+		uint64_t seed;
+		OptimizerType optimizer;
+		double learningRate;
+		ScheduleType schedule;
+		double learningRateDecay, momentum, beta1, beta2, optimizerEpsilon;
+		BatchSource::SamplingType sampling;
+		bool prefetch;
 	
 		TrainParameters& setCgMinParams(const CgMinParams& newcgMinParams) {myCgMinParams = newcgMinParams; return *this;}
 		TrainParameters& setBatchSize(size_t newBatchSize) {batchSize = newBatchSize; return *this;}
 		TrainParameters& setNbThreads(int newNbThreads) {nbThreads = newNbThreads; return *this;}
 		TrainParameters& setMinIters(unsigned int newMinIters) {minIters = newMinIters; return *this;}
 		TrainParameters& setMaxIters(unsigned int newMaxIters) {maxIters = newMaxIters; return *this;}
+		TrainParameters& setSeed(uint64_t newSeed) {seed = newSeed; return *this;}
+		TrainParameters& setParallelization(ParallelizationType newParallelization) {parallelization = newParallelization; return *this;}
+		TrainParameters& setParallelization(std::string newParallelization) {
+			std::transform(newParallelization.begin(), newParallelization.end(), newParallelization.begin(), ::tolower);
+			if (newParallelization == "sequential") {
+				parallelization = sequential;
+			}
+			else if (newParallelization == "synchronous") {
+				parallelization = synchronous;
+			}
+			else {
+				throw std::invalid_argument("Unknown parallelization type");
+			}
+			return *this;
+		}
+		TrainParameters& setOptimizer(OptimizerType newOptimizer) {optimizer = newOptimizer; return *this;}
+		TrainParameters& setOptimizer(std::string newOptimizer) {
+			std::transform(newOptimizer.begin(), newOptimizer.end(), newOptimizer.begin(), ::tolower);
+			if (newOptimizer == "cgmin") {
+				optimizer = cgmin;
+			}
+			else if (newOptimizer == "sgd") {
+				optimizer = sgd;
+			}
+			else if (newOptimizer == "adam") {
+				optimizer = adam;
+			}
+			else {
+				throw std::invalid_argument("Unknown optimizer");
+			}
+			return *this;
+		}
+		TrainParameters& setLearningRate(double newLearningRate) {learningRate = newLearningRate; return *this;}
+		TrainParameters& setSchedule(ScheduleType newSchedule) {schedule = newSchedule; return *this;}
+		TrainParameters& setSchedule(std::string newSchedule) {
+			std::transform(newSchedule.begin(), newSchedule.end(), newSchedule.begin(), ::tolower);
+			if (newSchedule == "constant") {
+				schedule = constant;
+			}
+			else if (newSchedule == "exponential") {
+				schedule = exponential;
+			}
+			else if (newSchedule == "inverse") {
+				schedule = inverse;
+			}
+			else if (newSchedule == "cosine") {
+				schedule = cosine;
+			}
+			else {
+				throw std::invalid_argument("Unknown learning rate schedule");
+			}
+			return *this;
+		}
+		TrainParameters& setLearningRateDecay(double newLearningRateDecay) {learningRateDecay = newLearningRateDecay; return *this;}
+		TrainParameters& setMomentum(double newMomentum) {momentum = newMomentum; return *this;}
+		TrainParameters& setBeta1(double newBeta1) {beta1 = newBeta1; return *this;}
+		TrainParameters& setBeta2(double newBeta2) {beta2 = newBeta2; return *this;}
+		TrainParameters& setOptimizerEpsilon(double newOptimizerEpsilon) {optimizerEpsilon = newOptimizerEpsilon; return *this;}
+		TrainParameters& setSampling(BatchSource::SamplingType newSampling) {sampling = newSampling; return *this;}
+		TrainParameters& setSampling(std::string newSampling) {
+			sampling = BatchSource::SamplingTypeFromString(newSampling);
+			return *this;
+		}
+		TrainParameters& setPrefetch(bool newPrefetch) {prefetch = newPrefetch; return *this;}
+		/** The learning rate of iteration anIteration (from 1), according to the schedule */
+		double getLearningRate(unsigned int anIteration) const {
+			const double i = double(anIteration) - 1;
+			switch (schedule) {
+				case exponential: return learningRate * std::exp(-learningRateDecay * i);
+				case inverse: return learningRate / (1 + learningRateDecay * i);
+				case cosine: return learningRate * 0.5 * (1 + std::cos(3.14159265358979323846 * i / double(maxIters)));
+				default: return learningRate;
+			}
+		}
 	
-		TrainParameters() : myCgMinParams(), batchSize(100), nbThreads(0), minIters(100), maxIters(1000) {}
+		TrainParameters() : myCgMinParams(), batchSize(100), nbThreads(0), minIters(100), maxIters(1000), parallelization(sequential), seed(randomSeed()),
+			optimizer(cgmin), learningRate(0.01), schedule(constant), learningRateDecay(0), momentum(0.9), beta1(0.9), beta2(0.999), optimizerEpsilon(1e-8), sampling(BatchSource::replacement), prefetch(true) {}
 	};
 }
@@ -3,6 +3,7 @@
 #define UNUSED(x) (void)(x) // hide unused parameters warnings
 
 #include <Eigen/Dense>
+#include <Eigen/SparseCore>
 
 #include <tuple>
 #include <functional> // std::function
@@ -10,16 +11,39 @@
 
 
 namespace DeepLearning {
+	/** Scalar type of the weights and of all the computations.
+	 * double by default. Define DEEPLEARNING_FLOAT at build time to run everything in single precision.
+	 * The R interface always works with doubles and converts at the boundary.
+	 */
+#ifdef DEEPLEARNING_FLOAT
+	typedef float Scalar;
+#else
+	typedef double Scalar;
+#endif
+	typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> MatrixXs;
+	typedef Eigen::Array<Scalar, Eigen::Dynamic, Eigen::Dynamic> ArrayXXs;
+	typedef Eigen::Array<Scalar, Eigen::Dynamic, 1> ArrayX1s;
+	typedef Eigen::Map<ArrayX1s> ArrayX1sMap;
+	typedef Eigen::Map<MatrixXs> MatrixXsMap;
+	
 	typedef Eigen::Array<double, Eigen::Dynamic, 1> ArrayX1d;
 	typedef Eigen::Map<Eigen::Array<double, Eigen::Dynamic, 1>> ArrayX1dMap;
 	typedef Eigen::Map<Eigen::MatrixXd> MatrixXdMap;
 	typedef Eigen::MatrixXd::Index Eigen_size_type;
 	
+	/** Data with the samples as columns, whatever its memory layout: a MatrixXs (or a block of it) is bound without copy,
+	 * and so is a matrix with the samples as rows, as R stores them, seen through samplesAsColumns (see utils.h).
+	 */
+	typedef Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic> DataStride;
+	typedef Eigen::Ref<const MatrixXs, 0, DataStride> DataRef;
+	/** Sparse data in compressed sparse column storage, with the samples as columns like DataRef: each sample is a column of its non-zeros */
+	typedef Eigen::SparseMatrix<Scalar, Eigen::ColMajor> SparseMatrixXs;
+	
 	typedef std::tuple<size_t, size_t, size_t, size_t> offsets;
 	
 	typedef std::function<bool(std::vector<double>, unsigned int, size_t, unsigned int maxiters, size_t layer)> continueFunctionType;
 	
 	class RBM; class DeepBeliefNet;
-	typedef std::function<void(const RBM& anRBM, const Eigen::MatrixXd& batch, const Eigen::MatrixXd& data, const unsigned int iter, const size_t batchsize, const unsigned int maxiters, const size_t layer)> pretrainDiagFunctionType;
-	typedef std::function<void(const DeepBeliefNet& aDBN, const Eigen::MatrixXd& batch, const Eigen::MatrixXd& data, const unsigned int iter, const size_t batchsize, const unsigned int maxiters)> trainDiagFunctionType;
+	typedef std::function<void(const RBM& anRBM, const MatrixXs& batch, const MatrixXs& data, const unsigned int iter, const size_t batchsize, const unsigned int maxiters, const size_t layer)> pretrainDiagFunctionType;
+	typedef std::function<void(const DeepBeliefNet& aDBN, const MatrixXs& batch, const MatrixXs& data, const unsigned int iter, const size_t batchsize, const unsigned int maxiters)> trainDiagFunctionType;
 }
@@ -1,24 +1,62 @@
 #pragma once 
 
+#include <Eigen/Dense>
+
 #include <cmath> // std::tanh
+#include <cstdint> // uint64_t
+#include <random> // std::random_device
 #include <vector>
 
+#include <DeepLearning/typedefs.h>
+
 
 namespace DeepLearning {
 	/** Element-wise tanh (tangent hyperbolic)
 	 * 
 	 * Takes an object and executes std::tanh on all its elements.
-	 * Designed for Eigen matrices, it accepts any object as long as they implement .data() (a pointer to a double) and .size() (length of the data)
+	 * Designed for Eigen matrices, it accepts any object as long as they implement .data() (a pointer to the scalars) and .size() (length of the data)
 	 */
 	template <typename T> T& tanhInPlace(T& anEigenObject) {
 		auto ncomponenents = anEigenObject.size();
-		double* theData = anEigenObject.data();
+		auto* theData = anEigenObject.data();
 		for (auto i = 0; i < ncomponenents; ++i) {
 			theData[i] = std::tanh(theData[i]);
 		}
 		return anEigenObject;
 	}
 	
+	/** A non-reproducible 64 bits seed for the random number generators, when none was given */
+	inline uint64_t randomSeed() {
+		std::random_device rd;
+		return (static_cast<uint64_t>(rd()) << 32) | rd();
+	}
+	
+	/** Views a samples x features matrix as the features x samples matrix that the models expect, with strides rather than a transpose.
+	 * The view points to the memory of someSamples, which must outlive it.
+	 */
+	inline Eigen::Map<const MatrixXs, 0, DataStride> samplesAsColumns(const Eigen::Ref<const MatrixXs>& someSamples) {
+		return Eigen::Map<const MatrixXs, 0, DataStride>(someSamples.data(), someSamples.cols(), someSamples.rows(), DataStride(1, someSamples.outerStride()));
+	}
+	
+	/** Whether someData is a samplesAsColumns view, in which case samplesAsRows gives back the samples x features matrix */
+	inline bool hasSamplesAsRows(const DataRef& someData) {
+		return someData.innerStride() != 1 && someData.outerStride() == 1;
+	}
+	
+	inline Eigen::Map<const MatrixXs, 0, Eigen::OuterStride<>> samplesAsRows(const DataRef& someData) {
+		return Eigen::Map<const MatrixXs, 0, Eigen::OuterStride<>>(someData.data(), someData.cols(), someData.rows(), Eigen::OuterStride<>(someData.innerStride()));
+	}
+	
+	/** Chunked loops
+	 * The element-wise kernels of CompactDeepBeliefNet and QuantizedDeepBeliefNet run an inner loop over a chunk of a constant number of
+	 * elements, followed by a scalar loop over the remainder. GCC 12 and later vectorize at -O2 (R's default) only the loops whose trip
+	 * count is a known multiple of the vector width, so the inner loops over the chunks are vectorized where the plain loops are not.
+	 * Older GCC vectorize neither at -O2, and both with -O3 or -ftree-vectorize; clang vectorizes both at -O2. The chunks don't slow down
+	 * these builds.
+	 */
+	const Eigen_size_type halfPrecisionChunk = 8; // 16 bits values widened to Scalar
+	const Eigen_size_type int8Chunk = 64; // 8 bits products summed in 32 bits
+	
 	/** Checks if element is present in the container */
 	template<typename T> bool isIn(const std::vector<T>& container, const T element) {
 		return std::find(container.begin(), container.end(), element) != container.end();
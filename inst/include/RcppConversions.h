@@ -4,8 +4,11 @@
 
 #include <memory> // std::unique_ptr
 
+#include <DeepLearning/CompactDeepBeliefNet.h>
 #include <DeepLearning/DeepBeliefNet.h>
 #include <DeepLearning/Layer.h>
+#include <DeepLearning/PrunedDeepBeliefNet.h>
+#include <DeepLearning/QuantizedDeepBeliefNet.h>
 #include <DeepLearning/RBM.h>
 #include <shared_array_ptr.h>
 
@@ -16,8 +19,8 @@ namespace Rcpp {
 	template <> size_t as(SEXP ptr);
 	
 	// shared_array_ptr
-	template <> shared_array_ptr<double> as(SEXP ptr);
-	template <> SEXP wrap(const shared_array_ptr<double> &ptr);
+	template <> shared_array_ptr<Scalar> as(SEXP ptr);
+	template <> SEXP wrap(const shared_array_ptr<Scalar> &ptr);
 	
 	// Offsets (weights.breaks)
 	// This is computed automaticall on import, so no as
@@ -39,6 +42,18 @@ namespace Rcpp {
 	template <> DeepBeliefNet as(SEXP dbn);
 	template <> SEXP wrap(const DeepBeliefNet &dbn);
 	
+	// CompactDeepBeliefNet
+	template <> CompactDeepBeliefNet as(SEXP compactDbn);
+	template <> SEXP wrap(const CompactDeepBeliefNet &compactDbn);
+	
+	// PrunedDeepBeliefNet
+	template <> PrunedDeepBeliefNet as(SEXP prunedDbn);
+	template <> SEXP wrap(const PrunedDeepBeliefNet &prunedDbn);
+	
+	// QuantizedDeepBeliefNet
+	template <> QuantizedDeepBeliefNet as(SEXP quantizedDbn);
+	template <> SEXP wrap(const QuantizedDeepBeliefNet &quantizedDbn);
+	
 	// PretrainParameters
 	template <> PretrainParameters as(SEXP params);
 	template <> std::vector<PretrainParameters> as(SEXP params);
@@ -61,6 +76,10 @@ namespace Rcpp {
 	// no need to return so no wrap
 	// template <> SEXP wrap(const TrainProgress &diag);
 	
+	// MappedDataset: built from a MappedData list, that only describes the file
+	template <> std::unique_ptr<MappedDataset> as(SEXP dataset);
+	// no need to return so no wrap
+	
 	// ContinueFunction
 	template <> ContinueFunction as(SEXP cont);
 	// no need to return so no wrap
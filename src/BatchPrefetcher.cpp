@@ -0,0 +1,71 @@
+#include <exception> // std::current_exception, std::rethrow_exception
+#include <mutex>
+#include <thread>
+
+#include "BatchPrefetcher.h"
+
+
+namespace DeepLearning {
+	BatchPrefetcher::BatchPrefetcher(Random& aBatchRand, const BatchSource& aSource, bool enabled): batchRand(aBatchRand), source(aSource), next(),
+		worker(), mutex(), requested(), ready(), pendingIteration(0), pendingReady(false), stopping(false), exception() {
+		if (enabled) {
+			worker = std::thread(&BatchPrefetcher::workerLoop, this);
+		}
+	}
+
+	BatchPrefetcher::~BatchPrefetcher() {
+		if (!worker.joinable()) return;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		requested.notify_all();
+		worker.join(); // after the batch being assembled, if any
+	}
+
+	void BatchPrefetcher::workerLoop() {
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			requested.wait(lock, [this]() {return stopping || (pendingIteration != 0 && !pendingReady);});
+			if (stopping) return;
+			const uint64_t iteration = pendingIteration;
+			lock.unlock();
+			try {
+				assemble(iteration, next);
+			} catch (...) {
+				lock.lock();
+				exception = std::current_exception();
+				lock.unlock();
+			}
+			lock.lock();
+			pendingReady = true;
+			ready.notify_all();
+		}
+	}
+
+	void BatchPrefetcher::fetch(uint64_t anIteration, MatrixXs& batch) {
+		if (!worker.joinable()) {
+			assemble(anIteration, batch);
+			return;
+		}
+
+		std::unique_lock<std::mutex> lock(mutex);
+		ready.wait(lock, [this]() {return pendingIteration == 0 || pendingReady;});
+		if (exception) {
+			std::exception_ptr toRethrow = exception;
+			exception = nullptr;
+			pendingIteration = 0;
+			std::rethrow_exception(toRethrow);
+		}
+		if (pendingIteration == anIteration) {
+			batch.swap(next);
+		}
+		else { // first batch, or not the one expected: the worker is idle, draw it here
+			assemble(anIteration, batch);
+			next.resize(batch.rows(), batch.cols());
+		}
+		pendingIteration = anIteration + 1;
+		pendingReady = false;
+		requested.notify_one();
+	}
+}
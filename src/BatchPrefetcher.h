@@ -0,0 +1,54 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint> // uint64_t
+#include <exception> // std::exception_ptr
+#include <mutex>
+#include <thread>
+
+#include <DeepLearning/BatchSource.h>
+#include <DeepLearning/typedefs.h>
+
+#include "Random.h"
+
+
+namespace DeepLearning {
+	/** Assembles the batches of a training loop in the background.
+	 *
+	 * fetch(i, batch) puts the batch of iteration i in batch, then starts a worker thread assembling the batch of iteration i + 1 in a second buffer,
+	 * while the caller computes with batch. The next fetch only waits for the worker if it is not done yet, and swaps the buffers.
+	 * The batch of an iteration only depends on the iteration (see Random::setIteration), so the batches are those that would have been drawn in the loop,
+	 * and the batch prefetched after the last iteration is simply dropped.
+	 * With enabled = false no thread is started and fetch draws the batch in the calling thread.
+	 *
+	 * The random generator and the source are only read by the worker between two calls to fetch: they must not be used elsewhere meanwhile, and must outlive the prefetcher.
+	 * The worker doesn't call R. Copy and assignment are forbidden, the prefetcher owns its thread.
+	 */
+	class BatchPrefetcher {
+		private:
+			Random& batchRand;
+			const BatchSource& source;
+			MatrixXs next;
+			std::thread worker;
+			std::mutex mutex;
+			std::condition_variable requested, ready;
+			uint64_t pendingIteration; // the iteration of the batch in next, or being assembled in it. 0: none
+			bool pendingReady, stopping;
+			std::exception_ptr exception;
+
+			void workerLoop();
+			void assemble(uint64_t anIteration, MatrixXs& batch) {
+				batchRand.setIteration(anIteration);
+				batchRand.setBatch(source, batch);
+			}
+
+		public:
+			BatchPrefetcher(Random& aBatchRand, const BatchSource& aSource, bool enabled);
+			BatchPrefetcher(const BatchPrefetcher&) = delete;
+			BatchPrefetcher& operator=(const BatchPrefetcher&) = delete;
+			~BatchPrefetcher();
+
+			/** Puts the batch of anIteration (from 1) in batch, and starts assembling the batch of anIteration + 1. batch keeps its size but may get a new buffer. */
+			void fetch(uint64_t anIteration, MatrixXs& batch);
+	};
+}
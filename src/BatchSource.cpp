@@ -0,0 +1,82 @@
+#include <Eigen/Dense>
+
+#include <algorithm> // std::transform
+#include <stdexcept> // std::invalid_argument
+#include <string>
+
+#include <DeepLearning/BatchSource.h>
+#include <DeepLearning/RBM.h>
+#include <DeepLearning/utils.h> // hasSamplesAsRows, samplesAsRows
+
+
+namespace DeepLearning {
+	const std::string BatchSource::invalid_sampling = "newSampling not replacement, epoch or shuffled";
+
+	std::string BatchSource::SamplingTypeToString(SamplingType aST) {
+		switch (aST) {
+			case replacement: return "replacement";
+			case epoch: return "epoch";
+			case shuffled: return "shuffled";
+		}
+		throw std::invalid_argument(invalid_sampling);
+	}
+
+	BatchSource::SamplingType BatchSource::SamplingTypeFromString(std::string aString) {
+		std::transform(aString.begin(), aString.end(), aString.begin(), ::tolower);
+		if (aString == "replacement") {
+			return replacement;
+		}
+		else if (aString == "epoch") {
+			return epoch;
+		}
+		else if (aString == "shuffled") {
+			return shuffled;
+		}
+		else {
+			throw std::invalid_argument(invalid_sampling);
+		}
+	}
+
+	void BatchSource::checkSampling(SamplingType aSampling) const {
+		if (aSampling == shuffled && !isDense()) throw std::invalid_argument("sampling = 'shuffled' requires the data as a dense matrix");
+	}
+
+	void BatchSource::gather(const Eigen_size_type* columns, Eigen_size_type nColumns, MatrixXs& dest, Eigen_size_type firstColumn) const {
+		if (dataset) {
+			if (layersBelow.empty()) {
+				dataset->gather(columns, nColumns, dest, firstColumn);
+				return;
+			}
+			MatrixXs samples(dataset->nFeatures(), nColumns), activities;
+			dataset->gather(columns, nColumns, samples, 0);
+			for (const RBM* layer: layersBelow) {
+				layer->forwardsDataToActivitiesInPlace(samples, activities);
+				samples.swap(activities);
+			}
+			dest.middleCols(firstColumn, nColumns) = samples;
+		}
+		else if (sparseData) {
+			for (Eigen_size_type i = 0; i < nColumns; ++i) {
+				auto column = dest.col(firstColumn + i);
+				column.setZero();
+				for (SparseMatrixXs::InnerIterator value(*sparseData, columns[i]); value; ++value) {
+					column(value.row()) = value.value();
+				}
+			}
+		}
+		else if (hasSamplesAsRows(*data)) {
+			const auto samples = samplesAsRows(*data);
+			for (Eigen_size_type feature = 0; feature < dest.rows(); ++feature) {
+				const Scalar* featureData = samples.col(feature).data();
+				for (Eigen_size_type i = 0; i < nColumns; ++i) {
+					dest(feature, firstColumn + i) = featureData[columns[i]];
+				}
+			}
+		}
+		else {
+			for (Eigen_size_type i = 0; i < nColumns; ++i) {
+				dest.col(firstColumn + i) = data->col(columns[i]);
+			}
+		}
+	}
+}
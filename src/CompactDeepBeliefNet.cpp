@@ -0,0 +1,275 @@
+#include <Eigen/Dense>
+
+#include <algorithm> // std::min, std::max
+#include <cstdint> // uint16_t, uint32_t
+#include <cstring> // std::memcpy
+#include <stdexcept> // std::invalid_argument
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+#include <DeepLearning/CompactDeepBeliefNet.h>
+#include <DeepLearning/RBM.h>
+#include <DeepLearning/utils.h>
+
+
+namespace DeepLearning {
+	namespace {
+		inline uint32_t floatToBits(float aValue) {
+			uint32_t bits;
+			std::memcpy(&bits, &aValue, sizeof(bits));
+			return bits;
+		}
+
+		inline float bitsToFloat(uint32_t bits) {
+			float value;
+			std::memcpy(&value, &bits, sizeof(value));
+			return value;
+		}
+
+		/** bfloat16 is the upper half of a float: round the lower half away, to nearest even */
+		inline uint16_t floatToBfloat16(float aValue) {
+			uint32_t bits = floatToBits(aValue);
+			if ((bits & 0x7fffffffu) > 0x7f800000u) { // NaN: keep it quiet, rounding could turn it into an infinity
+				return static_cast<uint16_t>((bits >> 16) | 0x0040u);
+			}
+			bits += 0x7fffu + ((bits >> 16) & 1u);
+			return static_cast<uint16_t>(bits >> 16);
+		}
+
+		inline float bfloat16ToFloat(uint16_t aValue) {
+			return bitsToFloat(static_cast<uint32_t>(aValue) << 16);
+		}
+
+		/** IEEE 754 binary16, round to nearest even, with subnormals. Overflows (>= 65520) give infinities. */
+		inline uint16_t floatToFloat16(float aValue) {
+			uint32_t bits = floatToBits(aValue);
+			const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+			bits &= 0x7fffffffu;
+			if (bits >= 0x7f800000u) { // infinity or NaN
+				return sign | 0x7c00u | (bits > 0x7f800000u ? 0x0200u : 0u);
+			}
+			if (bits >= 0x477ff000u) { // rounds to infinity
+				return sign | 0x7c00u;
+			}
+			if (bits < 0x38800000u) { // below 2^-14: subnormal or 0. Adding 0.5 lets the FPU round the mantissa at the 2^-24 position
+				return sign | static_cast<uint16_t>(floatToBits(bitsToFloat(bits) + 0.5f) - 0x3f000000u);
+			}
+			// Rebias the exponent from 127 to 15 and round the 13 lowest bits of the mantissa
+			bits += 0xc8000fffu + ((bits >> 13) & 1u);
+			return sign | static_cast<uint16_t>(bits >> 13);
+		}
+
+		inline float float16ToFloat(uint16_t aValue) {
+			const uint32_t sign = static_cast<uint32_t>(aValue & 0x8000u) << 16;
+			const uint32_t exponentMantissa = aValue & 0x7fffu;
+			// Shift into place and scale by 2^(127 - 15): this also normalizes the subnormals
+			uint32_t bits = floatToBits(bitsToFloat(exponentMantissa << 13) * bitsToFloat(0x77800000u));
+			// Infinities and NaN: saturate the exponent. Written without a branch so that the loops calling it can be vectorized
+			bits |= exponentMantissa >= 0x7c00u ? 0x7f800000u : 0u;
+			return bitsToFloat(sign | bits);
+		}
+
+		/** The loops below work on chunks of this many weights (see the chunked loops in utils.h) */
+		const Eigen_size_type chunk = halfPrecisionChunk;
+
+		/** Widens n contiguous 16 bits values into dest */
+		template <float (*widenValue)(uint16_t)>
+		void widenArray(const uint16_t* source, Eigen_size_type n, Scalar* dest) {
+			Eigen_size_type i = 0;
+			for (; i + chunk <= n; i += chunk) {
+				for (Eigen_size_type t = 0; t < chunk; ++t) {
+					dest[i + t] = widenValue(source[i + t]);
+				}
+			}
+			for (; i < n; ++i) {
+				dest[i] = widenValue(source[i]);
+			}
+		}
+
+		/** activations += W * data for a few columns of data, widening each weight in registers as it is used.
+		 * With one or two columns the product is bound by the memory bandwidth, so that reading W only once at 2 bytes per weight matters most.
+		 * Four columns of W are accumulated at a time to load and store the activations less often.
+		 */
+		template <float (*widenValue)(uint16_t)>
+		void widenedMatrixVectorProduct(const uint16_t* W, Eigen_size_type nOutput, Eigen_size_type nInput, const MatrixXs& data, MatrixXs& activations) {
+			for (Eigen_size_type k = 0; k < data.cols(); ++k) {
+				const Scalar* x = data.col(k).data();
+				Scalar* out = activations.col(k).data();
+				Eigen_size_type j = 0;
+				for (; j + 4 <= nInput; j += 4) {
+					const uint16_t *w0 = W + j * nOutput, *w1 = w0 + nOutput, *w2 = w1 + nOutput, *w3 = w2 + nOutput;
+					const Scalar x0 = x[j], x1 = x[j + 1], x2 = x[j + 2], x3 = x[j + 3];
+					Eigen_size_type r = 0;
+					for (; r + chunk <= nOutput; r += chunk) {
+						for (Eigen_size_type t = 0; t < chunk; ++t) {
+							out[r + t] += Scalar(widenValue(w0[r + t])) * x0 + Scalar(widenValue(w1[r + t])) * x1 + Scalar(widenValue(w2[r + t])) * x2 + Scalar(widenValue(w3[r + t])) * x3;
+						}
+					}
+					for (; r < nOutput; ++r) {
+						out[r] += Scalar(widenValue(w0[r])) * x0 + Scalar(widenValue(w1[r])) * x1 + Scalar(widenValue(w2[r])) * x2 + Scalar(widenValue(w3[r])) * x3;
+					}
+				}
+				for (; j < nInput; ++j) {
+					const uint16_t* w = W + j * nOutput;
+					for (Eigen_size_type r = 0; r < nOutput; ++r) {
+						out[r] += Scalar(widenValue(w[r])) * x[j];
+					}
+				}
+			}
+		}
+
+		/** Below this number of data columns, the forward products are computed with widenedMatrixVectorProduct.
+		 * Above it, each widened block is reused by enough columns for the widening cost to be amortized in a matrix-matrix product.
+		 */
+		const Eigen_size_type matrixVectorMaxColumns = 4;
+
+		/** Number of columns of W to widen at once, so that the widened block (nRows x columns Scalars) stays in the L2 cache */
+		Eigen_size_type widenedBlockColumns(Eigen_size_type nRows) {
+			const Eigen_size_type blockScalars = 128 * 1024 / sizeof(Scalar);
+			return std::max<Eigen_size_type>(1, blockScalars / std::max<Eigen_size_type>(nRows, 1));
+		}
+	}
+
+	CompactDeepBeliefNet::CompactDeepBeliefNet(const DeepBeliefNet& aDBN, WeightFormat aFormat): InferenceDeepBeliefNet(aDBN.getLayers(), aDBN.isUnrolled()),
+		myFormat(aFormat), myWeights(computeWeightsSize(myLayers)), myWeightOffsets() {
+		computeWeightOffsets();
+		for (size_t i = 0; i < aDBN.nRBMs(); ++i) {
+			const RBM rbm = aDBN.getRBM(i);
+			const Scalar* W = rbm.getWAsPtr();
+			uint16_t* compactW = myWeights.data() + myWeightOffsets[i];
+			for (Eigen_size_type j = 0; j < rbm.nWeights(); ++j) {
+				compactW[j] = narrow(W[j], myFormat);
+			}
+			myB.push_back(rbm.getB());
+			myC.push_back(rbm.getC());
+		}
+	}
+
+	CompactDeepBeliefNet::CompactDeepBeliefNet(const vector<Layer>& layers, WeightFormat aFormat, const shared_array_ptr<uint16_t>& someWeights,
+	                                           const vector<Scalar>& someBiases, bool isUnrolled): InferenceDeepBeliefNet(layers, isUnrolled),
+		myFormat(aFormat), myWeights(someWeights), myWeightOffsets() {
+		if (myWeights.size() != computeWeightsSize(myLayers) || someBiases.size() != computeBiasesSize(myLayers)) {
+			throw std::invalid_argument("The weights or biases do not match the layers");
+		}
+		computeWeightOffsets();
+		const Scalar* bias = someBiases.data();
+		for (size_t i = 0; i < nRBMs(); ++i) {
+			myB.push_back(Eigen::Map<const ArrayX1s>(bias, myLayers[i].getSize()));
+			bias += myLayers[i].getSize();
+			myC.push_back(Eigen::Map<const ArrayX1s>(bias, myLayers[i + 1].getSize()));
+			bias += myLayers[i + 1].getSize();
+		}
+	}
+
+	void CompactDeepBeliefNet::computeWeightOffsets() {
+		myWeightOffsets.clear();
+		size_t offset = 0;
+		for (size_t i = 0; i < nRBMs(); ++i) {
+			myWeightOffsets.push_back(offset);
+			offset += static_cast<size_t>(myLayers[i].getSize()) * myLayers[i + 1].getSize();
+		}
+	}
+
+	size_t CompactDeepBeliefNet::computeWeightsSize(const vector<Layer>& layers) {
+		size_t size = 0;
+		for (size_t i = 0; i + 1 < layers.size(); ++i) {
+			size += static_cast<size_t>(layers[i].getSize()) * layers[i + 1].getSize();
+		}
+		return size;
+	}
+
+	size_t CompactDeepBeliefNet::computeBiasesSize(const vector<Layer>& layers) {
+		size_t size = 0;
+		for (size_t i = 0; i + 1 < layers.size(); ++i) {
+			size += layers[i].getSize() + layers[i + 1].getSize();
+		}
+		return size;
+	}
+
+	vector<Scalar> CompactDeepBeliefNet::getBiases() const {
+		vector<Scalar> biases;
+		biases.reserve(computeBiasesSize(myLayers));
+		for (size_t i = 0; i < nRBMs(); ++i) {
+			biases.insert(biases.end(), myB[i].data(), myB[i].data() + myB[i].size());
+			biases.insert(biases.end(), myC[i].data(), myC[i].data() + myC[i].size());
+		}
+		return biases;
+	}
+
+	/* Products with the 16 bits weights */
+
+	void CompactDeepBeliefNet::forwardsProductInPlace(size_t i, const MatrixXs& data, MatrixXs& activations) const {
+		const Eigen_size_type nOutput = myLayers[i + 1].getSize(), nInput = myLayers[i].getSize();
+		const uint16_t* W = myWeights.getOffsetData() + myWeightOffsets[i];
+		const Eigen_size_type blockColumns = widenedBlockColumns(nOutput);
+		MatrixXs widened(nOutput, std::min(blockColumns, nInput));
+		activations = MatrixXs::Zero(nOutput, data.cols());
+		if (data.cols() <= matrixVectorMaxColumns) {
+			if (myFormat == bfloat16) {
+				widenedMatrixVectorProduct<bfloat16ToFloat>(W, nOutput, nInput, data, activations);
+			}
+			else {
+				widenedMatrixVectorProduct<float16ToFloat>(W, nOutput, nInput, data, activations);
+			}
+			return;
+		}
+		for (Eigen_size_type j = 0; j < nInput; j += blockColumns) {
+			const Eigen_size_type nColumns = std::min(blockColumns, nInput - j);
+			if (myFormat == bfloat16) {
+				widenArray<bfloat16ToFloat>(W + j * nOutput, nColumns * nOutput, widened.data());
+			}
+			else {
+				widenArray<float16ToFloat>(W + j * nOutput, nColumns * nOutput, widened.data());
+			}
+			activations.noalias() += widened.leftCols(nColumns) * data.middleRows(j, nColumns);
+		}
+	}
+
+	void CompactDeepBeliefNet::backwardsProductInPlace(size_t i, const MatrixXs& hidden, MatrixXs& activations) const {
+		const Eigen_size_type nOutput = myLayers[i + 1].getSize(), nInput = myLayers[i].getSize();
+		const uint16_t* W = myWeights.getOffsetData() + myWeightOffsets[i];
+		const Eigen_size_type blockColumns = widenedBlockColumns(nOutput);
+		MatrixXs widened(nOutput, std::min(blockColumns, nInput));
+		activations.resize(nInput, hidden.cols());
+		for (Eigen_size_type j = 0; j < nInput; j += blockColumns) {
+			const Eigen_size_type nColumns = std::min(blockColumns, nInput - j);
+			if (myFormat == bfloat16) {
+				widenArray<bfloat16ToFloat>(W + j * nOutput, nColumns * nOutput, widened.data());
+			}
+			else {
+				widenArray<float16ToFloat>(W + j * nOutput, nColumns * nOutput, widened.data());
+			}
+			activations.middleRows(j, nColumns).noalias() = widened.leftCols(nColumns).transpose() * hidden;
+		}
+	}
+
+	/* Formats */
+
+	uint16_t CompactDeepBeliefNet::narrow(Scalar aValue, WeightFormat aFormat) {
+		return aFormat == bfloat16 ? floatToBfloat16(static_cast<float>(aValue)) : floatToFloat16(static_cast<float>(aValue));
+	}
+
+	Scalar CompactDeepBeliefNet::widen(uint16_t aValue, WeightFormat aFormat) {
+		return aFormat == bfloat16 ? bfloat16ToFloat(aValue) : float16ToFloat(aValue);
+	}
+
+	string CompactDeepBeliefNet::getFormatAsString() const {
+		switch(myFormat) {
+			case(bfloat16): return "bfloat16";
+			case(float16): return "float16";
+		};
+		throw std::invalid_argument("Unknown weight format!");
+	}
+
+	CompactDeepBeliefNet::WeightFormat CompactDeepBeliefNet::formatFromString(const string& formatStr) {
+		if (formatStr == "bfloat16") {
+			return bfloat16;
+		}
+		else if (formatStr == "float16") {
+			return float16;
+		}
+		throw std::invalid_argument("Unknown weight format string: " + formatStr + "!");
+	}
+}
@@ -1,8 +1,6 @@
 #include <Rcpp.h>
 
 #include <Eigen/Dense>
-using Eigen::MatrixXd;
-using Eigen::ArrayXXd;
 #include <boost/range/adaptor/reversed.hpp> // boost::adaptors::reverse
 
 #include <vector>
@@ -47,7 +45,7 @@ void DeepBeliefNet::constructRBMs() {
 /** Constructs someRBMs and binds them to someData as required by the layout of someLayers.
  * Static method that modifies someRBMs in place. Does not modifies the layer or someData (will take pointers on it though)
  */
-void DeepBeliefNet::constructRBMs(vector<RBM>& someRBMs, const vector<Layer>& someLayers, const shared_array_ptr<double>& someData) {
+void DeepBeliefNet::constructRBMs(vector<RBM>& someRBMs, const vector<Layer>& someLayers, const shared_array_ptr<Scalar>& someData) {
 	someRBMs.clear();
 	size_t nRBMs = someLayers.size() - 1;
 	someRBMs.reserve(nRBMs);
@@ -69,7 +67,7 @@ DeepBeliefNet DeepBeliefNet::unroll() const {
 	size_t newDataSize = computeDataSize(newLayers);
 	
 	/* Create the new DeepBeliefNet object */
-	shared_array_ptr<double> newData(new double[newDataSize], newDataSize, true); // true: let this DBN manage the data
+	shared_array_ptr<Scalar> newData(new Scalar[newDataSize], newDataSize, true); // true: let this DBN manage the data
 	                                                   //, because the pointer will be lost as soon as we return anyway.
 	DeepBeliefNet newDBN(newLayers, newData);
 	
@@ -118,19 +116,12 @@ DeepBeliefNet DeepBeliefNet::reverse() const { // returns a reversed clone of th
 	return newDBN;
 }
 
-/*DeepBeliefNet& DeepBeliefNet::pretrain(const MatrixXdMap& data, const PretrainParameters& params) {
-	MatrixXd tmpdata(data);
+/*DeepBeliefNet& DeepBeliefNet::pretrain(const MatrixXsMap& data, const PretrainParameters& params) {
+	MatrixXs tmpdata(data);
 	return pretrainModifyingData(tmpdata, params);
 }*/
 
-DeepBeliefNet& DeepBeliefNet::pretrain(MatrixXd data, const vector<PretrainParameters>& params, PretrainProgress& aProgressFunctor, ContinueFunction& aContinueFunction, const vector<size_t>& skip) {
-	return pretrainModifyingData(data, params, aProgressFunctor, aContinueFunction, skip);
-}
-
-DeepBeliefNet& DeepBeliefNet::pretrainModifyingData(MatrixXd& data, const vector<PretrainParameters>& params, PretrainProgress& aProgressFunctor, ContinueFunction& aContinueFunction, const vector<size_t>& skip) {
-	// Print some output to let the user know we're doing something
-	Rcpp::Rcout << "Pre-training " << myLayers.front().getSize() << " - " << myLayers.back().getSize() << " network with " << nLayers() << " layers" << std::endl;
-
+void DeepBeliefNet::printSkipped(const vector<size_t>& skip) {
 	if (skip.size() > 0) {
 		Rcpp::Rcout << "Ignoring the following layers: ";
 		for (size_t layer: skip) {
@@ -138,23 +129,97 @@ DeepBeliefNet& DeepBeliefNet::pretrainModifyingData(MatrixXd& data, const vector
 		}
 		Rcpp::Rcout << std::endl;
 	}
+}
+
+void DeepBeliefNet::pretrainLayer(size_t i, const BatchSource& data, const PretrainParameters& params, PretrainProgress& aProgressFunctor, ContinueFunction& aContinueFunction, const vector<size_t>& skip) {
+	if (isIn(skip, i + 1)) {
+		Rcpp::Rcout << "Skipping " << myRBMs[i].getInput().getSize() << "-" << myRBMs[i].getInput().getTypeAsString() << " x "
+		            << myRBMs[i].getOutput().getSize() << "-" << myRBMs[i].getOutput().getTypeAsString() << " RBM " << std::endl;
+		return;
+	}
+	aProgressFunctor.setBatchSize(params.batchSize);
+	aProgressFunctor.setMaxIters(params.maxIters);
+	aProgressFunctor.setLayer(i);
+	aContinueFunction.setLayer(i);
+	// Pretrain each layer, with its own random streams
+	PretrainParameters layerParams = params;
+	layerParams.setLayer(i);
+	myRBMs[i].pretrain(data, layerParams, aProgressFunctor, aContinueFunction);
+}
+
+DeepBeliefNet& DeepBeliefNet::pretrain(const DataRef& data, const vector<PretrainParameters>& params, PretrainProgress& aProgressFunctor, ContinueFunction& aContinueFunction, const vector<size_t>& skip) {
+	// Print some output to let the user know we're doing something
+	Rcpp::Rcout << "Pre-training " << myLayers.front().getSize() << " - " << myLayers.back().getSize() << " network with " << nLayers() << " layers" << std::endl;
+	printSkipped(skip);
+
+	// The data of the first layer is used in place. The next layers get the propagated data in the same layout
+	const bool rowLayout = hasSamplesAsRows(data);
+	MatrixXs layerData, nextLayerData;
+	for (size_t i = 0; i < myRBMs.size(); ++i) {
+		const DataRef currentData = i == 0 ? data : rowLayout ? DataRef(samplesAsColumns(layerData)) : DataRef(layerData);
+		pretrainLayer(i, BatchSource(currentData), params[i], aProgressFunctor, aContinueFunction, skip);
+		// Pass the data through the layer
+		if (i < myRBMs.size() - 1) {
+			if (rowLayout) {
+				myRBMs[i].predictSamplesAsRows(samplesAsRows(currentData), nextLayerData);
+			}
+			else {
+				myRBMs[i].forwardsDataToActivitiesInPlace(currentData, nextLayerData);
+			}
+			layerData.swap(nextLayerData);
+			aProgressFunctor.propagateData(myRBMs[i]);
+		}
+	}
+	pretrained = true;
+	return *this;
+}
+
+DeepBeliefNet& DeepBeliefNet::pretrain(const MappedDataset& aDataset, const vector<PretrainParameters>& params, PretrainProgress& aProgressFunctor, ContinueFunction& aContinueFunction, const vector<size_t>& skip) {
+	Rcpp::Rcout << "Pre-training " << myLayers.front().getSize() << " - " << myLayers.back().getSize() << " network with " << nLayers() << " layers"
+	            << " from " << aDataset.getPath() << std::endl;
+	printSkipped(skip);
+
+	// The batches are forwarded through copies of the layers below as they were when pre-trained, as the data would have been propagated:
+	// training the b of a layer modifies the c of the layer below
+	vector<RBM> frozenLayers;
+	frozenLayers.reserve(myRBMs.size());
+	vector<const RBM*> layersBelow;
+	for (size_t i = 0; i < myRBMs.size(); ++i) {
+		pretrainLayer(i, BatchSource(aDataset, layersBelow), params[i], aProgressFunctor, aContinueFunction, skip);
+		frozenLayers.push_back(myRBMs[i].clone());
+		layersBelow.push_back(&frozenLayers.back());
+		if (i < myRBMs.size() - 1) {
+			aProgressFunctor.propagateData(myRBMs[i]);
+		}
+	}
+	pretrained = true;
+	return *this;
+}
+
+DeepBeliefNet& DeepBeliefNet::pretrain(const SparseMatrixXs& data, const vector<PretrainParameters>& params, PretrainProgress& aProgressFunctor, ContinueFunction& aContinueFunction, const vector<size_t>& skip) {
+	Rcpp::Rcout << "Pre-training " << myLayers.front().getSize() << " - " << myLayers.back().getSize() << " network with " << nLayers() << " layers"
+	            << " from sparse data" << std::endl;
+	printSkipped(skip);
 
+	// Only the first layer sees the sparse data: its activities are dense
+	MatrixXs layerData, nextLayerData;
 	for (size_t i = 0; i < myRBMs.size(); ++i) {
-		if (isIn(skip, i + 1)) {
-			Rcpp::Rcout << "Skipping " << myRBMs[i].getInput().getSize() << "-" << myRBMs[i].getInput().getTypeAsString() << " x "
-			            << myRBMs[i].getOutput().getSize() << "-" << myRBMs[i].getOutput().getTypeAsString() << " RBM " << std::endl;
+		if (i == 0) {
+			pretrainLayer(i, BatchSource(data), params[i], aProgressFunctor, aContinueFunction, skip);
 		}
 		else {
-			aProgressFunctor.setBatchSize(params[i].batchSize);
-			aProgressFunctor.setMaxIters(params[i].maxIters);
-			aProgressFunctor.setLayer(i);
-			aContinueFunction.setLayer(i);
-			// Pretrain each layer
-			myRBMs[i].pretrain(data, params[i], aProgressFunctor, aContinueFunction);	
+			const DataRef currentData(layerData);
+			pretrainLayer(i, BatchSource(currentData), params[i], aProgressFunctor, aContinueFunction, skip);
 		}
 		// Pass the data through the layer
 		if (i < myRBMs.size() - 1) {
-			myRBMs[i].predictInPlace(data);
+			if (i == 0) {
+				myRBMs[i].forwardsDataToActivitiesInPlace(data, nextLayerData);
+			}
+			else {
+				myRBMs[i].forwardsDataToActivitiesInPlace(layerData, nextLayerData);
+			}
+			layerData.swap(nextLayerData);
 			aProgressFunctor.propagateData(myRBMs[i]);
 		}
 	}
@@ -162,24 +227,50 @@ DeepBeliefNet& DeepBeliefNet::pretrainModifyingData(MatrixXd& data, const vector
 	return *this;
 }
 
-MatrixXd DeepBeliefNet::predict(MatrixXd data) const { // work on a copy of data
+MatrixXs DeepBeliefNet::predict(MatrixXs data) const { // work on a copy of data
 	predictInPlace(data);
 	return data;
 }
 
-void DeepBeliefNet::predictInPlace(MatrixXd& data) const {
+void DeepBeliefNet::predictInPlace(MatrixXs& data) const {
 	size_t lastLayerToPredict = unrolled ? myRBMs.size() / 2 : myRBMs.size();
 	for (size_t i = 0; i < lastLayerToPredict; ++i) {
 		data = myRBMs[i].predict(data);
 	}
 }
 
-MatrixXd DeepBeliefNet::reverse_predict(MatrixXd hidden) const {
+MatrixXs DeepBeliefNet::predict(const SparseMatrixXs& data) const {
+	size_t lastLayerToPredict = unrolled ? myRBMs.size() / 2 : myRBMs.size();
+	if (lastLayerToPredict == 0) {
+		return MatrixXs(data);
+	}
+	MatrixXs predictions = myRBMs[0].predict(data);
+	for (size_t i = 1; i < lastLayerToPredict; ++i) {
+		predictions = myRBMs[i].predict(predictions);
+	}
+	return predictions;
+}
+
+void DeepBeliefNet::predictSamplesAsRows(const Eigen::Ref<const MatrixXs>& samples, MatrixXs& predictions) const {
+	size_t lastLayerToPredict = unrolled ? myRBMs.size() / 2 : myRBMs.size();
+	if (lastLayerToPredict == 0) {
+		predictions = samples;
+		return;
+	}
+	myRBMs[0].predictSamplesAsRows(samples, predictions);
+	MatrixXs nextPredictions;
+	for (size_t i = 1; i < lastLayerToPredict; ++i) {
+		myRBMs[i].predictSamplesAsRows(predictions, nextPredictions);
+		predictions.swap(nextPredictions);
+	}
+}
+
+MatrixXs DeepBeliefNet::reverse_predict(MatrixXs hidden) const {
 	reverse_predictInPlace(hidden);
 	return hidden;
 }
 
-void DeepBeliefNet::reverse_predictInPlace(MatrixXd& hidden) const {
+void DeepBeliefNet::reverse_predictInPlace(MatrixXs& hidden) const {
 	if (unrolled) {
 		size_t firstLayerToPredict = myRBMs.size() / 2;
 		for (size_t i = firstLayerToPredict; i < myRBMs.size(); ++i) {
@@ -193,62 +284,62 @@ void DeepBeliefNet::reverse_predictInPlace(MatrixXd& hidden) const {
 	}
 }
 
-MatrixXd DeepBeliefNet::reconstruct(MatrixXd data) const { // work on a copy of data
+MatrixXs DeepBeliefNet::reconstruct(MatrixXs data) const { // work on a copy of data
 	reconstructInPlace(data);
 	return data;
 }
 
-void DeepBeliefNet::reconstructInPlace(MatrixXd& data) const {
+void DeepBeliefNet::reconstructInPlace(MatrixXs& data) const {
 	predictInPlace(data);
 	reverse_predictInPlace(data);
 }
 
-DeepBeliefNet& DeepBeliefNet::applyData(double* newWeights) {
+DeepBeliefNet& DeepBeliefNet::applyData(Scalar* newWeights) {
 	size_t oldSize = myData.size();
-	shared_array_ptr<double> newPtr(newWeights, oldSize, false); // false: the pointer is managed by the client
+	shared_array_ptr<Scalar> newPtr(newWeights, oldSize, false); // false: the pointer is managed by the client
 	applyData(newPtr); // calls the method for a shared_array_ptr. That one will call constructRBM().
 	return *this;
 }
 
-DeepBeliefNet& DeepBeliefNet::applyData(shared_array_ptr<double>& newWeights) {
+DeepBeliefNet& DeepBeliefNet::applyData(shared_array_ptr<Scalar>& newWeights) {
 	myData = newWeights;
 	constructRBMs();
 	return *this;
 }
 	
-DeepBeliefNet& DeepBeliefNet::applyDataIfNeeded(double* newWeights) {
+DeepBeliefNet& DeepBeliefNet::applyDataIfNeeded(Scalar* newWeights) {
 	if (getData().data() != newWeights) {
 		applyData(newWeights);
 	}
 	return *this;
 }
 	
-DeepBeliefNet& DeepBeliefNet::applyDataIfNeeded(shared_array_ptr<double>& newWeights) {
+DeepBeliefNet& DeepBeliefNet::applyDataIfNeeded(shared_array_ptr<Scalar>& newWeights) {
 	if (getData() != newWeights) {
 		applyData(newWeights);
 	}
 	return *this;
 }
 
-ArrayX1d DeepBeliefNet::error(const MatrixXd& data) const {
-	MatrixXd reconstructions = reconstruct(data);
+ArrayX1s DeepBeliefNet::error(const MatrixXs& data) const {
+	MatrixXs reconstructions = reconstruct(data);
 	return error(data, reconstructions);
 }
 
-ArrayX1d DeepBeliefNet::error(const MatrixXd& data, const MatrixXd& reconstructions) const {
+ArrayX1s DeepBeliefNet::error(const MatrixXs& data, const MatrixXs& reconstructions) const {
 	return (reconstructions.array() - data.array()).square().colwise().mean().sqrt();
 }
 
-double DeepBeliefNet::errorSum(const MatrixXd& data) const {
+double DeepBeliefNet::errorSum(const MatrixXs& data) const {
 	return error(data).sum();
 }
 
-double DeepBeliefNet::errorSum(const MatrixXd& data, const MatrixXd& reconstructions) const {
+double DeepBeliefNet::errorSum(const MatrixXs& data, const MatrixXs& reconstructions) const {
 	return error(data, reconstructions).sum();
 }
 
-ArrayX1d DeepBeliefNet::energy(MatrixXd data) const {
-	ArrayX1d theEnergy = myRBMs[0].energy(data);
+ArrayX1s DeepBeliefNet::energy(MatrixXs data) const {
+	ArrayX1s theEnergy = myRBMs[0].energy(data);
 	for (size_t layer = 1; layer < myRBMs.size(); ++layer) {
 		data = myRBMs[layer - 1].predict(data);
 		theEnergy += myRBMs[layer].predict(data).array();
@@ -256,19 +347,28 @@ ArrayX1d DeepBeliefNet::energy(MatrixXd data) const {
 	return theEnergy;
 }
 
-double DeepBeliefNet::energySum(const MatrixXd& data) const {
+double DeepBeliefNet::energySum(const MatrixXs& data) const {
 	return energy(data).sum();
 }
 
-MatrixXd DeepBeliefNet::sample(MatrixXd data) const { // work on a copy of data
+MatrixXs DeepBeliefNet::sample(MatrixXs data) const { // work on a copy of data
 	sampleInPlace(data);
 	return data;
 }
 
-void DeepBeliefNet::sampleInPlace(MatrixXd& data) const {
+void DeepBeliefNet::sampleInPlace(MatrixXs& data) const {
+	sampleInPlace(data, randomSeed());
+}
+
+MatrixXs DeepBeliefNet::sample(MatrixXs data, uint64_t aSeed) const { // work on a copy of data
+	sampleInPlace(data, aSeed);
+	return data;
+}
+
+void DeepBeliefNet::sampleInPlace(MatrixXs& data, uint64_t aSeed) const {
 	size_t lastLayerToPredict = myRBMs.size();
 	for (size_t i = 0; i < lastLayerToPredict; ++i) {
-		data = myRBMs[i].sample(data);
+		data = myRBMs[i].sample(data, aSeed, i);
 	}
 }
 
@@ -1,13 +1,15 @@
-/* This file implements the training (conjugate gradients) part of the DeepBeliefNet.
+/* This file implements the training (conjugate gradients, or first-order sgd and adam) part of the DeepBeliefNet.
 */
 #include <Eigen/Dense>
-using Eigen::MatrixXd;
-using Eigen::ArrayXXd;
 #include <Rcpp.h> // Rcpp::checkUserInterrupt
 #include "boost/numeric/conversion/cast.hpp"
 
+#include <algorithm> // std::fill, std::min
+#include <cmath> // std::pow, std::sqrt
 #include <iostream>
-#include <stdexcept> // std::runtime_error
+#include <memory> // std::unique_ptr
+#include <numeric> // std::accumulate
+#include <stdexcept> // std::invalid_argument, std::runtime_error
 #include <string>
 #include <utility> // std::size_t
 #include <vector>
@@ -19,48 +21,145 @@ using std::string;
 
 #include <DeepLearning/DeepBeliefNet.h>
 #include <DeepLearning/typedefs.h>
-#include "R_optim.h" // cgmin
+#include "R_optim.h" // cgmin, lbfgs
+#include "BatchPrefetcher.h"
 #include "Random.h"
+#include "ThreadPool.h"
 #include <shared_array_ptr.h>
 using namespace DeepLearning;
 
 
 namespace DeepLearning {
+/** Returns the first column of each of the nPartitions partitions of a matrix of nColumns columns, and nColumns as last element */
+vector<Eigen_size_type> partitionColumns(Eigen_size_type, size_t);
+vector<Eigen_size_type> partitionColumns(Eigen_size_type nColumns, size_t nPartitions) {
+	vector<Eigen_size_type> bounds(nPartitions + 1);
+	const Eigen_size_type nPartitionsEigen = boost::numeric_cast<Eigen_size_type>(nPartitions);
+	for (Eigen_size_type p = 0; p <= nPartitionsEigen; ++p) {
+		bounds[boost::numeric_cast<size_t>(p)] = p * nColumns / nPartitionsEigen;
+	}
+	return bounds;
+}
+
+/** The buffers are zeroed once: the gradients overwrite all the elements they write,
+ * and the elements they never write (the b of the RBMs of the unrolled network) must stay 0.
+ */
+void PartitionGradients::reserve(const vector<Layer>& layers, size_t dataSize, size_t nPartitions) {
+	if (rbms.size() == nPartitions && (data.empty() || data.front().size() == dataSize)) return;
+	data.clear();
+	rbms.clear();
+	rbms.resize(nPartitions);
+	data.reserve(nPartitions - 1);
+	for (size_t p = 1; p < nPartitions; ++p) {
+		data.push_back(shared_array_ptr<Scalar>(dataSize));
+		std::fill(data.back().data(), data.back().data() + dataSize, Scalar(0));
+		DeepBeliefNet::constructRBMs(rbms[p], layers, data.back());
+	}
+}
+
+namespace {
+/** Runs partitionGradient(p, rbms) for the nPartitions partitions of the data on the threads of the pool, and sums the gradients into gradientRBMs.
+ * The first partition writes directly into gradientRBMs, the others into the buffers of partials (see PartitionGradients).
+ * The buffers are then summed into gradientRBMs, with the threads working on separate slices of the weights.
+ * Elements that the gradient never writes (the b of the first layer) are zero in the buffers and stay untouched in gradientRBMs.
+ */
+template <typename PartitionGradient>
+void sumPartitionGradients(const vector<Layer>& layers, size_t dataSize, size_t nPartitions, vector<RBM>& gradientRBMs, ThreadPool& pool,
+                           PartitionGradients& partials, const PartitionGradient& partitionGradient) {
+	partials.reserve(layers, dataSize, nPartitions);
+	
+	pool.parallelFor(nPartitions, [&](size_t p) {
+		partitionGradient(p, p == 0 ? gradientRBMs : partials.rbms[p]);
+	});
+	
+	// Reduce: gradientRBMs += partials.rbms[1..nPartitions-1]
+	Scalar* gradientData = gradientRBMs[0].getData().data();
+	const vector<Eigen_size_type> slices = partitionColumns(boost::numeric_cast<Eigen_size_type>(dataSize), pool.size());
+	pool.parallelFor(pool.size(), [&](size_t slice) {
+		const Eigen_size_type sliceSize = slices[slice + 1] - slices[slice];
+		Eigen::Map<ArrayX1s> target(gradientData + slices[slice], sliceSize);
+		for (const shared_array_ptr<Scalar>& partial: partials.data) {
+			target += Eigen::Map<const ArrayX1s>(partial.data() + slices[slice], sliceSize);
+		}
+	});
+}
+
+/** Runs the forward pass of the batch at the current weights of the DBN into the cache of params, unless the cache already holds it,
+ * and returns the error. With a pool, each partition of the columns of the batch has its own forward pass, run on the threads of the pool.
+ */
+double forwardsCached(OptimParameters& params) {
+	const DeepBeliefNet& dbn = params.dbn;
+	const MatrixXs& batch = params.batch;
+	if (params.cacheValid && params.cachedVersion == params.weightsVersion) {
+		return params.cachedF;
+	}
+	
+	const size_t nPartitions = params.pool == nullptr ? 1 : std::max<size_t>(1, std::min(params.pool->size(), boost::numeric_cast<size_t>(batch.cols())));
+	params.cachedActivations.resize(nPartitions);
+	params.cachedActivities.resize(nPartitions);
+	vector<double> partialF(nPartitions, 0.0);
+	if (nPartitions == 1) {
+		dbn.forwards(batch, params.cachedActivations[0], params.cachedActivities[0]);
+		partialF[0] = dbn.errorSum(batch, params.cachedActivities[0].back());
+	}
+	else {
+		const vector<Eigen_size_type> bounds = partitionColumns(batch.cols(), nPartitions);
+		params.pool->parallelFor(nPartitions, [&](size_t p) {
+			const MatrixXs partition = batch.middleCols(bounds[p], bounds[p + 1] - bounds[p]);
+			dbn.forwards(partition, params.cachedActivations[p], params.cachedActivities[p]);
+			partialF[p] = dbn.errorSum(partition, params.cachedActivities[p].back());
+		});
+	}
+	
+	params.cachedVersion = params.weightsVersion;
+	params.cachedF = std::accumulate(partialF.begin(), partialF.end(), 0.0);
+	params.cacheValid = true;
+	return params.cachedF;
+}
+}
+
 double my_f (OptimParameters&);
 double my_f (OptimParameters& params) {
-	DeepBeliefNet& dbn = params.dbn;
-	Eigen::MatrixXd& batch = params.batch;
-	
-	// Pass the data to compute error
-	double f = dbn.errorSum(batch);
-	return f;
+	// Pass the data to compute error, keeping the activations for the gradient
+	return forwardsCached(params);
 }
 
 
 /** The gradient of f, df = (df/dx, df/dy). 
  * *df: the gradients
  * *rawParams: additional OptimParameters object passad as void pointer
+ * Only the backpropagation runs when my_f was just evaluated at the same weights; otherwise the forward pass is cached for my_f.
  */
-void my_df (double *df, OptimParameters&);
-void my_df (double *df, OptimParameters& params) {
+void my_df (Scalar *df, OptimParameters&);
+void my_df (Scalar *df, OptimParameters& params) {
 	DeepBeliefNet& dbn = params.dbn;
-	Eigen::MatrixXd& batch = params.batch;
+	MatrixXs& batch = params.batch;
 	vector<RBM>& gradientRBMs = params.gradientRBMs;
 	
 	// Also apply the data to the gradientRBMs vector if needed
 	if (gradientRBMs.empty() || df != gradientRBMs[0].getData().data()) {
-		shared_array_ptr<double> newData(df, dbn.getData().size(), false);
+		shared_array_ptr<Scalar> newData(df, dbn.getData().size(), false);
 		DeepBeliefNet::constructRBMs(gradientRBMs, dbn.getLayers(), newData);
 	}
 
-	dbn.getGradient(batch, gradientRBMs);
+	forwardsCached(params);
+	const vector<vector<MatrixXs>>& activations = params.cachedActivations;
+	const vector<vector<MatrixXs>>& activities = params.cachedActivities;
+	if (activations.size() == 1) {
+		dbn.backwards(batch, activations[0], activities[0], gradientRBMs);
+	}
+	else {
+		sumPartitionGradients(dbn.getLayers(), dbn.getData().size(), activations.size(), gradientRBMs, *params.pool, params.partitionGradients, [&](size_t p, vector<RBM>& rbms) {
+			dbn.backwards(activities[p][0], activations[p], activities[p], rbms);
+		});
+	}
 }
 
 
 /** Returns the gradient of the DeepBeliefNet related with the provided data in a vector<RBM>
  * This gradient can be used for backpropagation or other puroposes
  */
-vector<RBM> DeepBeliefNet::getGradient(const MatrixXd& data, shared_array_ptr<double> df) {
+vector<RBM> DeepBeliefNet::getGradient(const MatrixXs& data, shared_array_ptr<Scalar> df) {
 	vector<RBM> gradientRBMs; // the Bolzman Machines
 	constructRBMs(gradientRBMs, myLayers, df);
 	getGradient(data, gradientRBMs);
@@ -69,15 +168,15 @@ vector<RBM> DeepBeliefNet::getGradient(const MatrixXd& data, shared_array_ptr<do
 
 
 /** Derivative activation function of a binary layer */
-MatrixXd binaryActivationDerivative(MatrixXd&);
-MatrixXd binaryActivationDerivative(MatrixXd& activations) {
-	ArrayXXd minusActivationsExp = (-(activations.array())).exp();
+MatrixXs binaryActivationDerivative(const MatrixXs&);
+MatrixXs binaryActivationDerivative(const MatrixXs& activations) {
+	ArrayXXs minusActivationsExp = (-(activations.array())).exp();
 	return (minusActivationsExp / (minusActivationsExp + 1).square()).matrix();
 }
 
 /** Derivative activation function of a unit continuous layer */
-MatrixXd continuousActivationDerivative(MatrixXd&);
-MatrixXd continuousActivationDerivative(MatrixXd& activations) {
+MatrixXs continuousActivationDerivative(const MatrixXs&);
+MatrixXs continuousActivationDerivative(const MatrixXs& activations) {
 	auto activationsArray = activations.array();
 	return (activationsArray.abs() < 10e-3).select(
 		1 / 12 - activationsArray.square() / 240,
@@ -89,30 +188,42 @@ MatrixXd continuousActivationDerivative(MatrixXd& activations) {
 /** Computes the gradient of the DeepBeliefNet related with the provided data into gradientRBMs (vector<RBM>)
  * This gradient can be used for backpropagation or other puroposes.
  */
-void DeepBeliefNet::getGradient(const MatrixXd& data, vector<RBM>& gradientRBMs, double* f) {
+void DeepBeliefNet::getGradient(const MatrixXs& data, vector<RBM>& gradientRBMs, double* f) {
+	vector<MatrixXs> activations, activities;
+	forwards(data, activations, activities);
+	
+	// Compute error if a pointer was supplied
+	if (f != nullptr) {
+		*f = errorSum(data, activities.back()); 
+	}
+	
+	backwards(data, activations, activities, gradientRBMs);
+}
+
+void DeepBeliefNet::forwards(const MatrixXs& data, vector<MatrixXs>& activations, vector<MatrixXs>& activities) const {
 	if (!unrolled) {
 		throw std::runtime_error("You must unroll the DBN before calling getGradient.");
 	}
 	
-	// compute the gradient and put it in *df
 	// Pass up and compute activations & activities
 	size_t L = myRBMs.size();
-	vector<MatrixXd> activations(L + 1), activities(L + 1), deltas(L + 1);
+	activations.resize(L + 1);
+	activities.resize(L + 1);
 	activities[0] = data; // activities of layer 0 is the data... not sure it makes sense or will be convenient later on...
 	
 	// Compute activations and activities for all layers
 	for (size_t l = 0; l < L; ++l) {
-		RBM& layer = myRBMs[l];
+		const RBM& layer = myRBMs[l];
 		activations[l + 1] = layer.forwardsDataToActivations(activities[l]);
 		activities[l + 1] = layer.forwardsActivationsToActivities(activations[l + 1]);
 	}
-	const MatrixXd& reconstructions = activities[L];
-	
-	// Compute error if a pointer was supplied
-	if (f != nullptr) {
-		*f = errorSum(data, reconstructions); 
-	}
+}
 
+void DeepBeliefNet::backwards(const MatrixXs& data, const vector<MatrixXs>& activations, const vector<MatrixXs>& activities, vector<RBM>& gradientRBMs) const {
+	size_t L = myRBMs.size();
+	vector<MatrixXs> deltas(L + 1);
+	const MatrixXs& reconstructions = activities[L];
+	
 	// Error gradient on last layer
 	Layer::Type outputType = myLayers[L].getType();
 	if (outputType == Layer::binary) {
@@ -129,7 +240,7 @@ void DeepBeliefNet::getGradient(const MatrixXd& data, vector<RBM>& gradientRBMs,
 	for (size_t l = L - 1; l > 0; --l) {
 		const RBM& currentRBM = myRBMs[l];
 		outputType = currentRBM.getInput().getType();
-		const MatrixXdMap& currentW = currentRBM.getW();
+		const MatrixXsMap& currentW = currentRBM.getW();
 		
 		if (outputType == Layer::binary) {
 			deltas[l] = binaryActivationDerivative(activations[l]).array() * (currentW.transpose() * deltas[l + 1]).array();
@@ -149,11 +260,111 @@ void DeepBeliefNet::getGradient(const MatrixXd& data, vector<RBM>& gradientRBMs,
 	}
 }
 
-DeepBeliefNet& DeepBeliefNet::train(const MatrixXd& data, const TrainParameters& params, TrainProgress& aProgressFunctor, const ContinueFunction& aContinueFunction) {
+/** Data-parallel version of getGradient: each partition of the columns of data computes its gradient on a thread of the pool,
+ * and the partial gradients are summed into gradientRBMs (see sumPartitionGradients).
+ */
+void DeepBeliefNet::getGradient(const MatrixXs& data, vector<RBM>& gradientRBMs, ThreadPool& pool, double* f) {
+	PartitionGradients buffers;
+	getGradient(data, gradientRBMs, pool, buffers, f);
+}
+
+void DeepBeliefNet::getGradient(const MatrixXs& data, vector<RBM>& gradientRBMs, ThreadPool& pool, PartitionGradients& buffers, double* f) {
+	const size_t nPartitions = std::min(pool.size(), boost::numeric_cast<size_t>(data.cols()));
+	if (nPartitions <= 1) {
+		getGradient(data, gradientRBMs, f);
+		return;
+	}
+	
+	const vector<Eigen_size_type> bounds = partitionColumns(data.cols(), nPartitions);
+	vector<double> partialF(nPartitions, 0.0);
+	sumPartitionGradients(myLayers, myData.size(), nPartitions, gradientRBMs, pool, buffers, [&](size_t p, vector<RBM>& rbms) {
+		const MatrixXs partition = data.middleCols(bounds[p], bounds[p + 1] - bounds[p]);
+		getGradient(partition, rbms, f == nullptr ? nullptr : &partialF[p]);
+	});
+	
+	if (f != nullptr) {
+		*f = std::accumulate(partialF.begin(), partialF.end(), 0.0);
+	}
+}
+
+namespace {
+/** State of the first-order optimizers (sgd and adam) across the iterations of train:
+ * the gradient, with RBMs bound to it so that getGradient writes straight into it, and the velocities (sgd) or moments (adam) of the weights.
+ */
+struct FirstOrderOptimizer {
+	shared_array_ptr<Scalar> gradient;
+	vector<RBM> gradientRBMs;
+	PartitionGradients partitionGradients; // with a pool, the gradients of the partitions of the batch
+	ArrayX1s velocity, squares;
+	
+	FirstOrderOptimizer(const DeepBeliefNet& aDBN, const TrainParameters& params): gradient(aDBN.getData().size()), gradientRBMs(), partitionGradients(),
+		velocity(ArrayX1s::Zero(boost::numeric_cast<Eigen_size_type>(aDBN.getData().size()))),
+		squares(params.optimizer == TrainParameters::adam ? ArrayX1s::Zero(boost::numeric_cast<Eigen_size_type>(aDBN.getData().size())) : ArrayX1s()) {
+		// getGradient never writes the b of the first layer: it must stay 0
+		std::fill(gradient.data(), gradient.data() + gradient.size(), Scalar(0));
+		DeepBeliefNet::constructRBMs(gradientRBMs, aDBN.getLayers(), gradient);
+	}
+	
+	/** Computes the gradient of aDBN on batch, and moves the weights of aDBN by one step against the gradient averaged over the batch.
+	 * Returns the error of the batch before the step.
+	 */
+	double step(DeepBeliefNet& aDBN, const MatrixXs& batch, ThreadPool* pool, const TrainParameters& params, unsigned int iteration) {
+		double f = 0;
+		if (pool == nullptr) {
+			aDBN.getGradient(batch, gradientRBMs, &f);
+		}
+		else {
+			aDBN.getGradient(batch, gradientRBMs, *pool, partitionGradients, &f);
+		}
+		
+		ArrayX1sMap weights(aDBN.getData().data(), velocity.size());
+		const Eigen::Map<const ArrayX1s> gradientSum(gradient.data(), velocity.size());
+		const double batchSize = boost::numeric_cast<double>(batch.cols());
+		const double learningRate = params.getLearningRate(iteration);
+		if (params.optimizer == TrainParameters::adam) {
+			velocity = params.beta1 * velocity + (1 - params.beta1) / batchSize * gradientSum;
+			squares = params.beta2 * squares + (1 - params.beta2) / (batchSize * batchSize) * gradientSum.square();
+			// Bias corrections, folded into the learning rate and optimizerEpsilon
+			const double correction1 = 1 - std::pow(params.beta1, iteration), correction2 = 1 - std::pow(params.beta2, iteration);
+			weights -= (learningRate * std::sqrt(correction2) / correction1) * velocity / (squares.sqrt() + params.optimizerEpsilon * std::sqrt(correction2));
+		}
+		else {
+			velocity = params.momentum * velocity - learningRate / batchSize * gradientSum;
+			weights += velocity;
+		}
+		return f;
+	}
+};
+}
+
+double DeepBeliefNet::errorSum(const MatrixXs& data, ThreadPool& pool) const {
+	const size_t nPartitions = std::min(pool.size(), boost::numeric_cast<size_t>(data.cols()));
+	if (nPartitions <= 1) {
+		return errorSum(data);
+	}
+	
+	const vector<Eigen_size_type> bounds = partitionColumns(data.cols(), nPartitions);
+	vector<double> partialF(nPartitions, 0.0);
+	pool.parallelFor(nPartitions, [&](size_t p) {
+		partialF[p] = errorSum(data.middleCols(bounds[p], bounds[p + 1] - bounds[p]));
+	});
+	return std::accumulate(partialF.begin(), partialF.end(), 0.0);
+}
+
+DeepBeliefNet& DeepBeliefNet::train(const DataRef& data, const TrainParameters& params, TrainProgress& aProgressFunctor, const ContinueFunction& aContinueFunction) {
+	return train(BatchSource(data), params, aProgressFunctor, aContinueFunction);
+}
+
+DeepBeliefNet& DeepBeliefNet::train(const SparseMatrixXs& data, const TrainParameters& params, TrainProgress& aProgressFunctor, const ContinueFunction& aContinueFunction) {
+	return train(BatchSource(data), params, aProgressFunctor, aContinueFunction);
+}
+
+DeepBeliefNet& DeepBeliefNet::train(const BatchSource& data, const TrainParameters& params, TrainProgress& aProgressFunctor, const ContinueFunction& aContinueFunction) {
 	/* Running eigen threaded? */
 	Eigen::setNbThreads(params.nbThreads);
 	
 	if (!unrolled) throw std::runtime_error("Only unrolled networks can be trained");
+	data.checkSampling(params.sampling);
 	
 	DeepBeliefNet trainingDBN = this->clone(); // work on a copy
 	
@@ -161,16 +372,33 @@ DeepBeliefNet& DeepBeliefNet::train(const MatrixXd& data, const TrainParameters&
 	Rcpp::Rcout << "Training until stopCounter reaches " << aContinueFunction.limit << endl;
 	
 	Eigen_size_type batchSizeEigen = boost::numeric_cast<Eigen_size_type>(params.batchSize);
-	MatrixXd batch = MatrixXd::Zero(myLayers[0].getSize(), batchSizeEigen);
-	Random batchRand("uniform_int", boost::numeric_cast<size_t>(data.cols()));
+	MatrixXs batch = MatrixXs::Zero(myLayers[0].getSize(), batchSizeEigen);
+	Random batchRand("uniform_int", boost::numeric_cast<size_t>(data.nSamples()), params.seed, Random::streamId(0, Random::trainBatches, 0));
+	batchRand.setSampling(params.sampling);
 
-	// Input and output pointers for/from cgmin:
-	OptimParameters OptimParams(trainingDBN, batch);
+	// Threads to split the batches: they replace Eigen's own threading
+	std::unique_ptr<ThreadPool> pool;
+	if (params.parallelization == TrainParameters::synchronous) {
+		Eigen::setNbThreads(1);
+		pool.reset(new ThreadPool(params.nbThreads));
+		Rcpp::Rcout << "Computing the gradients on " << pool->size() << " threads" << endl;
+	}
+	
+	// sgd and adam keep their state across the iterations
+	std::unique_ptr<FirstOrderOptimizer> firstOrder;
+	if (params.optimizer != TrainParameters::cgmin) {
+		firstOrder.reset(new FirstOrderOptimizer(trainingDBN, params));
+		Rcpp::Rcout << "One " << (params.optimizer == TrainParameters::adam ? "adam" : "sgd") << " step per batch, learning rate " << params.learningRate << endl;
+	}
+	
+	// Batch minimizer and input and output pointers for/from it:
+	const auto minimize = params.myCgMinParams.method == CgMinParams::lbfgs ? lbfgs : cgmin;
+	OptimParameters OptimParams(trainingDBN, batch, pool.get());
 	std::unique_ptr<unsigned int> fncount(new unsigned int {0}), grcount(new unsigned int {0});
 	std::unique_ptr<int> fail(new int {0});
 	std::unique_ptr<double> Fmin(new double {0.0});
-	shared_array_ptr<double> trainingData = trainingDBN.getData();
-	shared_array_ptr<double> X = trainingDBN.getData().clone(); // Working copy of weights
+	shared_array_ptr<Scalar> trainingData = trainingDBN.getData();
+	shared_array_ptr<Scalar> X = trainingDBN.getData().clone(); // Working copy of weights
 	
 	// Store error in a vector
 	vector<double> errors;
@@ -181,7 +409,8 @@ DeepBeliefNet& DeepBeliefNet::train(const MatrixXd& data, const TrainParameters&
 	// Get random batch
 	aProgressFunctor.setBatchSize(params.batchSize);
 	aProgressFunctor.setMaxIters(params.maxIters);
-	batchRand.setBatch(data, batch);
+	BatchPrefetcher prefetcher(batchRand, data, params.prefetch); // draws the next batch during the minimization
+	prefetcher.fetch(1, batch);
 		
 	//bool continueTraining = true;
 	unsigned int stopCounter = 0;
@@ -195,22 +424,28 @@ DeepBeliefNet& DeepBeliefNet::train(const MatrixXd& data, const TrainParameters&
         Rcpp::checkUserInterrupt();
 		//Rcpp::Rcout << "Backprop iteration " << iter << " / " << params.maxIters << " (batchsize " << params.batchSize << ")" << endl;
 
-		cgmin(
-			trainingDBN.getData().size(), // n, nb arguments
-			trainingDBN.getData().data(), // Bvec, vector of working & start parameters, length n
-			X.data(), // X, vector of temporary parameters, length n
-			Fmin.get(), // Fmin, Minimum of the function
-			my_f, // fn, Error function
-			my_df, // gr, Gradient function
-			fail.get(), // fail, Output
-			params.myCgMinParams, // Additional minimization parameters
-			OptimParams, // ex, parameters probably passed to optimfn and optimgr
-			fncount.get(), // fncount, Output
-			grcount.get() // grcount, Output
-		);
-		
-		// Store error
-		errors.push_back(*Fmin);
+		if (firstOrder) {
+			// Store the error of the batch before the step
+			errors.push_back(firstOrder->step(trainingDBN, batch, pool.get(), params, iter));
+		}
+		else {
+			minimize(
+				trainingDBN.getData().size(), // n, nb arguments
+				trainingDBN.getData().data(), // Bvec, vector of working & start parameters, length n
+				X.data(), // X, vector of temporary parameters, length n
+				Fmin.get(), // Fmin, Minimum of the function
+				my_f, // fn, Error function
+				my_df, // gr, Gradient function
+				fail.get(), // fail, Output
+				params.myCgMinParams, // Additional minimization parameters
+				OptimParams, // ex, parameters probably passed to optimfn and optimgr
+				fncount.get(), // fncount, Output
+				grcount.get() // grcount, Output
+			);
+			
+			// Store error
+			errors.push_back(*Fmin);
+		}
 
 		// Report progress
 		aProgressFunctor(*this, batch, iter);
@@ -222,7 +457,8 @@ DeepBeliefNet& DeepBeliefNet::train(const MatrixXd& data, const TrainParameters&
 		
 		if (stopCounter < aContinueFunction.limit && iter < params.maxIters) {
 			// Get random batch
-			batchRand.setBatch(data, batch);
+			prefetcher.fetch(iter + 1, batch);
+			OptimParams.invalidateCache(); // the cached activations are those of the previous batch
 		}
 	}
 
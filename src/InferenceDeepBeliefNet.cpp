@@ -0,0 +1,57 @@
+#include <Eigen/Dense>
+
+#include <DeepLearning/InferenceDeepBeliefNet.h>
+#include <DeepLearning/RBM.h>
+
+
+namespace DeepLearning {
+	/* Predictions */
+
+	MatrixXs InferenceDeepBeliefNet::predict(MatrixXs data) const {
+		predictInPlace(data);
+		return data;
+	}
+
+	void InferenceDeepBeliefNet::predictInPlace(MatrixXs& data) const {
+		size_t lastLayerToPredict = unrolled ? nRBMs() / 2 : nRBMs();
+		MatrixXs activations;
+		for (size_t i = 0; i < lastLayerToPredict; ++i) {
+			forwardsProductInPlace(i, data, activations);
+			RBM::biasAndActivitiesInPlace(activations, myC[i], myLayers[i + 1].getType());
+			data.swap(activations);
+		}
+	}
+
+	MatrixXs InferenceDeepBeliefNet::reverse_predict(MatrixXs hidden) const {
+		reverse_predictInPlace(hidden);
+		return hidden;
+	}
+
+	void InferenceDeepBeliefNet::reverse_predictInPlace(MatrixXs& hidden) const {
+		MatrixXs activations;
+		if (unrolled) {
+			for (size_t i = nRBMs() / 2; i < nRBMs(); ++i) {
+				forwardsProductInPlace(i, hidden, activations);
+				RBM::biasAndActivitiesInPlace(activations, myC[i], myLayers[i + 1].getType());
+				hidden.swap(activations);
+			}
+		}
+		else {
+			for (size_t i = nRBMs(); i-- > 0;) {
+				backwardsProductInPlace(i, hidden, activations);
+				RBM::biasAndActivitiesInPlace(activations, myB[i], myLayers[i].getType());
+				hidden.swap(activations);
+			}
+		}
+	}
+
+	MatrixXs InferenceDeepBeliefNet::reconstruct(MatrixXs data) const {
+		reconstructInPlace(data);
+		return data;
+	}
+
+	void InferenceDeepBeliefNet::reconstructInPlace(MatrixXs& data) const {
+		predictInPlace(data);
+		reverse_predictInPlace(data);
+	}
+}
@@ -0,0 +1,82 @@
+#include <Eigen/Dense>
+
+#include <algorithm> // std::transform
+#include <cstdint> // uint8_t
+#include <stdexcept> // std::invalid_argument
+#include <string>
+
+#include <DeepLearning/MappedDataset.h>
+
+
+namespace DeepLearning {
+	std::string MappedDataset::ElementTypeToString(ElementType aType) {
+		switch (aType) {
+			case float64: return "double";
+			case float32: return "float";
+			case uint8: return "uint8";
+		}
+		throw std::invalid_argument("Unknown element type");
+	}
+
+	MappedDataset::ElementType MappedDataset::ElementTypeFromString(const std::string& aString) {
+		std::string lower(aString);
+		std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+		if (lower == "double") {
+			return float64;
+		}
+		else if (lower == "float") {
+			return float32;
+		}
+		else if (lower == "uint8") {
+			return uint8;
+		}
+		else {
+			throw std::invalid_argument("type not double, float or uint8");
+		}
+	}
+
+	size_t MappedDataset::elementSize(ElementType aType) {
+		switch (aType) {
+			case float64: return sizeof(double);
+			case float32: return sizeof(float);
+			case uint8: return sizeof(uint8_t);
+		}
+		throw std::invalid_argument("Unknown element type");
+	}
+
+	MappedDataset::MappedDataset(const std::string& aPath, Eigen_size_type aNFeatures, Eigen_size_type aNSamples, ElementType aType,
+		bool aSamplesAsRows, double aScale, size_t anOffset): file(aPath, true), myNFeatures(aNFeatures), myNSamples(aNSamples), type(aType),
+		samplesAsRows(aSamplesAsRows), scale(static_cast<Scalar>(aScale)), values(nullptr) {
+		if (aNFeatures <= 0 || aNSamples <= 0) throw std::invalid_argument("The dataset must have at least one feature and one sample");
+		const size_t needed = anOffset + static_cast<size_t>(aNFeatures) * static_cast<size_t>(aNSamples) * elementSize(aType);
+		if (file.size() < needed) throw std::invalid_argument(aPath + " is smaller than the dataset");
+		values = file.data() + anOffset; // the batches are scattered: the file is mapped for random access
+	}
+
+	template <typename T> void MappedDataset::gatherAs(const Eigen_size_type* columns, Eigen_size_type nColumns, MatrixXs& dest, Eigen_size_type firstColumn) const {
+		const T* data = reinterpret_cast<const T*>(values);
+		if (samplesAsRows) {
+			// One feature at a time, as the in-memory data with the samples as rows
+			for (Eigen_size_type feature = 0; feature < myNFeatures; ++feature) {
+				const T* featureData = data + feature * myNSamples;
+				for (Eigen_size_type i = 0; i < nColumns; ++i) {
+					dest(feature, firstColumn + i) = static_cast<Scalar>(featureData[columns[i]]) * scale;
+				}
+			}
+		}
+		else {
+			typedef Eigen::Map<const Eigen::Array<T, Eigen::Dynamic, 1>> SampleMap;
+			for (Eigen_size_type i = 0; i < nColumns; ++i) {
+				dest.col(firstColumn + i).array() = SampleMap(data + columns[i] * myNFeatures, myNFeatures).template cast<Scalar>() * scale;
+			}
+		}
+	}
+
+	void MappedDataset::gather(const Eigen_size_type* columns, Eigen_size_type nColumns, MatrixXs& dest, Eigen_size_type firstColumn) const {
+		switch (type) {
+			case float64: gatherAs<double>(columns, nColumns, dest, firstColumn); break;
+			case float32: gatherAs<float>(columns, nColumns, dest, firstColumn); break;
+			case uint8: gatherAs<uint8_t>(columns, nColumns, dest, firstColumn); break;
+		}
+	}
+}
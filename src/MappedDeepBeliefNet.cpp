@@ -0,0 +1,147 @@
+#include <cstdint> // uint32_t, uint64_t
+#include <cstdio> // std::remove, std::rename
+#include <cstring> // std::memcmp, std::memcpy
+#include <fstream>
+#include <stdexcept> // std::invalid_argument, std::runtime_error
+#include <string>
+#include <vector>
+
+#include <DeepLearning/Layer.h>
+#include <DeepLearning/MappedDeepBeliefNet.h>
+#include <DeepLearning/RBM.h>
+#include <shared_array_ptr.h>
+
+
+namespace DeepLearning {
+	namespace {
+		const char magic[8] = {'D', 'L', 'D', 'B', 'N', 0, 0, 0};
+		const uint32_t byteOrderMark = 0x01020304;
+		const uint64_t weightsAlignment = 64;
+		enum Flags {pretrainedFlag = 1, unrolledFlag = 2, finetunedFlag = 4};
+
+		struct FileHeader {
+			char magic[8];
+			uint32_t version, byteOrder, scalarSize, flags;
+			uint64_t nLayers, nWeights, weightsOffset;
+		};
+		struct FileLayer {
+			uint32_t size, type;
+		};
+		struct FileRBM {
+			uint64_t b, W, c, end;
+		};
+		static_assert(sizeof(FileHeader) == 48 && sizeof(FileLayer) == 8 && sizeof(FileRBM) == 32, "Unexpected padding in the model file structures");
+
+		/** The offsets of the RBMs between someLayers, from the first weight, and their total in nWeights */
+		std::vector<FileRBM> computeFileRBMs(const std::vector<Layer>& someLayers, uint64_t& nWeights) {
+			std::vector<FileRBM> rbms;
+			uint64_t start = 0;
+			for (size_t i = 0; i + 1 < someLayers.size(); ++i) {
+				const offsets rbmOffsets = RBM::computeOffsets(someLayers[i], someLayers[i + 1]);
+				rbms.push_back(FileRBM{start + std::get<0>(rbmOffsets), start + std::get<1>(rbmOffsets), start + std::get<2>(rbmOffsets), start + std::get<3>(rbmOffsets)});
+				start += std::get<2>(rbmOffsets); // b of the next RBM is c of this one
+			}
+			nWeights = rbms.empty() ? 0 : rbms.back().end;
+			return rbms;
+		}
+
+		uint64_t computeWeightsOffset(uint64_t nLayers) {
+			const uint64_t headerSize = sizeof(FileHeader) + nLayers * sizeof(FileLayer) + (nLayers - 1) * sizeof(FileRBM);
+			return (headerSize + weightsAlignment - 1) / weightsAlignment * weightsAlignment;
+		}
+
+		template <typename T> void readAs(const unsigned char* someBytes, Scalar* aDestination, size_t aSize) {
+			const T* values = reinterpret_cast<const T*>(someBytes);
+			for (size_t i = 0; i < aSize; ++i) {
+				aDestination[i] = static_cast<Scalar>(values[i]);
+			}
+		}
+	}
+
+	MappedDeepBeliefNet::MappedDeepBeliefNet(const std::string& aPath): file(aPath), dbn(), mapped(false) {
+		const unsigned char* bytes = file.data();
+		FileHeader header;
+		if (file.size() < sizeof(header)) throw std::invalid_argument(aPath + " is not a DeepBeliefNet model file");
+		std::memcpy(&header, bytes, sizeof(header));
+		if (std::memcmp(header.magic, magic, sizeof(magic)) != 0) throw std::invalid_argument(aPath + " is not a DeepBeliefNet model file");
+		if (header.version != version) throw std::invalid_argument(aPath + " has an unsupported model file version " + std::to_string(header.version));
+		if (header.byteOrder != byteOrderMark) throw std::invalid_argument(aPath + " was written on a platform with another byte order");
+		if (header.scalarSize != sizeof(float) && header.scalarSize != sizeof(double)) throw std::invalid_argument(aPath + " has weights of an unknown size");
+		if (header.nLayers < 2 || header.nLayers > (file.size() - sizeof(header)) / (sizeof(FileLayer) + sizeof(FileRBM))) {
+			throw std::invalid_argument(aPath + " is truncated or corrupted");
+		}
+
+		std::vector<Layer> layers;
+		layers.reserve(header.nLayers);
+		const unsigned char* layerBytes = bytes + sizeof(header);
+		for (uint64_t i = 0; i < header.nLayers; ++i) {
+			FileLayer layer;
+			std::memcpy(&layer, layerBytes + i * sizeof(layer), sizeof(layer));
+			if (layer.size == 0 || layer.type > Layer::continuous) throw std::invalid_argument(aPath + " has an invalid layer");
+			layers.push_back(Layer(layer.size, static_cast<Layer::Type>(layer.type)));
+		}
+
+		// The offsets in the file must be those of the layers
+		uint64_t nWeights;
+		const std::vector<FileRBM> rbms = computeFileRBMs(layers, nWeights);
+		const unsigned char* rbmBytes = layerBytes + header.nLayers * sizeof(FileLayer);
+		if (header.nWeights != nWeights || header.weightsOffset != computeWeightsOffset(header.nLayers)) throw std::invalid_argument(aPath + " has inconsistent offsets");
+		if (file.size() < header.weightsOffset + header.nWeights * header.scalarSize) throw std::invalid_argument(aPath + " is truncated");
+		if (std::memcmp(rbmBytes, rbms.data(), rbms.size() * sizeof(FileRBM)) != 0) throw std::invalid_argument(aPath + " has inconsistent offsets");
+
+		const unsigned char* weightBytes = bytes + header.weightsOffset;
+		mapped = header.scalarSize == sizeof(Scalar);
+		// The mapping is read-only: the const methods of the DeepBeliefNet never write to it, and it must be cloned otherwise
+		shared_array_ptr<Scalar> weights = mapped ?
+			shared_array_ptr<Scalar>(const_cast<Scalar*>(reinterpret_cast<const Scalar*>(weightBytes)), static_cast<size_t>(nWeights), false) :
+			shared_array_ptr<Scalar>(static_cast<size_t>(nWeights));
+		if (!mapped && header.scalarSize == sizeof(double)) {
+			readAs<double>(weightBytes, weights.getOffsetData(), weights.size());
+		}
+		else if (!mapped) {
+			readAs<float>(weightBytes, weights.getOffsetData(), weights.size());
+		}
+		dbn.reset(new DeepBeliefNet(layers, weights, (header.flags & pretrainedFlag) != 0, (header.flags & unrolledFlag) != 0, (header.flags & finetunedFlag) != 0));
+	}
+
+	void MappedDeepBeliefNet::write(const DeepBeliefNet& aDBN, const std::string& aPath) {
+		const std::vector<Layer> layers = aDBN.getLayers();
+		FileHeader header;
+		std::memcpy(header.magic, magic, sizeof(magic));
+		header.version = version;
+		header.byteOrder = byteOrderMark;
+		header.scalarSize = sizeof(Scalar);
+		header.flags = (aDBN.isPretrained() ? pretrainedFlag : 0) | (aDBN.isUnrolled() ? unrolledFlag : 0) | (aDBN.isFinetuned() ? finetunedFlag : 0);
+		header.nLayers = layers.size();
+		const std::vector<FileRBM> rbms = computeFileRBMs(layers, header.nWeights);
+		header.weightsOffset = computeWeightsOffset(header.nLayers);
+		const shared_array_ptr<Scalar> weights = aDBN.getData();
+		if (weights.size() != header.nWeights) throw std::invalid_argument("The weights don't match the layers of the DeepBeliefNet");
+
+		// Written aside and renamed, so that the processes that mapped a previous version of the file keep it intact
+		const std::string temporaryPath = aPath + ".tmp";
+		std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!out) throw std::runtime_error("Cannot open " + temporaryPath + " for writing");
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		for (const Layer& layer: layers) {
+			const FileLayer fileLayer{layer.getSize(), static_cast<uint32_t>(layer.getType())};
+			out.write(reinterpret_cast<const char*>(&fileLayer), sizeof(fileLayer));
+		}
+		out.write(reinterpret_cast<const char*>(rbms.data()), static_cast<std::streamsize>(rbms.size() * sizeof(FileRBM)));
+		const std::vector<char> padding(header.weightsOffset - static_cast<uint64_t>(out.tellp()), 0);
+		out.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+		out.write(reinterpret_cast<const char*>(weights.getOffsetData()), static_cast<std::streamsize>(header.nWeights * sizeof(Scalar)));
+		out.close();
+		if (!out) {
+			std::remove(temporaryPath.c_str());
+			throw std::runtime_error("Cannot write " + temporaryPath);
+		}
+		if (std::rename(temporaryPath.c_str(), aPath.c_str()) != 0) {
+			std::remove(aPath.c_str()); // rename doesn't replace existing files on Windows
+			if (std::rename(temporaryPath.c_str(), aPath.c_str()) != 0) {
+				std::remove(temporaryPath.c_str());
+				throw std::runtime_error("Cannot write " + aPath);
+			}
+		}
+	}
+}
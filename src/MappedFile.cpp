@@ -0,0 +1,64 @@
+#include <cerrno> // errno
+#include <cstring> // std::strerror
+#include <stdexcept> // std::invalid_argument, std::runtime_error
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h> // open
+#include <sys/mman.h> // mmap, madvise, munmap
+#include <sys/stat.h> // fstat
+#include <unistd.h> // close
+#endif
+
+#include <DeepLearning/MappedFile.h>
+
+
+namespace DeepLearning {
+	MappedFile::MappedFile(const std::string& aPath, bool randomAccess): path(aPath), view(nullptr), viewLength(0) {
+#ifdef _WIN32
+		HANDLE file = CreateFileA(aPath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | (randomAccess ? FILE_FLAG_RANDOM_ACCESS : 0), NULL);
+		if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("Cannot open " + aPath);
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+			CloseHandle(file);
+			throw std::invalid_argument(aPath + " is empty");
+		}
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		view = mapping == NULL ? NULL : MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		// The view keeps the mapping and the file open
+		if (mapping != NULL) CloseHandle(mapping);
+		CloseHandle(file);
+		if (view == NULL) throw std::runtime_error("Cannot map " + aPath);
+		viewLength = static_cast<size_t>(fileSize.QuadPart);
+#else
+		const int file = open(aPath.c_str(), O_RDONLY);
+		if (file < 0) throw std::runtime_error("Cannot open " + aPath + ": " + std::strerror(errno));
+		struct stat status;
+		if (fstat(file, &status) != 0 || status.st_size == 0) {
+			close(file);
+			throw std::invalid_argument(aPath + " is empty");
+		}
+		viewLength = static_cast<size_t>(status.st_size);
+		view = mmap(nullptr, viewLength, PROT_READ, MAP_SHARED, file, 0);
+		close(file); // the mapping keeps the file open
+		if (view == MAP_FAILED) {
+			view = nullptr;
+			throw std::runtime_error("Cannot map " + aPath + ": " + std::strerror(errno));
+		}
+#ifdef MADV_RANDOM
+		if (randomAccess) madvise(view, viewLength, MADV_RANDOM); // reading ahead would only evict useful pages
+#endif
+#endif
+	}
+
+	MappedFile::~MappedFile() {
+#ifdef _WIN32
+		UnmapViewOfFile(view);
+#else
+		munmap(view, viewLength);
+#endif
+	}
+}
@@ -9,6 +9,8 @@
 namespace DeepLearning {
 	const std::string PretrainParameters::invalid_momentums = "momentums of wrong size: should be 1, 2 or maxiters";
 	const std::string PretrainParameters::invalid_penalization = "newPenalization not l1 or l2";
+	const std::string PretrainParameters::invalid_parallelization = "newParallelization not sequential, hogwild or synchronous";
+	const std::string PretrainParameters::invalid_optimizer = "newOptimizer not sgd, adagrad, rmsprop or adam";
 	
 	std::string PretrainParameters::PenalizationTypeToString(PenalizationType aPT) {
 		return aPT == l1 ? "l1" : "l2";
@@ -26,4 +28,58 @@ namespace DeepLearning {
 			throw std::invalid_argument(invalid_penalization);
 		}
 	}
+	
+	std::string PretrainParameters::ParallelizationTypeToString(ParallelizationType aPT) {
+		switch (aPT) {
+			case sequential: return "sequential";
+			case hogwild: return "hogwild";
+			case synchronous: return "synchronous";
+		}
+		throw std::invalid_argument(invalid_parallelization);
+	}
+	
+	PretrainParameters::ParallelizationType PretrainParameters::ParallelizationTypeFromString(std::string aString) {	
+		std::transform(aString.begin(), aString.end(), aString.begin(), ::tolower);
+		if (aString == "sequential") {
+			return sequential;
+		}
+		else if (aString == "hogwild") {
+			return hogwild;
+		}
+		else if (aString == "synchronous") {
+			return synchronous;
+		}
+		else {
+			throw std::invalid_argument(invalid_parallelization);
+		}
+	}
+	
+	std::string PretrainParameters::OptimizerTypeToString(OptimizerType anOT) {
+		switch (anOT) {
+			case sgd: return "sgd";
+			case adagrad: return "adagrad";
+			case rmsprop: return "rmsprop";
+			case adam: return "adam";
+		}
+		throw std::invalid_argument(invalid_optimizer);
+	}
+	
+	PretrainParameters::OptimizerType PretrainParameters::OptimizerTypeFromString(std::string aString) {	
+		std::transform(aString.begin(), aString.end(), aString.begin(), ::tolower);
+		if (aString == "sgd") {
+			return sgd;
+		}
+		else if (aString == "adagrad") {
+			return adagrad;
+		}
+		else if (aString == "rmsprop") {
+			return rmsprop;
+		}
+		else if (aString == "adam") {
+			return adam;
+		}
+		else {
+			throw std::invalid_argument(invalid_optimizer);
+		}
+	}
 }
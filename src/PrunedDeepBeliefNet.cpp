@@ -0,0 +1,78 @@
+#include <Eigen/Dense>
+
+#include <stdexcept> // std::invalid_argument
+#include <vector>
+using std::vector;
+
+#include <DeepLearning/PrunedDeepBeliefNet.h>
+#include <DeepLearning/RBM.h>
+
+
+namespace DeepLearning {
+	PrunedDeepBeliefNet::PrunedDeepBeliefNet(const DeepBeliefNet& aDBN, Scalar aThreshold, double aMinSparsity):
+		InferenceDeepBeliefNet(aDBN.getLayers(), aDBN.isUnrolled()), myDenseW(), mySparseW() {
+		if (!(aThreshold >= 0)) throw std::invalid_argument("The threshold must be >= 0");
+		for (size_t i = 0; i < aDBN.nRBMs(); ++i) {
+			const RBM rbm = aDBN.getRBM(i);
+			const MatrixXsMap W = rbm.getW();
+			const Eigen_size_type nZeros = (W.array().abs() <= aThreshold).count();
+			if (nZeros >= aMinSparsity * W.size()) {
+				// sparseView keeps the weights of magnitude strictly above aThreshold
+				myDenseW.push_back(MatrixXs());
+				mySparseW.push_back(W.sparseView(aThreshold, 1));
+				mySparseW.back().makeCompressed();
+			}
+			else {
+				myDenseW.push_back((W.array().abs() <= aThreshold).select(Scalar(0), W));
+				mySparseW.push_back(SparseMatrixXs());
+			}
+			myB.push_back(rbm.getB());
+			myC.push_back(rbm.getC());
+		}
+	}
+
+	PrunedDeepBeliefNet::PrunedDeepBeliefNet(const vector<Layer>& layers, const vector<MatrixXs>& someDenseW, const vector<SparseMatrixXs>& someSparseW,
+	                                         const vector<ArrayX1s>& someB, const vector<ArrayX1s>& someC, bool isUnrolled):
+		InferenceDeepBeliefNet(layers, isUnrolled), myDenseW(someDenseW), mySparseW(someSparseW) {
+		myB = someB;
+		myC = someC;
+		if (myLayers.size() < 2 || myDenseW.size() != nRBMs() || mySparseW.size() != nRBMs() || myB.size() != nRBMs() || myC.size() != nRBMs()) {
+			throw std::invalid_argument("The weights or biases do not match the layers");
+		}
+		for (size_t i = 0; i < nRBMs(); ++i) {
+			const Eigen_size_type nInput = myLayers[i].getSize(), nOutput = myLayers[i + 1].getSize();
+			const bool denseMatches = myDenseW[i].rows() == nOutput && myDenseW[i].cols() == nInput && mySparseW[i].size() == 0;
+			const bool sparseMatches = mySparseW[i].rows() == nOutput && mySparseW[i].cols() == nInput && myDenseW[i].size() == 0;
+			if ((!denseMatches && !sparseMatches) || myB[i].size() != nInput || myC[i].size() != nOutput) {
+				throw std::invalid_argument("The weights or biases do not match the layers");
+			}
+			mySparseW[i].makeCompressed();
+		}
+	}
+
+	double PrunedDeepBeliefNet::getSparsity(size_t i) const {
+		const double nWeights = static_cast<double>(myLayers[i].getSize()) * myLayers[i + 1].getSize();
+		const double nNonZeros = isSparse(i) ? mySparseW[i].nonZeros() : (myDenseW[i].array() != 0).count();
+		return 1 - nNonZeros / nWeights;
+	}
+
+	/* Products with the pruned weights */
+
+	void PrunedDeepBeliefNet::forwardsProductInPlace(size_t i, const MatrixXs& data, MatrixXs& activations) const {
+		if (isSparse(i)) {
+			activations.noalias() = mySparseW[i] * data;
+		}
+		else {
+			activations.noalias() = myDenseW[i] * data;
+		}
+	}
+
+	void PrunedDeepBeliefNet::backwardsProductInPlace(size_t i, const MatrixXs& hidden, MatrixXs& activations) const {
+		if (isSparse(i)) {
+			activations.noalias() = mySparseW[i].transpose() * hidden;
+		}
+		else {
+			activations.noalias() = myDenseW[i].transpose() * hidden;
+		}
+	}
+}
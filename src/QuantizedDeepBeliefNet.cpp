@@ -0,0 +1,287 @@
+#include <Eigen/Dense>
+
+#include <algorithm> // std::min, std::max
+#include <cmath> // std::round
+#include <cstdint> // int8_t, uint8_t, int32_t
+#include <stdexcept> // std::invalid_argument
+#include <vector>
+using std::vector;
+
+#include <DeepLearning/QuantizedDeepBeliefNet.h>
+#include <DeepLearning/RBM.h>
+#include <DeepLearning/utils.h>
+
+
+namespace DeepLearning {
+	namespace {
+		typedef Eigen::Matrix<uint8_t, Eigen::Dynamic, Eigen::Dynamic> MatrixXu8;
+		typedef Eigen::Matrix<int32_t, Eigen::Dynamic, Eigen::Dynamic> MatrixXi32;
+
+		const Scalar weightMax = 127, dataMax = 255;
+
+		/** Symmetric scale of a row of weights: the largest absolute weight maps to weightMax. 1 for zeros, so that they are still quantized to 0 */
+		Scalar weightScale(Scalar aMaxAbs) {
+			return aMaxAbs > 0 ? aMaxAbs / weightMax : Scalar(1);
+		}
+
+		/** Scale and zero point mapping the range of the data, extended to include 0 so that it is exact, to [0, dataMax] */
+		void calibrate(const MatrixXs& data, Scalar& aScale, int& aZeroPoint) {
+			const Scalar low = std::min(data.minCoeff(), Scalar(0)), high = std::max(data.maxCoeff(), Scalar(0));
+			aScale = high > low ? (high - low) / dataMax : Scalar(1);
+			aZeroPoint = static_cast<int>(std::min(dataMax, std::round(-low / aScale)));
+		}
+
+		/** q = data / aScale + aZeroPoint, rounded to the nearest integer and saturated to [0, dataMax] */
+		void quantizeInPlace(const MatrixXs& data, Scalar aScale, int aZeroPoint, MatrixXu8& quantized) {
+			quantized = (data.array() / aScale + Scalar(aZeroPoint)).round().max(Scalar(0)).min(dataMax).cast<uint8_t>().matrix();
+		}
+
+		/** The loops below work on chunks of this many weights (see the chunked loops in utils.h) */
+		const Eigen_size_type chunk = int8Chunk;
+
+		/** The dot product of a row of Q with a column of data */
+		int32_t dotProduct(const int8_t* w, const uint8_t* x, Eigen_size_type n) {
+			const Eigen_size_type nChunked = n - n % chunk;
+			int32_t sum = 0;
+			for (Eigen_size_type j = 0; j < nChunked; j += chunk) {
+				int32_t partial = 0;
+				for (Eigen_size_type t = 0; t < chunk; ++t) {
+					partial += int32_t(w[j + t]) * int32_t(x[j + t]);
+				}
+				sum += partial;
+			}
+			for (Eigen_size_type j = nChunked; j < n; ++j) {
+				sum += int32_t(w[j]) * int32_t(x[j]);
+			}
+			return sum;
+		}
+
+		/** The dot products of two rows of Q with four columns of data: each weight and each data value is loaded once for four or two products */
+		void dotProducts2x4(const int8_t* w0, const int8_t* w1, const uint8_t* x0, const uint8_t* x1, const uint8_t* x2, const uint8_t* x3,
+		                    Eigen_size_type n, int32_t* sums0, int32_t* sums1) {
+			const Eigen_size_type nChunked = n - n % chunk;
+			int32_t sum00 = 0, sum01 = 0, sum02 = 0, sum03 = 0, sum10 = 0, sum11 = 0, sum12 = 0, sum13 = 0;
+			for (Eigen_size_type j = 0; j < nChunked; j += chunk) {
+				int32_t partial00 = 0, partial01 = 0, partial02 = 0, partial03 = 0, partial10 = 0, partial11 = 0, partial12 = 0, partial13 = 0;
+				for (Eigen_size_type t = 0; t < chunk; ++t) {
+					const int32_t weight0 = w0[j + t], weight1 = w1[j + t];
+					const int32_t value0 = x0[j + t], value1 = x1[j + t], value2 = x2[j + t], value3 = x3[j + t];
+					partial00 += weight0 * value0;
+					partial01 += weight0 * value1;
+					partial02 += weight0 * value2;
+					partial03 += weight0 * value3;
+					partial10 += weight1 * value0;
+					partial11 += weight1 * value1;
+					partial12 += weight1 * value2;
+					partial13 += weight1 * value3;
+				}
+				sum00 += partial00;
+				sum01 += partial01;
+				sum02 += partial02;
+				sum03 += partial03;
+				sum10 += partial10;
+				sum11 += partial11;
+				sum12 += partial12;
+				sum13 += partial13;
+			}
+			for (Eigen_size_type j = nChunked; j < n; ++j) {
+				const int32_t weight0 = w0[j], weight1 = w1[j];
+				sum00 += weight0 * int32_t(x0[j]);
+				sum01 += weight0 * int32_t(x1[j]);
+				sum02 += weight0 * int32_t(x2[j]);
+				sum03 += weight0 * int32_t(x3[j]);
+				sum10 += weight1 * int32_t(x0[j]);
+				sum11 += weight1 * int32_t(x1[j]);
+				sum12 += weight1 * int32_t(x2[j]);
+				sum13 += weight1 * int32_t(x3[j]);
+			}
+			sums0[0] = sum00;
+			sums0[1] = sum01;
+			sums0[2] = sum02;
+			sums0[3] = sum03;
+			sums1[0] = sum10;
+			sums1[1] = sum11;
+			sums1[2] = sum12;
+			sums1[3] = sum13;
+		}
+
+		/** acc = Q * data, with Q in row-major (nRows x nColumns) order: each sum is the dot product of a row of Q and a column of data, both contiguous.
+		 * Blocks of two rows by four columns are computed together, and the remaining rows and columns one product at a time.
+		 */
+		void integerProduct(const int8_t* Q, Eigen_size_type nRows, Eigen_size_type nColumns, const MatrixXu8& data, MatrixXi32& acc) {
+			acc.resize(nRows, data.cols());
+			Eigen_size_type k = 0;
+			for (; k + 4 <= data.cols(); k += 4) {
+				const uint8_t *x0 = data.col(k).data(), *x1 = data.col(k + 1).data(), *x2 = data.col(k + 2).data(), *x3 = data.col(k + 3).data();
+				int32_t sums0[4], sums1[4];
+				Eigen_size_type r = 0;
+				for (; r + 2 <= nRows; r += 2) {
+					dotProducts2x4(Q + r * nColumns, Q + (r + 1) * nColumns, x0, x1, x2, x3, nColumns, sums0, sums1);
+					for (Eigen_size_type s = 0; s < 4; ++s) {
+						acc(r, k + s) = sums0[s];
+						acc(r + 1, k + s) = sums1[s];
+					}
+				}
+				for (; r < nRows; ++r) {
+					for (Eigen_size_type s = 0; s < 4; ++s) {
+						acc(r, k + s) = dotProduct(Q + r * nColumns, data.col(k + s).data(), nColumns);
+					}
+				}
+			}
+			for (; k < data.cols(); ++k) {
+				for (Eigen_size_type r = 0; r < nRows; ++r) {
+					acc(r, k) = dotProduct(Q + r * nColumns, data.col(k).data(), nColumns);
+				}
+			}
+		}
+
+		/** Quantizes W (rows x columns) into Q, in row-major order, with symmetric per row scales */
+		template <typename Derived>
+		void quantizeWeights(const Eigen::MatrixBase<Derived>& W, int8_t* Q, ArrayX1s& rowScales) {
+			rowScales = W.array().abs().rowwise().maxCoeff().unaryExpr(&weightScale);
+			// Row-major is the transposed view of a column-major matrix
+			Eigen::Map<Eigen::Matrix<int8_t, Eigen::Dynamic, Eigen::Dynamic>> QMap(Q, W.cols(), W.rows());
+			QMap = (W.array().colwise() / rowScales).round().max(-weightMax).min(weightMax).template cast<int8_t>().matrix().transpose();
+		}
+	}
+
+	QuantizedDeepBeliefNet::QuantizedDeepBeliefNet(const DeepBeliefNet& aDBN, const MatrixXs& someData):
+		InferenceDeepBeliefNet(aDBN.getLayers(), aDBN.isUnrolled()), myWeights(computeWeightsSize(myLayers, unrolled)), myWeightOffsets(),
+		myRowScales(), myRowSums(), myDataScales(), myZeroPoints() {
+		for (const Layer& layer: myLayers) {
+			if (layer.getSize() > maxLayerSize) throw std::invalid_argument("The layers are too large to be quantized");
+		}
+		if (someData.rows() != myLayers[0].getSize() || someData.cols() == 0) {
+			throw std::invalid_argument("The calibration data does not match the input layer");
+		}
+		computeWeightOffsets();
+		myRowScales.resize(nProducts());
+		myDataScales.resize(nProducts());
+		myZeroPoints.resize(nProducts());
+		for (size_t i = 0; i < nRBMs(); ++i) {
+			const RBM rbm = aDBN.getRBM(i);
+			quantizeWeights(rbm.getW(), myWeights.data() + myWeightOffsets[i], myRowScales[i]);
+			if (!unrolled) {
+				quantizeWeights(rbm.getW().transpose(), myWeights.data() + myWeightOffsets[nRBMs() + i], myRowScales[nRBMs() + i]);
+			}
+			myB.push_back(rbm.getB());
+			myC.push_back(rbm.getC());
+		}
+		computeRowSums();
+
+		// Calibrate the data of each product on the activities of the full precision network, along the paths of predict and reverse_predict
+		MatrixXs data = someData, activations;
+		for (size_t i = 0; i < nRBMs(); ++i) {
+			calibrate(data, myDataScales[i], myZeroPoints[i]);
+			activations.noalias() = aDBN.getRBM(i).getW() * data;
+			RBM::biasAndActivitiesInPlace(activations, myC[i], myLayers[i + 1].getType());
+			data.swap(activations);
+		}
+		if (!unrolled) {
+			for (size_t i = nRBMs(); i-- > 0;) {
+				calibrate(data, myDataScales[nRBMs() + i], myZeroPoints[nRBMs() + i]);
+				activations.noalias() = aDBN.getRBM(i).getW().transpose() * data;
+				RBM::biasAndActivitiesInPlace(activations, myB[i], myLayers[i].getType());
+				data.swap(activations);
+			}
+		}
+	}
+
+	QuantizedDeepBeliefNet::QuantizedDeepBeliefNet(const vector<Layer>& layers, const shared_array_ptr<int8_t>& someWeights, const vector<Scalar>& someRowScales,
+	                                               const vector<Scalar>& someDataScales, const vector<int>& someZeroPoints,
+	                                               const vector<Scalar>& someBiases, bool isUnrolled):
+		InferenceDeepBeliefNet(layers, isUnrolled), myWeights(someWeights), myWeightOffsets(), myRowScales(), myRowSums(),
+		myDataScales(someDataScales), myZeroPoints(someZeroPoints) {
+		if (myLayers.size() < 2 || myWeights.size() != computeWeightsSize(myLayers, unrolled) || someRowScales.size() != computeRowScalesSize(myLayers, unrolled)
+		    || myDataScales.size() != nProducts() || myZeroPoints.size() != nProducts()) {
+			throw std::invalid_argument("The weights or scales do not match the layers");
+		}
+		size_t nBiases = 0;
+		for (size_t i = 0; i < nLayers(); ++i) {
+			if (myLayers[i].getSize() > maxLayerSize) throw std::invalid_argument("The layers are too large to be quantized");
+			if (i < nRBMs()) nBiases += myLayers[i].getSize() + myLayers[i + 1].getSize();
+		}
+		if (someBiases.size() != nBiases) {
+			throw std::invalid_argument("The biases do not match the layers");
+		}
+		for (int zeroPoint: myZeroPoints) {
+			if (zeroPoint < 0 || zeroPoint > dataMax) throw std::invalid_argument("The zero points must be between 0 and 255");
+		}
+		computeWeightOffsets();
+		computeRowSums();
+		const Scalar* rowScale = someRowScales.data();
+		for (size_t p = 0; p < nProducts(); ++p) {
+			myRowScales.push_back(Eigen::Map<const ArrayX1s>(rowScale, productRows(p)));
+			rowScale += productRows(p);
+		}
+		const Scalar* bias = someBiases.data();
+		for (size_t i = 0; i < nRBMs(); ++i) {
+			myB.push_back(Eigen::Map<const ArrayX1s>(bias, myLayers[i].getSize()));
+			bias += myLayers[i].getSize();
+			myC.push_back(Eigen::Map<const ArrayX1s>(bias, myLayers[i + 1].getSize()));
+			bias += myLayers[i + 1].getSize();
+		}
+	}
+
+	void QuantizedDeepBeliefNet::computeWeightOffsets() {
+		myWeightOffsets.clear();
+		size_t offset = 0;
+		for (size_t p = 0; p < nProducts(); ++p) {
+			myWeightOffsets.push_back(offset);
+			offset += static_cast<size_t>(productRows(p)) * productColumns(p);
+		}
+	}
+
+	void QuantizedDeepBeliefNet::computeRowSums() {
+		myRowSums.clear();
+		for (size_t p = 0; p < nProducts(); ++p) {
+			const Eigen::Map<const Eigen::Matrix<int8_t, Eigen::Dynamic, Eigen::Dynamic>> Q(myWeights.getOffsetData() + myWeightOffsets[p], productColumns(p), productRows(p));
+			myRowSums.push_back(Q.cast<int32_t>().colwise().sum().transpose().array());
+		}
+	}
+
+	size_t QuantizedDeepBeliefNet::computeWeightsSize(const vector<Layer>& layers, bool isUnrolled) {
+		size_t size = 0;
+		for (size_t i = 0; i + 1 < layers.size(); ++i) {
+			size += static_cast<size_t>(layers[i].getSize()) * layers[i + 1].getSize();
+		}
+		return isUnrolled ? size : 2 * size;
+	}
+
+	size_t QuantizedDeepBeliefNet::computeRowScalesSize(const vector<Layer>& layers, bool isUnrolled) {
+		size_t size = 0;
+		for (size_t i = 0; i + 1 < layers.size(); ++i) {
+			size += layers[i + 1].getSize() + (isUnrolled ? 0 : layers[i].getSize());
+		}
+		return size;
+	}
+
+	vector<Scalar> QuantizedDeepBeliefNet::getRowScales() const {
+		vector<Scalar> rowScales;
+		rowScales.reserve(computeRowScalesSize(myLayers, unrolled));
+		for (const ArrayX1s& scales: myRowScales) {
+			rowScales.insert(rowScales.end(), scales.data(), scales.data() + scales.size());
+		}
+		return rowScales;
+	}
+
+	vector<Scalar> QuantizedDeepBeliefNet::getBiases() const {
+		vector<Scalar> biases;
+		for (size_t i = 0; i < nRBMs(); ++i) {
+			biases.insert(biases.end(), myB[i].data(), myB[i].data() + myB[i].size());
+			biases.insert(biases.end(), myC[i].data(), myC[i].data() + myC[i].size());
+		}
+		return biases;
+	}
+
+	/* Products with the 8 bits weights */
+
+	void QuantizedDeepBeliefNet::productInPlace(size_t p, const MatrixXs& data, MatrixXs& activations) const {
+		MatrixXu8 quantized;
+		quantizeInPlace(data, myDataScales[p], myZeroPoints[p], quantized);
+		MatrixXi32 acc;
+		integerProduct(myWeights.getOffsetData() + myWeightOffsets[p], productRows(p), productColumns(p), quantized, acc);
+		acc.colwise() -= (myZeroPoints[p] * myRowSums[p]).matrix();
+		activations = (acc.cast<Scalar>().array().colwise() * (myRowScales[p] * myDataScales[p])).matrix();
+	}
+}
@@ -1,8 +1,4 @@
-#include <Rcpp.h>
-
 #include <Eigen/Dense>
-using Eigen::ArrayXXd;
-using Eigen::MatrixXd;
 #include <boost/numeric/conversion/cast.hpp>
 
 #include <cassert> // assert
@@ -14,15 +10,14 @@ using std::vector;
 
 #include <DeepLearning/Progress.h>
 #include <DeepLearning/RBM.h>
-#include <DeepLearning/utils.h> // tanhInPlace
+#include <DeepLearning/utils.h> // randomSeed
 #include "Random.h"
 
 
 namespace DeepLearning {
 	RBM RBM::clone() const { // return a deep copy of the object - but the shared_array_ptr is cloned only between offset and over totalSize(), effectively only cloning the weights of the RBM
-		RBM newRBM(*this);
-		newRBM.myData = newRBM.myData.clone();
-		return newRBM;
+		shared_array_ptr<Scalar> data(myData);
+		return RBM(input, output, data.clone(), pretrained); // b, c and W must map the new data
 	}
 	
 	RBM RBM::reverse() const { // returns a reversed clone of the RBM
@@ -37,356 +32,234 @@ namespace DeepLearning {
 		return std::make_tuple(0, aInput.getSize(), aInput.getSize() + aInput.getSize() * aOutput.getSize(), aInput.getSize() + aInput.getSize() * aOutput.getSize() + aOutput.getSize());
 	}
 	
-	void RBM::forwardsDataToActivationsInPlace(const MatrixXd& data, MatrixXd& activations) const {
-		activations = ((W * data).array().colwise() + c);
+	/** Below this absolute activation, the mean of a continuous unit is computed with its Taylor expansion 1/2 + a/12.
+	 * The closed form cancels catastrophically around 0, all the more in single precision.
+	 */
+	static const Scalar continuousLinearRange = sizeof(Scalar) == sizeof(float) ? Scalar(1e-2) : Scalar(1e-5);
+	
+	/** Adds bias (a column of biases, or a single one) to the activations of one column and applies the activity function of target,
+	 * in a single pass over the column, while it is in cache.
+	 */
+	template <typename Activations, typename Bias> static void addBiasAndActivities(Activations act, const Bias& bias, const Layer::Type& target) {
+		if (target == Layer::binary) {
+			act = 1 / ((-(act + bias)).exp() + 1);
+		}
+		else if (target == Layer::gaussian) {
+			act += bias;
+		}
+		else {
+			// Mean of the exponential truncated to [0, 1]: 1 / (1 - exp(-a)) - 1 / a, written with expm1 so that it neither overflows nor cancels
+			act = ((act + bias).abs() < continuousLinearRange).select(0.5 + (act + bias) / 12, -1 / (-(act + bias)).expm1() - 1 / (act + bias));
+		}
+	}
+	
+	/* The matrix products write straight into their destination (noalias), and the bias and the activity function are then applied in a
+	 * single pass (biasAndActivitiesInPlace), rather than through a temporary product, a bias pass and an activity pass.
+	 */
+	void RBM::forwardsDataToActivationsInPlace(const MatrixXs& data, MatrixXs& activations) const {
+		activations.noalias() = W * data;
+		activations.array().colwise() += c;
+	}
+	
+	void RBM::forwardsDataToActivationsInPlace(MatrixXs& data) const {
+		MatrixXs activations;
+		forwardsDataToActivationsInPlace(data, activations);
+		data.swap(activations);
 	}
 	
-	void RBM::forwardsDataToActivationsInPlace(MatrixXd& data) const {
-		data = ((W * data).array().colwise() + c).eval();
+	void RBM::forwardsDataToActivationsInPlace(const SparseMatrixXs& data, MatrixXs& activations) const {
+		activations.noalias() = W * data;
+		activations.array().colwise() += c;
 	}
 	
-	MatrixXd RBM::forwardsDataToActivations(MatrixXd data) const {
+	MatrixXs RBM::forwardsDataToActivations(MatrixXs data) const {
 		forwardsDataToActivationsInPlace(data);
 		return data;
 	}
 	
-	void RBM::forwardsActivationsToActivitiesInPlace(MatrixXd& act) const {
+	void RBM::predictSamplesAsRows(const Eigen::Ref<const MatrixXs>& samples, MatrixXs& predictions) const {
+		// (W * data)^T = data^T * W^T: the same product, with the samples as rows on both sides. Column j is output unit j.
+		predictions.noalias() = samples * W.transpose();
+		for (Eigen_size_type j = 0; j < predictions.cols(); ++j) {
+			addBiasAndActivities(predictions.col(j).array(), c(j), output.getType());
+		}
+	}
+	
+	void RBM::forwardsActivationsToActivitiesInPlace(MatrixXs& act) const {
 		genericActivationsToActivitiesInPlace(act, output.getType());
 	}
 	
 	
-	MatrixXd RBM::forwardsActivationsToActivities(MatrixXd activations) const {
+	MatrixXs RBM::forwardsActivationsToActivities(MatrixXs activations) const {
 		forwardsActivationsToActivitiesInPlace(activations);
 		return activations.matrix();
 	}
 	
-	void RBM::forwardsDataToActivitiesInPlace(const MatrixXd& data, MatrixXd& act) const {
-		forwardsDataToActivationsInPlace(data, act);
-		forwardsActivationsToActivitiesInPlace(act);
+	void RBM::forwardsDataToActivitiesInPlace(const MatrixXs& data, MatrixXs& act) const {
+		act.noalias() = W * data;
+		biasAndActivitiesInPlace(act, c, output.getType());
 	}
 	
-	void RBM::forwardsDataToActivitiesInPlace(MatrixXd& data) const {
-		forwardsDataToActivationsInPlace(data);
-		forwardsActivationsToActivitiesInPlace(data);
+	void RBM::forwardsDataToActivitiesInPlace(const SparseMatrixXs& data, MatrixXs& act) const {
+		act.noalias() = W * data;
+		biasAndActivitiesInPlace(act, c, output.getType());
 	}
 	
-	MatrixXd RBM::forwardsDataToActivities(MatrixXd data) const {
-		forwardsDataToActivationsInPlace(data);
-		forwardsActivationsToActivitiesInPlace(data);
+	void RBM::forwardsDataToActivitiesInPlace(MatrixXs& data) const {
+		MatrixXs act;
+		forwardsDataToActivitiesInPlace(data, act);
+		data.swap(act);
+	}
+	
+	MatrixXs RBM::forwardsDataToActivities(MatrixXs data) const {
+		forwardsDataToActivitiesInPlace(data);
 		return data;	
 	}
 	
 	/* Backward pass functions */
-	void RBM::backwardsHiddenToActivationsInPlace(const MatrixXd& hidden, MatrixXd& activations) const {
-		activations = ((W.transpose() * hidden).array().colwise() + b);
+	void RBM::backwardsHiddenToActivationsInPlace(const MatrixXs& hidden, MatrixXs& activations) const {
+		activations.noalias() = W.transpose() * hidden;
+		activations.array().colwise() += b;
 	}
 	
-	void RBM::backwardsHiddenToActivationsInPlace(MatrixXd& hidden) const {
-		hidden = ((W.transpose() * hidden).array().colwise() + b).eval();
+	void RBM::backwardsHiddenToActivationsInPlace(MatrixXs& hidden) const {
+		MatrixXs activations;
+		backwardsHiddenToActivationsInPlace(hidden, activations);
+		hidden.swap(activations);
 	}
 	
-	MatrixXd RBM::backwardsHiddenToActivations(MatrixXd hidden) const {
+	MatrixXs RBM::backwardsHiddenToActivations(MatrixXs hidden) const {
 		backwardsHiddenToActivationsInPlace(hidden);
 		return hidden;
 	}
 	
-	//void RBM::backwardsActivationsToActivitiesInPlace(ArrayXXd& act) const {
+	//void RBM::backwardsActivationsToActivitiesInPlace(ArrayXXs& act) const {
 	//	genericActivationsToActivitiesInPlace(act, input.getType());
 	//}
 	
-	void RBM::backwardsActivationsToActivitiesInPlace(MatrixXd& act) const {
+	void RBM::backwardsActivationsToActivitiesInPlace(MatrixXs& act) const {
 		genericActivationsToActivitiesInPlace(act, input.getType());
 	}
 	
-	MatrixXd RBM::backwardsActivationsToActivities(MatrixXd activations) const {
+	MatrixXs RBM::backwardsActivationsToActivities(MatrixXs activations) const {
 		backwardsActivationsToActivitiesInPlace(activations);
 		return activations;
 	}
 	
-	void RBM::backwardsHiddenToActivitiesInPlace(const MatrixXd& hidden, MatrixXd& act) const {
-		backwardsHiddenToActivationsInPlace(hidden, act);
-		backwardsActivationsToActivitiesInPlace(act);
+	void RBM::backwardsHiddenToActivitiesInPlace(const MatrixXs& hidden, MatrixXs& act) const {
+		act.noalias() = W.transpose() * hidden;
+		biasAndActivitiesInPlace(act, b, input.getType());
 	}
 	
-	void RBM::backwardsHiddenToActivitiesInPlace(MatrixXd& hidden) const {
-		backwardsHiddenToActivationsInPlace(hidden);
-		backwardsActivationsToActivitiesInPlace(hidden);
+	void RBM::backwardsHiddenToActivitiesInPlace(MatrixXs& hidden) const {
+		MatrixXs act;
+		backwardsHiddenToActivitiesInPlace(hidden, act);
+		hidden.swap(act);
 	}
 	
-	MatrixXd RBM::backwardsHiddenToActivities(MatrixXd hidden) const {
-		backwardsHiddenToActivationsInPlace(hidden);
-		backwardsActivationsToActivitiesInPlace(hidden);
+	MatrixXs RBM::backwardsHiddenToActivities(MatrixXs hidden) const {
+		backwardsHiddenToActivitiesInPlace(hidden);
 		return hidden;
 	}
 	
-	void RBM::genericActivationsToActivitiesInPlace(MatrixXd& act, const Layer::Type& target) const {
-		if (target == Layer::binary) {
-			act.array() = 1 / ((act.array() * (-1)).exp() + 1);
-		}
-		else if (target == Layer::gaussian) {
-			//do nothing
-		}
-		else {
-			act.array() = (act.array().abs() < 1e-5).select(0.5, (act.array().exp() * (1 - 1 / act.array()) + 1 / act.array()) / (act.array().exp() - 1));
+	void RBM::genericActivationsToActivitiesInPlace(MatrixXs& act, const Layer::Type& target) {
+		for (Eigen_size_type j = 0; j < act.cols(); ++j) {
+			addBiasAndActivities(act.col(j).array(), Scalar(0), target);
 		}
 	}
 	
-	// tests if SampleAlpha < Alpha and assigns 1 or 0 into Alpha depending on the result (1 = TRUE, 0 = FALSE)
-	// Modifies Alpha in place
-	void biggerThanInPlace(MatrixXd&, const ArrayXXd&);
-	void biggerThanInPlace(MatrixXd& Alpha, const ArrayXXd& SampleAlpha) {
-		for (int i = 0; i < Alpha.size(); i++) {
-			*(Alpha.data() + i) = *(SampleAlpha.data() + i) < *(Alpha.data() + i) ? 1 : 0;
+	void RBM::biasAndActivitiesInPlace(MatrixXs& act, const Eigen::Ref<const ArrayX1s>& aBias, const Layer::Type& target) {
+		for (Eigen_size_type j = 0; j < act.cols(); ++j) {
+			addBiasAndActivities(act.col(j).array(), aBias, target);
 		}
 	}
 	
-	void RBM::forwardsActivationsToActivitiesSampleInPlace(MatrixXd& act, ArrayXXd sample) const {
+	void RBM::forwardsActivationsToActivitiesSampleInPlace(MatrixXs& act, const ArrayXXs& sample) const {
 		if (output.getType() == Layer::Type::binary) {
-			act = (1 / ((act.array() * (-1)).exp() + 1)).eval();
-			biggerThanInPlace(act, sample);
+			// 1 where the uniform sample is below the probability of the unit, 0 elsewhere
+			act.array() = (sample < 1 / ((-act.array()).exp() + 1)).cast<Scalar>();
 		}
 		else if (output.getType() == Layer::Type::gaussian) {
-			act = (act.array() + sample).eval();
+			act.array() += sample;
 		}
 		else {
-			act = ((act.array().abs() < 1e-6).select(sample, 1 / act.array() * (sample * (act.array().exp() - 1) + 1).log())).eval();
-		}
-	}
-	
-	RBM& RBM::pretrain(const MatrixXd& data, const PretrainParameters& params, PretrainProgress& aProgressFunctor, const ContinueFunction& aContinueFunction) {
-		// assert(1 == 2); // check whether we run in debug mode
-		/* Running eigen threaded? */
-		Eigen::setNbThreads(params.nbThreads);
-		
-		/* data size ? */
-		size_t samplesize = boost::numeric_cast<size_t>(data.cols());
-		
-		/* get pretraining parameters from params */
-		const unsigned int maxIters = params.maxIters;
-		const size_t batchSize = params.batchSize;
-		const Eigen_size_type batchSizeAsEigen = boost::numeric_cast<Eigen_size_type>(batchSize);
-		const double batchSizeAsDouble = boost::numeric_cast<double>(batchSize);
-		const PretrainParameters::PenalizationType penalization = params.penalization;
-		const vector<double> momentums = params.getValidMomentums();
-		const ArrayX1d lambdaBvec = ArrayX1d::Constant(b.size(), params.lambdaB);
-		const ArrayX1d lambdaCvec = ArrayX1d::Constant(c.size(), params.lambdaC);
-		const ArrayXXd lambdaWarr = ArrayXXd::Constant(W.rows(), W.cols(), params.lambdaW);
-		const double epsilonB = params.epsilonB;
-		const double epsilonC = params.epsilonC;
-		const double epsilonW = params.epsilonW;
-		const bool trainB = params.trainB;
-		const bool trainC = params.trainC;
-		
-		// Print some output to let the user know we're doing something
-		Rcpp::Rcout << "Pre-training " << input.getSize() << "-" << input.getTypeAsString() << " x " << output.getSize() << "-" << output.getTypeAsString() << " RBM "
-		      << "with " << maxIters << " x " << batchSize << " out of " << samplesize << std::endl
-		      << "learning rate (b, W, c) = " << epsilonB << ", " << epsilonW << ", " << epsilonC << "; "
-		      << "penalization (b, W, c) = " << PretrainParameters::PenalizationTypeToString(penalization) 
-		      << " * (" << params.lambdaB << ", " << params.lambdaW << ", " << params.lambdaC << "); "
-		      << "updating (b, c) = (" << trainB << ", " << trainC << ")" << std::endl
-		      << "Pre-training until stopCounter reaches " << aContinueFunction.limit << std::endl;
-		
-		// Pre allocate variables that will be used multiple times
-		MatrixXd batch = MatrixXd::Zero(input.getSize(), batchSizeAsEigen);
-		ArrayXXd Winc = MatrixXd::Zero(W.rows(), W.cols());
-		ArrayX1d bInc = ArrayX1d::Zero(b.size());
-		ArrayX1d cInc = ArrayX1d::Zero(c.size());
-		ArrayXXd SampleAlpha = ArrayXXd::Zero(output.getSize(), batchSizeAsEigen); // sample variable for h
-		MatrixXd Alpha = ArrayXXd::Zero(output.getSize(), batchSizeAsEigen); // h.sampled
-		MatrixXd Beta = ArrayXXd::Zero(input.getSize(), batchSizeAsEigen); // P.f.given.h
-		MatrixXd Alpha2 = ArrayXXd::Zero(output.getSize(), batchSizeAsEigen); // P.h.given.f
-		ArrayX1d deltaB, deltaC, tempB, tempC;
-		ArrayXXd deltaW, tempW;
-		// Dummy arrays of 0
-		const ArrayX1d zeroBvec = ArrayX1d::Zero(b.size());
-		const ArrayX1d zeroCvec = ArrayX1d::Zero(c.size());
-		const ArrayXXd zeroWarr = ArrayXXd::Zero(W.rows(), W.cols());
-		
-		// Prepare the random number generator
-		Random sampleRand(output.getType());
-		Random batchRand("uniform_int", samplesize);
-	
-		// Store error in a vector
-		vector<double> errors;
-		errors.reserve(maxIters);
-		
-		// This is the RcppProgress that will display a progress bar / handle user interrupts
-		//Progress p(maxIters, true);
-	
-		// Loop over batches
-		unsigned int stopCounter = 0;
-		unsigned int i = 0;
-		
-		// Modify the batch in place
-		batchRand.setBatch(data, batch);
-		
-		// Start with a null batch progress
-		aProgressFunctor.setBatchSize(batchSize);
-		aProgressFunctor.setMaxIters(maxIters);
-		aProgressFunctor(*this, batch, i);
-		
-		while (stopCounter < aContinueFunction.limit && i < maxIters) {
-			++i;
-			//Rcpp::Rcout << "Pretrain iteration " << i << " / " << params.maxIters << " (batchsize " << params.batchSize << ")" << std::endl;
-	        Rcpp::checkUserInterrupt();
-			
-			// Set Alpha (in-place modification)
-			forwardsDataToActivationsInPlace(batch, Alpha);
-			sampleRand.setRandom(SampleAlpha);
-			forwardsActivationsToActivitiesSampleInPlace(Alpha, SampleAlpha); 
-			
-			// Set Beta (in-place modification)
-			backwardsHiddenToActivitiesInPlace(Alpha, Beta);
-			
-			// Set Alpha2 (in-place modification)
-			forwardsDataToActivitiesInPlace(Beta, Alpha2);
-	
-			// Compute deltas
-			if (trainB) deltaB = ((batch.array() - Beta.array()).rowwise().sum()) / batchSizeAsDouble;
-			if (trainC) deltaC = ((Alpha.array() - Alpha2.array()).rowwise().sum()) / batchSizeAsDouble;
-			deltaW = ((Alpha * batch.transpose()).array() - (Alpha2 * Beta.transpose()).array()) / batchSizeAsDouble;
-			
-			if (trainB) bInc = epsilonB * deltaB;
-			if (trainC) cInc = epsilonC * deltaC;
-			Winc = epsilonW * deltaW;
-			
-			if (penalization == PretrainParameters::PenalizationType::l1) {			
-				// According to Tsuruoka, Tsujii and Ananiadou, 2009 "Stochastic Gradient Descent Training for L1-regularized Log-linear Models with Cumulative Penalty"
-				// in Proceedings of the 47th Annual Meeting of the ACL and the 4th IJCNLP of the AFNLP, pages 477–485
-				// Equation page 479
-				if (trainB) {
-					tempB = b + bInc;
-					b = (tempB != 0).select((tempB > 0).select(
-						zeroBvec.max(tempB - epsilonB * lambdaBvec), // b_i > 0
-						zeroBvec.min(tempB + epsilonB * lambdaBvec)), // b_i < 0
-						zeroBvec); // b_i == 0
-				}
-				
-				if (trainC) {
-					tempC = c + cInc;
-					c = (tempC != 0).select((tempC > 0).select(
-						zeroCvec.max(tempC - epsilonC * lambdaCvec), // c_i > 0
-						zeroCvec.min(tempC + epsilonC * lambdaCvec)), // c_i < 0
-						zeroCvec); // c_i == 0
-				}
-				
-				tempW = W.array() + Winc.array();
-				W.array()= (tempW != 0).select((tempW > 0).select(
-					zeroWarr.max(tempW - epsilonW * lambdaWarr), // w_i > 0
-					zeroWarr.min(tempW + epsilonW * lambdaWarr)), // w_i < 0
-					zeroWarr); // w_i == 0
-			}
-			else if (penalization == PretrainParameters::PenalizationType::l2) {
-				if (trainB) bInc -= epsilonB * lambdaBvec * b;
-				if (trainC) cInc -= epsilonC * lambdaCvec * c;
-				Winc -= epsilonW * lambdaWarr * W.array();
-			}
-
-			if (penalization != PretrainParameters::PenalizationType::l1) {
-				//Update the RBM object
-				if (trainB) b += tanhInPlace(bInc);
-				//b = Beta.rowwise().sum();
-				if (trainC) c += tanhInPlace(cInc);
-				//c = Alpha.rowwise().sum();
-				W.array() += tanhInPlace(Winc);
-			}
-			
-			// Store error
-			errors.push_back(evidenceGradientSum(deltaB, deltaC, deltaW));
-			
-			// Report progress
-			aProgressFunctor(*this, batch, i);
-			
-			// Do we continue?
-			if (i >= params.minIters && i % aContinueFunction.frequency == 0) {
-				aContinueFunction(errors, i, params.batchSize, maxIters) ? stopCounter = 0 : ++stopCounter;
-			}
-			
-			if (stopCounter < aContinueFunction.limit && i < maxIters) {
-				// Modify the batch in place
-				batchRand.setBatch(data, batch);	
-			}
+			// Inverse CDF of the truncated exponential. For a > 0 it is rewritten as 1 + log(s + (1 - s) exp(-a)) / a to avoid the overflow of exp(a)
+			act.array() = (act.array().abs() < 1e-6).select(sample,
+				(act.array() > 0).select(1 + (sample + (1 - sample) * (-act.array()).exp()).log() / act.array(),
+				                         (sample * act.array().expm1()).log1p() / act.array()));
 		}
-		this->pretrained = true;
-		return *this;
-	}
-	
-	
-	double RBM::evidenceGradientSum(const ArrayX1d& deltaB, const ArrayX1d& deltaC, const ArrayXXd& deltaW) const {
-		double error = 0;
-		error += deltaB.square().sum();
-		error += deltaC.square().sum();
-		error += deltaW.square().sum();
-		error /= (nInput() + nOutput() + nWeights());
-		return sqrt(error);
 	}
 	
-	ArrayX1d RBM::error(const Eigen::MatrixXd& data, const Eigen::MatrixXd& reconstructions) const {
+	ArrayX1s RBM::error(const MatrixXs& data, const MatrixXs& reconstructions) const {
 		return (reconstructions.array() - data.array()).square().colwise().mean().sqrt();
 	}
 	
-	double RBM::errorSum(const Eigen::MatrixXd& data, const Eigen::MatrixXd& reconstructions) const {
+	double RBM::errorSum(const MatrixXs& data, const MatrixXs& reconstructions) const {
 		return error(data, reconstructions).sum();
 	}
 	
-	ArrayX1d RBM::error(const MatrixXd& data) const {
-		//MatrixXd reconstructions = reconstruct(data);
+	ArrayX1s RBM::error(const MatrixXs& data) const {
+		//MatrixXs reconstructions = reconstruct(data);
 		return error(data, reconstruct(data));
 	}
 	
-	double RBM::errorSum(const MatrixXd& data) const {
+	double RBM::errorSum(const MatrixXs& data) const {
 		return error(data).sum();
 	}
 	
-	ArrayX1d RBM::energy(const MatrixXd& data) const {
-		ArrayXXd predictions = predict(data);
+	ArrayX1s RBM::energy(const MatrixXs& data) const {
+		ArrayXXs predictions = predict(data);
 		return - (data.array().colwise() + b).colwise().sum() - (predictions.colwise() + c).colwise().sum() - ((W * data).array() * predictions).colwise().sum();
 	}
 	
-	double RBM::energySum(const MatrixXd& data) const {
+	double RBM::energySum(const MatrixXs& data) const {
 		return energy(data).sum();
 	}
 	
 	/* Setting values */
-	RBM& RBM::setB(ArrayX1d aNewB) {
+	RBM& RBM::setB(ArrayX1s aNewB) {
 		assert(b.rows() == aNewB.rows() && b.cols() == aNewB.cols());
 		b = aNewB;
 		return *this;
 	}
-	RBM& RBM::setC(ArrayX1d aNewC) {
+	RBM& RBM::setC(ArrayX1s aNewC) {
 		assert(c.rows() == aNewC.rows() && c.cols() == aNewC.cols());
 		c = aNewC;
 		return *this;
 	}
-	RBM& RBM::setW(Eigen::MatrixXd aNewW) {
+	RBM& RBM::setW(MatrixXs aNewW) {
 		assert(W.rows() == aNewW.rows() && W.cols() == aNewW.cols());
 		W = aNewW;
 		return *this;
 	}
-	RBM& RBM::setB(ArrayX1dMap aNewB) {
+	RBM& RBM::setB(ArrayX1sMap aNewB) {
 		assert(b.rows() == aNewB.rows() && b.cols() == aNewB.cols());
 		b = aNewB;
 		return *this;
 	}
-	RBM& RBM::setC(ArrayX1dMap aNewC) {
+	RBM& RBM::setC(ArrayX1sMap aNewC) {
 		assert(c.rows() == aNewC.rows() && c.cols() == aNewC.cols());
 		c = aNewC;
 		return *this;
 	}
-	RBM& RBM::setW(MatrixXdMap aNewW) {
+	RBM& RBM::setW(MatrixXsMap aNewW) {
 		assert(W.rows() == aNewW.rows() && W.cols() == aNewW.cols());
 		W = aNewW;
 		return *this;
 	}
 	
-	MatrixXd RBM::sample(const MatrixXd& data) const {
+	MatrixXs RBM::sample(const MatrixXs& data) const {
+		return sample(data, randomSeed());
+	}
+	
+	MatrixXs RBM::sample(const MatrixXs& data, uint64_t aSeed, size_t aLayer) const {
 		// Get data size
 		const Eigen_size_type batchSizeAsEigen = data.cols();
 		// Prepare matrices
-		MatrixXd Alpha = ArrayXXd::Zero(output.getSize(), batchSizeAsEigen);
-		ArrayXXd SampleAlpha = ArrayXXd::Zero(output.getSize(), batchSizeAsEigen); 
+		MatrixXs Alpha = ArrayXXs::Zero(output.getSize(), batchSizeAsEigen);
+		ArrayXXs SampleAlpha = ArrayXXs::Zero(output.getSize(), batchSizeAsEigen); 
 		// Prepare random data
-		Random sampleRand(output.getType());
+		Random sampleRand(output.getType(), aSeed, Random::streamId(aLayer, Random::sampling, 0));
 		sampleRand.setRandom(SampleAlpha);
 		
 		// Forward
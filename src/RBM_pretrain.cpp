@@ -0,0 +1,487 @@
+/* This file implements the pre-training (contrastive divergence) part of the RBM.
+*/
+#include <Rcpp.h> // Rcpp::Rcout, Rcpp::checkUserInterrupt
+
+#include <Eigen/Dense>
+#include <boost/numeric/conversion/cast.hpp>
+
+#include <algorithm> // std::max, std::min
+#include <atomic>
+#include <cmath> // std::pow, std::sqrt
+#include <iostream>
+#include <memory> // std::unique_ptr
+#include <stdexcept> // std::invalid_argument
+#include <vector>
+using std::vector;
+
+#include <DeepLearning/Progress.h>
+#include <DeepLearning/RBM.h>
+#include "BatchPrefetcher.h"
+#include "Random.h"
+#include "ThreadPool.h"
+
+
+namespace DeepLearning {
+	namespace {
+		/** Number of elements of b, c or W updated together: the blocks of the parameter, velocity, squares, delta and step
+		 * stay in the L1 cache between the element-wise passes of the update.
+		 */
+		const Eigen_size_type updateBlockSize = 512;
+	}
+	
+	struct RBM::PretrainBuffers {
+		MatrixXs batch;
+		// With sparse data, the non-zeros of the batch, for the products with it
+		bool sparse;
+		SparseMatrixXs sparseBatch;
+		ArrayXXs SampleAlpha; // sample variable for h
+		MatrixXs Alpha; // h.sampled
+		MatrixXs Beta; // P.f.given.h
+		MatrixXs Alpha2; // P.h.given.f
+		// Persistent contrastive divergence: the hidden state of the fantasy chains, the random numbers that sample it, and whether the chains were started
+		MatrixXs Fantasy;
+		ArrayXXs SampleFantasy;
+		bool chainsStarted;
+		ArrayX1s deltaB, deltaC, bInc, cInc;
+		ArrayXXs deltaW, Winc;
+		// Adaptive optimizers: the accumulated squares of the gradients, the number of updates done, and the step of a block of the update
+		ArrayX1s bSquares, cSquares;
+		ArrayXXs WSquares;
+		unsigned int nUpdates;
+		ArrayX1s step;
+		Random sampleRand, batchRand;
+		
+		/** aShard selects the random streams: the shard in synchronous mode, 0 otherwise */
+		PretrainBuffers(const RBM& anRBM, Eigen_size_type batchSize, const BatchSource& data, const PretrainParameters& params, size_t aShard):
+			batch(MatrixXs::Zero(anRBM.nInput(), batchSize)),
+			sparse(data.isSparse()), sparseBatch(),
+			SampleAlpha(ArrayXXs::Zero(anRBM.nOutput(), batchSize)),
+			Alpha(MatrixXs::Zero(anRBM.nOutput(), batchSize)),
+			Beta(MatrixXs::Zero(anRBM.nInput(), batchSize)),
+			Alpha2(MatrixXs::Zero(anRBM.nOutput(), batchSize)),
+			Fantasy(params.persistent ? MatrixXs::Zero(anRBM.nOutput(), batchSize) : MatrixXs()),
+			SampleFantasy(params.persistent ? ArrayXXs::Zero(anRBM.nOutput(), batchSize) : ArrayXXs()),
+			chainsStarted(false),
+			deltaB(ArrayX1s::Zero(anRBM.nInput())), deltaC(ArrayX1s::Zero(anRBM.nOutput())),
+			bInc(ArrayX1s::Zero(anRBM.nInput())), cInc(ArrayX1s::Zero(anRBM.nOutput())),
+			deltaW(ArrayXXs::Zero(anRBM.nOutput(), anRBM.nInput())), Winc(ArrayXXs::Zero(anRBM.nOutput(), anRBM.nInput())),
+			bSquares(params.optimizer != PretrainParameters::sgd ? ArrayX1s::Zero(anRBM.nInput()) : ArrayX1s()),
+			cSquares(params.optimizer != PretrainParameters::sgd ? ArrayX1s::Zero(anRBM.nOutput()) : ArrayX1s()),
+			WSquares(params.optimizer != PretrainParameters::sgd ? ArrayXXs::Zero(anRBM.nOutput(), anRBM.nInput()) : ArrayXXs()),
+			nUpdates(0), step(updateBlockSize),
+			sampleRand(anRBM.tOutput(), params.seed, Random::streamId(params.layer, Random::hiddenSamples, aShard)),
+			batchRand("uniform_int", boost::numeric_cast<size_t>(data.nSamples()), params.seed, Random::streamId(params.layer, Random::batches, aShard)) {
+			// The permutations are only drawn with the first batch: the synchronous shards never draw them, the hogwild threads share the shuffled copy
+			batchRand.setSampling(params.sampling);
+		}
+	};
+	
+	RBM& RBM::pretrain(const DataRef& data, const PretrainParameters& params, PretrainProgress& aProgressFunctor, const ContinueFunction& aContinueFunction) {
+		return pretrain(BatchSource(data), params, aProgressFunctor, aContinueFunction);
+	}
+	
+	RBM& RBM::pretrain(const SparseMatrixXs& data, const PretrainParameters& params, PretrainProgress& aProgressFunctor, const ContinueFunction& aContinueFunction) {
+		return pretrain(BatchSource(data), params, aProgressFunctor, aContinueFunction);
+	}
+	
+	RBM& RBM::pretrain(const BatchSource& data, const PretrainParameters& params, PretrainProgress& aProgressFunctor, const ContinueFunction& aContinueFunction) {
+		// assert(1 == 2); // check whether we run in debug mode
+		/* Running eigen threaded? */
+		Eigen::setNbThreads(params.nbThreads);
+		
+		// Print some output to let the user know we're doing something
+		Rcpp::Rcout << "Pre-training " << input.getSize() << "-" << input.getTypeAsString() << " x " << output.getSize() << "-" << output.getTypeAsString() << " RBM "
+		      << "with " << params.maxIters << " x " << params.batchSize << " out of " << data.nSamples() << std::endl
+		      << "learning rate (b, W, c) = " << params.epsilonB << ", " << params.epsilonW << ", " << params.epsilonC << "; "
+		      << "penalization (b, W, c) = " << PretrainParameters::PenalizationTypeToString(params.penalization)
+		      << " * (" << params.lambdaB << ", " << params.lambdaW << ", " << params.lambdaC << "); "
+		      << "updating (b, c) = (" << params.trainB << ", " << params.trainC << "); "
+		      << "optimizer = " << PretrainParameters::OptimizerTypeToString(params.optimizer) << std::endl
+		      << "Pre-training until stopCounter reaches " << aContinueFunction.limit << std::endl;
+		
+		if (params.gibbsSteps == 0) throw std::invalid_argument("gibbsSteps must be > 0");
+		data.checkSampling(params.sampling);
+		if (params.parallelization == PretrainParameters::hogwild) {
+			pretrainHogwild(data, params, aProgressFunctor, aContinueFunction);
+		}
+		else {
+			pretrainSequential(data, params, aProgressFunctor, aContinueFunction);
+		}
+		
+		this->pretrained = true;
+		return *this;
+	}
+	
+	void RBM::pretrainSequential(const BatchSource& data, const PretrainParameters& params, PretrainProgress& aProgressFunctor, const ContinueFunction& aContinueFunction) {
+		/* get pretraining parameters from params */
+		const unsigned int maxIters = params.maxIters;
+		const size_t batchSize = params.batchSize;
+		const Eigen_size_type batchSizeAsEigen = boost::numeric_cast<Eigen_size_type>(batchSize);
+		
+		// Pre allocate variables that will be used multiple times
+		PretrainBuffers buffers(*this, batchSizeAsEigen, data, params, 0);
+		
+		// In synchronous mode, the threads and the buffers of each shard of the batch
+		const bool synchronous = params.parallelization == PretrainParameters::synchronous;
+		std::unique_ptr<ThreadPool> pool;
+		vector<PretrainBuffers> shards;
+		if (synchronous) {
+			if (params.shardSize == 0) throw std::invalid_argument("shardSize must be > 0");
+			// The threads are our parallelism: don't let Eigen start more of them
+			Eigen::setNbThreads(1);
+			pool.reset(new ThreadPool(params.nbThreads));
+			const size_t nShards = (batchSize + params.shardSize - 1) / params.shardSize;
+			Rcpp::Rcout << "Synchronous pre-training of " << nShards << " shards on " << pool->size() << " threads" << std::endl;
+			shards.reserve(nShards);
+			for (size_t shard = 0; shard < nShards; ++shard) {
+				const size_t shardColumns = std::min(params.shardSize, batchSize - shard * params.shardSize);
+				shards.push_back(PretrainBuffers(*this, boost::numeric_cast<Eigen_size_type>(shardColumns), data, params, shard));
+			}
+		}
+		
+		// Store error in a vector
+		vector<double> errors;
+		errors.reserve(maxIters);
+		
+		// The momentum of each iteration
+		const vector<double> momentums = params.getValidMomentums();
+		
+		// Loop over batches
+		unsigned int stopCounter = 0;
+		unsigned int i = 0;
+		
+		// The batch of iteration i is drawn from the part of the stream reserved to i: the next one can be drawn in the background
+		BatchPrefetcher prefetcher(buffers.batchRand, data, params.prefetch);
+		prefetcher.fetch(1, buffers.batch);
+		
+		// Start with a null batch progress
+		aProgressFunctor.setBatchSize(batchSize);
+		aProgressFunctor.setMaxIters(maxIters);
+		aProgressFunctor(*this, buffers.batch, i);
+		
+		while (stopCounter < aContinueFunction.limit && i < maxIters) {
+			++i;
+			//Rcpp::Rcout << "Pretrain iteration " << i << " / " << params.maxIters << " (batchsize " << params.batchSize << ")" << std::endl;
+	        Rcpp::checkUserInterrupt();
+			
+			if (synchronous) {
+				contrastiveDivergenceSharded(buffers, shards, *pool, params, i);
+			}
+			else {
+				contrastiveDivergence(buffers, params, i);
+			}
+			updateWeights(buffers, params, momentums[i - 1]);
+			
+			// Store error
+			errors.push_back(evidenceGradientSum(buffers.deltaB, buffers.deltaC, buffers.deltaW));
+			
+			// Report progress
+			aProgressFunctor(*this, buffers.batch, i);
+			
+			// Do we continue?
+			if (i >= params.minIters && i % aContinueFunction.frequency == 0) {
+				aContinueFunction(errors, i, params.batchSize, maxIters) ? stopCounter = 0 : ++stopCounter;
+			}
+			
+			if (stopCounter < aContinueFunction.limit && i < maxIters) {
+				prefetcher.fetch(i + 1, buffers.batch);
+			}
+		}
+	}
+	
+	/** Hogwild! pre-training (Niu, Recht, Ré and Wright, 2011 "Hogwild!: A Lock-Free Approach to Parallelizing Stochastic Gradient Descent", NIPS 24).
+	 * Each thread draws its own batches and writes its updates straight into b, c and W without any lock.
+	 * The batches and samples of an iteration are drawn from the streams of the sequential mode at that iteration, whatever the thread:
+	 * the random numbers are reproducible, only the interleaving of the updates is not.
+	 * The iterations are shared between the threads and run in chunks of aContinueFunction.frequency iterations:
+	 * R must only be called from the main thread, so the progress functor, user interrupts and the continue function are
+	 * handled between two chunks, at the iterations where the sequential loop would evaluate the continue function.
+	 */
+	void RBM::pretrainHogwild(const BatchSource& data, const PretrainParameters& params, PretrainProgress& aProgressFunctor, const ContinueFunction& aContinueFunction) {
+		const unsigned int maxIters = params.maxIters;
+		const size_t batchSize = params.batchSize;
+		const Eigen_size_type batchSizeAsEigen = boost::numeric_cast<Eigen_size_type>(batchSize);
+		const unsigned int frequency = std::max(aContinueFunction.frequency, 1u);
+		
+		// The threads are our parallelism: don't let Eigen start more of them
+		Eigen::setNbThreads(1);
+		ThreadPool pool(params.nbThreads);
+		Rcpp::Rcout << "Hogwild pre-training on " << pool.size() << " threads" << std::endl;
+		
+		// One set of buffers (and random number generators) per thread
+		vector<PretrainBuffers> buffers;
+		buffers.reserve(pool.size());
+		for (size_t thread = 0; thread < pool.size(); ++thread) {
+			buffers.push_back(PretrainBuffers(*this, batchSizeAsEigen, data, params, 0));
+			// The threads draw the same permutations: they gather a single shuffled copy of the data per epoch
+			buffers.back().batchRand.shareShuffledData(buffers.front().batchRand);
+		}
+		
+		// Each iteration stores its own error, whatever thread runs it
+		vector<double> iterationErrors(maxIters);
+		vector<double> errors;
+		errors.reserve(maxIters);
+		const vector<double> momentums = params.getValidMomentums();
+		
+		unsigned int stopCounter = 0;
+		unsigned int i = 0;
+		std::atomic<unsigned int> nextIter(0);
+		
+		buffers[0].batchRand.setIteration(1);
+		buffers[0].batchRand.setBatch(data, buffers[0].batch);
+		aProgressFunctor.setBatchSize(batchSize);
+		aProgressFunctor.setMaxIters(maxIters);
+		aProgressFunctor(*this, buffers[0].batch, i);
+		
+		while (stopCounter < aContinueFunction.limit && i < maxIters) {
+			const unsigned int chunkEnd = std::min(maxIters, (i / frequency + 1) * frequency);
+			nextIter = i;
+			pool.parallelFor(pool.size(), [&](size_t thread) {
+				PretrainBuffers& threadBuffers = buffers[thread];
+				unsigned int iter;
+				while ((iter = nextIter++) < chunkEnd) {
+					threadBuffers.batchRand.setIteration(iter + 1);
+					threadBuffers.batchRand.setBatch(data, threadBuffers.batch);
+					contrastiveDivergence(threadBuffers, params, iter + 1);
+					updateWeights(threadBuffers, params, momentums[iter]);
+					iterationErrors[iter] = evidenceGradientSum(threadBuffers.deltaB, threadBuffers.deltaC, threadBuffers.deltaW);
+				}
+			});
+			i = chunkEnd;
+			Rcpp::checkUserInterrupt();
+			errors.assign(iterationErrors.begin(), iterationErrors.begin() + i);
+			
+			// Report progress
+			aProgressFunctor(*this, buffers[0].batch, i);
+			
+			// Do we continue?
+			if (i >= params.minIters && i % frequency == 0) {
+				aContinueFunction(errors, i, params.batchSize, maxIters) ? stopCounter = 0 : ++stopCounter;
+			}
+		}
+	}
+	
+	void RBM::contrastiveDivergence(PretrainBuffers& buffers, const PretrainParameters& params, unsigned int iteration) const {
+		buffers.sampleRand.setIteration(iteration);
+		buffers.sampleRand.setRandom(buffers.SampleAlpha);
+		if (params.persistent) buffers.sampleRand.setRandom(buffers.SampleFantasy);
+		gibbsSampling(buffers, params);
+		computeDeltas(buffers, params, boost::numeric_cast<double>(buffers.batch.cols()));
+	}
+	
+	/** The chain alternates hidden samples and visible probabilities k = params.gibbsSteps times, all in the preallocated buffers:
+	 * Alpha2 holds the intermediate hidden layers and SampleAlpha their random numbers, once Alpha has been sampled with them.
+	 */
+	void RBM::gibbsSampling(PretrainBuffers& buffers, const PretrainParameters& params) const {
+		const bool fromChains = params.persistent && buffers.chainsStarted;
+		const unsigned int k = params.gibbsSteps;
+		
+		// Set Alpha (in-place modification)
+		if (buffers.sparse) {
+			buffers.sparseBatch = buffers.batch.sparseView();
+			forwardsDataToActivationsInPlace(buffers.sparseBatch, buffers.Alpha);
+		}
+		else {
+			forwardsDataToActivationsInPlace(buffers.batch, buffers.Alpha);
+		}
+		
+		// Set Beta (in-place modification). With persistent chains, the negative phase starts from their state rather than from the batch
+		// (except at the first iteration, where the chains start from the batch as in contrastive divergence)
+		if (k == 1 && params.meanFieldLastStep && !fromChains) {
+			// Reconstruct from the probabilities of the hidden layer. The positive phase still uses its sample.
+			buffers.Alpha2 = buffers.Alpha;
+			forwardsActivationsToActivitiesInPlace(buffers.Alpha2);
+			forwardsActivationsToActivitiesSampleInPlace(buffers.Alpha, buffers.SampleAlpha);
+			backwardsHiddenToActivitiesInPlace(buffers.Alpha2, buffers.Beta);
+		}
+		else {
+			forwardsActivationsToActivitiesSampleInPlace(buffers.Alpha, buffers.SampleAlpha);
+			backwardsHiddenToActivitiesInPlace(fromChains ? buffers.Fantasy : buffers.Alpha, buffers.Beta);
+		}
+		
+		// Further Gibbs steps (CD-k)
+		for (unsigned int step = 2; step <= k; ++step) {
+			forwardsDataToActivationsInPlace(buffers.Beta, buffers.Alpha2);
+			if (step == k && params.meanFieldLastStep) {
+				forwardsActivationsToActivitiesInPlace(buffers.Alpha2);
+			}
+			else {
+				buffers.sampleRand.setRandom(buffers.SampleAlpha);
+				forwardsActivationsToActivitiesSampleInPlace(buffers.Alpha2, buffers.SampleAlpha);
+			}
+			backwardsHiddenToActivitiesInPlace(buffers.Alpha2, buffers.Beta);
+		}
+		
+		// Set Alpha2 (in-place modification)
+		if (params.persistent) {
+			// Sample the next state of the chains from the same activations
+			forwardsDataToActivationsInPlace(buffers.Beta, buffers.Alpha2);
+			buffers.Fantasy = buffers.Alpha2;
+			forwardsActivationsToActivitiesSampleInPlace(buffers.Fantasy, buffers.SampleFantasy);
+			forwardsActivationsToActivitiesInPlace(buffers.Alpha2);
+			buffers.chainsStarted = true;
+		}
+		else {
+			forwardsDataToActivitiesInPlace(buffers.Beta, buffers.Alpha2);
+		}
+	}
+	
+	void RBM::computeDeltas(PretrainBuffers& buffers, const PretrainParameters& params, const double divisor) const {
+		// (untrained biases keep a null delta so they don't count in the error)
+		if (params.trainB) buffers.deltaB = ((buffers.batch.array() - buffers.Beta.array()).rowwise().sum()) / divisor;
+		if (params.trainC) buffers.deltaC = ((buffers.Alpha.array() - buffers.Alpha2.array()).rowwise().sum()) / divisor;
+		if (buffers.sparse) {
+			buffers.deltaW = ((buffers.Alpha * buffers.sparseBatch.transpose()).array() - (buffers.Alpha2 * buffers.Beta.transpose()).array()) / divisor;
+		}
+		else {
+			buffers.deltaW = ((buffers.Alpha * buffers.batch.transpose()).array() - (buffers.Alpha2 * buffers.Beta.transpose()).array()) / divisor;
+		}
+	}
+	
+	/** Synchronous data-parallel contrastive divergence.
+	 * The batch is drawn in the calling thread exactly as in the sequential mode, then split into shards of params.shardSize columns.
+	 * The threads draw the hidden samples of each shard from its own stream, compute the Gibbs chain and the (non-averaged) deltas of each shard,
+	 * and the shards are summed with a pairwise tree whose shape only depends on the number of shards.
+	 * Neither the shards nor the order of the additions depend on the number of threads, so the results are bit-identical whatever nbThreads.
+	 */
+	void RBM::contrastiveDivergenceSharded(PretrainBuffers& buffers, vector<PretrainBuffers>& shards, ThreadPool& pool, const PretrainParameters& params, unsigned int iteration) const {
+		const Eigen_size_type batchSize = buffers.batch.cols();
+		const Eigen_size_type shardSize = boost::numeric_cast<Eigen_size_type>(params.shardSize);
+		const size_t nShards = shards.size();
+		
+		pool.parallelFor(nShards, [&](size_t shard) {
+			PretrainBuffers& shardBuffers = shards[shard];
+			const Eigen_size_type firstColumn = boost::numeric_cast<Eigen_size_type>(shard) * shardSize;
+			const Eigen_size_type nColumns = shardBuffers.batch.cols();
+			shardBuffers.batch = buffers.batch.middleCols(firstColumn, nColumns);
+			shardBuffers.sampleRand.setIteration(iteration);
+			shardBuffers.sampleRand.setRandom(shardBuffers.SampleAlpha);
+			if (params.persistent) shardBuffers.sampleRand.setRandom(shardBuffers.SampleFantasy);
+			gibbsSampling(shardBuffers, params);
+			computeDeltas(shardBuffers, params, 1.0);
+		});
+		
+		// Tree reduction into shards[0]: at each level shard s receives shard s + stride.
+		// The element-wise additions are spread over the threads by blocks of columns of W, which doesn't change their results.
+		const Eigen_size_type nColumnsW = W.cols();
+		const size_t nBlocks = pool.size();
+		for (size_t stride = 1; stride < nShards; stride *= 2) {
+			const size_t nPairs = (nShards - stride + 2 * stride - 1) / (2 * stride);
+			pool.parallelFor(nPairs * nBlocks, [&](size_t task) {
+				PretrainBuffers& target = shards[(task / nBlocks) * 2 * stride];
+				const PretrainBuffers& source = shards[(task / nBlocks) * 2 * stride + stride];
+				const size_t block = task % nBlocks;
+				const Eigen_size_type firstColumn = boost::numeric_cast<Eigen_size_type>(block) * nColumnsW / boost::numeric_cast<Eigen_size_type>(nBlocks);
+				const Eigen_size_type lastColumn = boost::numeric_cast<Eigen_size_type>(block + 1) * nColumnsW / boost::numeric_cast<Eigen_size_type>(nBlocks);
+				target.deltaW.middleCols(firstColumn, lastColumn - firstColumn) += source.deltaW.middleCols(firstColumn, lastColumn - firstColumn);
+				if (block == 0) {
+					if (params.trainB) target.deltaB += source.deltaB;
+					if (params.trainC) target.deltaC += source.deltaC;
+				}
+			});
+		}
+		
+		// Average over the whole batch
+		const double batchSizeAsDouble = boost::numeric_cast<double>(batchSize);
+		if (params.trainB) buffers.deltaB = shards[0].deltaB / batchSizeAsDouble;
+		if (params.trainC) buffers.deltaC = shards[0].deltaC / batchSizeAsDouble;
+		buffers.deltaW = shards[0].deltaW / batchSizeAsDouble;
+	}
+	
+	namespace {
+		/** Applies one step of the optimizer to the size elements of aParameter (b, c or W), in place, block by block.
+		 * The gradient is the delta minus the l2 penalty. With sgd, adagrad and rmsprop the increment is a velocity:
+		 * velocity = momentum * velocity + epsilon * scaled gradient, where the gradient is scaled by 1 / (sqrt(squares) + optimizerEpsilon) except with sgd.
+		 * The step is the velocity, or with Nesterov's momentum the look-ahead momentum * velocity + epsilon * scaled gradient
+		 * (in the form of Bengio, Boulanger-Lewandowski and Pascanu, 2013 "Advances in Optimizing Recurrent Networks", ICASSP).
+		 * With adam, the velocity is the first moment of the gradient and the momentum is ignored (Kingma and Ba, 2015 "Adam: A Method for Stochastic Optimization", ICLR).
+		 * The l1 penalty is applied after the step, otherwise the step goes through a tanh.
+		 * nUpdates is the number of updates so far, including this one, for the bias corrections of adam.
+		 */
+		void optimizerStep(Scalar* aParameter, Scalar* aVelocity, Scalar* someSquares, const Scalar* aDelta, ArrayX1s& step, const Eigen_size_type size,
+		                   const double epsilon, const double lambda, const double momentum, const PretrainParameters& params, const unsigned int nUpdates) {
+			const bool l1 = params.penalization == PretrainParameters::PenalizationType::l1;
+			const double l2Lambda = l1 ? 0.0 : lambda;
+			const PretrainParameters::OptimizerType optimizer = params.optimizer;
+			const double beta1 = params.beta1, beta2 = params.beta2;
+			// Adam's bias corrections, folded into the learning rate and optimizerEpsilon
+			const double correction1 = 1 - std::pow(beta1, nUpdates), correction2 = 1 - std::pow(beta2, nUpdates);
+			const double adamEpsilon = epsilon * std::sqrt(correction2) / correction1;
+			const double adamStabilizer = params.optimizerEpsilon * std::sqrt(correction2);
+			
+			for (Eigen_size_type first = 0; first < size; first += updateBlockSize) {
+				const Eigen_size_type n = std::min(updateBlockSize, size - first);
+				ArrayX1sMap parameter(aParameter + first, n), velocity(aVelocity + first, n);
+				const Eigen::Map<const ArrayX1s> delta(aDelta + first, n);
+				auto blockStep = step.head(n);
+				
+				if (optimizer == PretrainParameters::sgd) {
+					velocity = momentum * velocity + epsilon * delta - epsilon * l2Lambda * parameter;
+					if (params.nesterov) {
+						blockStep = momentum * velocity + epsilon * delta - epsilon * l2Lambda * parameter;
+					}
+					else {
+						blockStep = velocity;
+					}
+				}
+				else {
+					ArrayX1sMap squares(someSquares + first, n);
+					blockStep = delta - l2Lambda * parameter; // the gradient
+					if (optimizer == PretrainParameters::adagrad) {
+						squares += blockStep.square();
+					}
+					else {
+						squares = beta2 * squares + (1 - beta2) * blockStep.square();
+					}
+					if (optimizer == PretrainParameters::adam) {
+						velocity = beta1 * velocity + (1 - beta1) * blockStep;
+						blockStep = adamEpsilon * velocity / (squares.sqrt() + adamStabilizer);
+					}
+					else {
+						blockStep = epsilon * blockStep / (squares.sqrt() + params.optimizerEpsilon);
+						velocity = momentum * velocity + blockStep;
+						if (params.nesterov) {
+							blockStep += momentum * velocity;
+						}
+						else {
+							blockStep = velocity;
+						}
+					}
+				}
+				
+				if (l1) {
+					// According to Tsuruoka, Tsujii and Ananiadou, 2009 "Stochastic Gradient Descent Training for L1-regularized Log-linear Models with Cumulative Penalty"
+					// in Proceedings of the 47th Annual Meeting of the ACL and the 4th IJCNLP of the AFNLP, pages 477–485
+					// Equation page 479
+					blockStep += parameter;
+					parameter = (blockStep != 0).select((blockStep > 0).select(
+						(blockStep - epsilon * lambda).max(0.0), // w_i > 0
+						(blockStep + epsilon * lambda).min(0.0)), // w_i < 0
+						0.0); // w_i == 0
+				}
+				else {
+					parameter += blockStep.tanh();
+				}
+			}
+		}
+	}
+	
+	void RBM::updateWeights(PretrainBuffers& buffers, const PretrainParameters& params, const double momentum) {
+		++buffers.nUpdates;
+		if (params.trainB) optimizerStep(b.data(), buffers.bInc.data(), buffers.bSquares.data(), buffers.deltaB.data(), buffers.step, nInput(),
+		                                 params.epsilonB, params.lambdaB, momentum, params, buffers.nUpdates);
+		if (params.trainC) optimizerStep(c.data(), buffers.cInc.data(), buffers.cSquares.data(), buffers.deltaC.data(), buffers.step, nOutput(),
+		                                 params.epsilonC, params.lambdaC, momentum, params, buffers.nUpdates);
+		optimizerStep(W.data(), buffers.Winc.data(), buffers.WSquares.data(), buffers.deltaW.data(), buffers.step, nWeights(),
+		              params.epsilonW, params.lambdaW, momentum, params, buffers.nUpdates);
+	}
+	
+	double RBM::evidenceGradientSum(const ArrayX1s& deltaB, const ArrayX1s& deltaC, const ArrayXXs& deltaW) const {
+		double error = 0;
+		error += deltaB.square().sum();
+		error += deltaC.square().sum();
+		error += deltaW.square().sum();
+		error /= (nInput() + nOutput() + nWeights());
+		return sqrt(error);
+	}
+}
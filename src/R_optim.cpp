@@ -4,7 +4,11 @@ using Rcpp::Rcout;
 #include <boost/format.hpp>
 #include <boost/numeric/conversion/cast.hpp> // safe numeric_cast
 
-#include <cmath> // std::isfinite
+#include <Eigen/Dense>
+
+#include <algorithm> // std::max, std::min
+#include <array>
+#include <cmath> // std::isfinite, std::abs
 using std::isfinite;
 #include <iostream>
 #include <vector>
@@ -15,21 +19,79 @@ using std::vector;
 
 
 namespace DeepLearning {
+	namespace {
+		/** Number of parameters processed together by the kernels of cgmin: large enough to amortize the scheduling, small enough to stay in cache */
+		const size_t chunkSize = 16384;
+		
+		/** Runs kernel(begin, size) on the consecutive chunks of [0, n), on the threads of pool if not null, and returns the sums of its results.
+		 * The results of the chunks are summed in order, so that the sums don't depend on the number of threads.
+		 */
+		template <typename Kernel> std::array<double, 2> sumChunks(size_t n, ThreadPool* pool, const Kernel& kernel) {
+			const size_t nChunks = (n + chunkSize - 1) / chunkSize;
+			vector<std::array<double, 2>> sums(nChunks);
+			auto runChunk = [&](size_t chunk) {
+				const size_t begin = chunk * chunkSize;
+				sums[chunk] = kernel(static_cast<Eigen_size_type>(begin), static_cast<Eigen_size_type>(std::min(chunkSize, n - begin)));
+			};
+			if (pool == nullptr || nChunks < 2) {
+				for (size_t chunk = 0; chunk < nChunks; ++chunk) runChunk(chunk);
+			}
+			else {
+				pool->parallelFor(nChunks, runChunk);
+			}
+			std::array<double, 2> total = {{0.0, 0.0}};
+			for (const auto& sum: sums) {
+				total[0] += sum[0];
+				total[1] += sum[1];
+			}
+			return total;
+		}
+		
+		/** The sums G1 and G2 of the conjugate gradients formula of the given type, over a chunk. Also saves the parameters in X. */
+		template <int type> std::array<double, 2> conjugateSums(const Eigen::Map<ArrayX1s>& Bvec, Eigen::Map<ArrayX1s>& X, const ArrayX1s& g,
+		                                                        const ArrayX1s& c, const ArrayX1s& t, Eigen_size_type begin, Eigen_size_type size) {
+			const auto gi = g.segment(begin, size);
+			const auto ci = c.segment(begin, size);
+			std::array<double, 2> sums;
+			if (type == 1) { /* Fletcher-Reeves */
+				sums[0] = (gi * gi).template cast<double>().sum();
+				sums[1] = (ci * ci).template cast<double>().sum();
+			}
+			else if (type == 2) { /* Polak-Ribiere */
+				sums[0] = (gi * (gi - ci)).template cast<double>().sum();
+				sums[1] = (ci * ci).template cast<double>().sum();
+			}
+			else { /* Beale-Sorenson */
+				sums[0] = (gi * (gi - ci)).template cast<double>().sum();
+				sums[1] = (t.segment(begin, size) * (gi - ci)).template cast<double>().sum();
+			}
+			X.segment(begin, size) = Bvec.segment(begin, size);
+			return sums;
+		}
+	}
+	
 	/* Conjugate gradients, based on R's  src/appl/optim.c, re-crafted to be stand-alone c++ code
 	 * Originally based on Pascal code
 	 * in J.C. Nash, `Compact Numerical Methods for Computers', 2nd edition,
 	 * converted by p2c then re-crafted by B.D. Ripley.
 	 * The code was copied from the R <https://www.r-project.org/> source code in
 	 * src/appl/optim.c.
+	 * The loops over the n parameters are Eigen array expressions over chunks of the vectors, run on the threads of ex.pool if any,
+	 * and the formula of the type is chosen once per gradient rather than once per parameter. The previous gradient c is swapped with g
+	 * rather than copied, and the line search only checks whether any parameter moved instead of counting those that did.
 	 */
-	void cgmin(size_t n, double *Bvec, double *X, double *Fmin,
+	void cgmin(size_t n, Scalar *Bvec, Scalar *X, double *Fmin,
 			   optimfn fminfn, optimgr fmingr, int *fail,
 			   const CgMinParams& params, OptimParameters& ex,
 			   unsigned int *fncount, unsigned int *grcount)
 	{
 		bool accpoint;
-		vector<double> c(n), g(n), t(n);
-		size_t count, cycle, i;
+		const Eigen_size_type size = boost::numeric_cast<Eigen_size_type>(n);
+		// Same type as the weights, the sums below are accumulated in double. The gradient never writes the b of the first layer: it must stay 0
+		ArrayX1s c = ArrayX1s::Zero(size), g = ArrayX1s::Zero(size), t = ArrayX1s::Zero(size);
+		Eigen::Map<ArrayX1s> BvecArray(Bvec, size), XArray(X, size);
+		bool moved;
+		size_t cycle, i;
 		double f;
 		double G1, G2, G3, gradproj;
 		unsigned int funcount = 0, gradcount = 0;
@@ -77,14 +139,27 @@ namespace DeepLearning {
 			*Fmin = f;
 			funcount = 1;
 			gradcount = 0;
+			// Sets Bvec = X + step * t (computed in double as in R) and returns whether any parameter changed at the precision of reltest
+			auto moveAlong = [&](double step, bool checkMoved) {
+				const bool anyMoved = sumChunks(n, ex.pool, [&](Eigen_size_type begin, Eigen_size_type chunk) {
+					const auto x = XArray.segment(begin, chunk).template cast<double>();
+					auto b = BvecArray.segment(begin, chunk);
+					b = (x + step * t.segment(begin, chunk).template cast<double>()).template cast<Scalar>();
+					std::array<double, 2> chunkMoved = {{0.0, 0.0}};
+					if (checkMoved) { // != comparison is safe here, taken from robust R code and using the same algorithm
+						chunkMoved[0] = ((reltest + x) != (reltest + b.template cast<double>())).any() ? 1.0 : 0.0;
+					}
+					return chunkMoved;
+				})[0] > 0;
+				ex.weightsChanged();
+				return anyMoved;
+			};
 			do {
-				for (i = 0; i < n; i++) {
-					t[i] = 0.0;
-					c[i] = 0.0;
-				}
+				t.setZero();
+				c.setZero();
 				cycle = 0;
 				oldstep = 1.0;
-				count = 0;
+				moved = true;
 				do {
 					cycle++;
 					if (trace) {
@@ -107,63 +182,44 @@ namespace DeepLearning {
 					
 					fmingr(g.data(), ex);
 					
-					G1 = 0.0;
-					G2 = 0.0;
-					
-					for (i = 0; i < n; i++) {
-						X[i] = Bvec[i];
-						switch (type) {
-								
-							case 1: /* Fletcher-Reeves */
-								G1 += g[i] * g[i];
-								G2 += c[i] * c[i];
-								break;
-								
-							case 2: /* Polak-Ribiere */
-								G1 += g[i] * (g[i] - c[i]);
-								G2 += c[i] * c[i];
-								break;
-								
-							case 3: /* Beale-Sorenson */
-								G1 += g[i] * (g[i] - c[i]);
-								G2 += t[i] * (g[i] - c[i]);
-								break;
-								
-							default:
-								throw std::runtime_error("unknown type in \"CG\" method of 'optim'");
-						}
-						// DEBUG ONLY:
-						if (!isfinite(G1)) {
-							Rcout << "G1 =" << G1 << std::endl;
-							Rcout << "g[" << i << "] = " << g[i] << std::endl;
-							Rcout << "c[" << i << "] = " << c[i] << std::endl;
-							throw std::runtime_error("Not a number anymore");
-						}
-						c[i] = g[i];
+					std::array<double, 2> G;
+					switch (type) {
+						case 1:
+							G = sumChunks(n, ex.pool, [&](Eigen_size_type begin, Eigen_size_type chunk) {return conjugateSums<1>(BvecArray, XArray, g, c, t, begin, chunk);});
+							break;
+						case 2:
+							G = sumChunks(n, ex.pool, [&](Eigen_size_type begin, Eigen_size_type chunk) {return conjugateSums<2>(BvecArray, XArray, g, c, t, begin, chunk);});
+							break;
+						case 3:
+							G = sumChunks(n, ex.pool, [&](Eigen_size_type begin, Eigen_size_type chunk) {return conjugateSums<3>(BvecArray, XArray, g, c, t, begin, chunk);});
+							break;
+						default:
+							throw std::runtime_error("unknown type in \"CG\" method of 'optim'");
+					}
+					G1 = G[0];
+					G2 = G[1];
+					c.swap(g); // c is the current gradient from now on, and g will receive the next one
+					if (!isfinite(G1)) {
+						Rcout << "G1 =" << G1 << std::endl;
+						throw std::runtime_error("Not a number anymore");
 					}
 					if (G1 > tol) {
 						if (G2 > 0.0)
 							G3 = G1 / G2;
 						else
 							G3 = 1.0;
-						gradproj = 0.0;
-						for (i = 0; i < n; i++) {
-							t[i] = t[i] * G3 - g[i];
-							gradproj += t[i] * g[i];
-						}
+						gradproj = sumChunks(n, ex.pool, [&](Eigen_size_type begin, Eigen_size_type chunk) {
+							auto ti = t.segment(begin, chunk);
+							const auto ci = c.segment(begin, chunk);
+							ti = (ti.template cast<double>() * G3 - ci.template cast<double>()).template cast<Scalar>();
+							return std::array<double, 2> {{(ti * ci).template cast<double>().sum(), 0.0}};
+						})[0];
 						steplength = oldstep;
 						
 						accpoint = false;
 						do {
-							count = 0;
-							for (i = 0; i < n; i++) {
-								Bvec[i] = X[i] + steplength * t[i];
-								if (reltest + X[i] == reltest + Bvec[i]) { // == comparison is safe here, taken from robust R code and using the same algorithm
-									count++;
-								}
-									
-							}
-							if (count < n) { /* point is different */
+							moved = moveAlong(steplength, true);
+							if (moved) { /* point is different */
 								f = fminfn(ex);
 								funcount++;
 								accpoint = (std::isfinite(f) &&
@@ -177,13 +233,12 @@ namespace DeepLearning {
 									*Fmin = f; 
 								} /* we improved, so update value */
 							}
-						} while (!(count == n || accpoint));
-						if (count < n) {
+						} while (moved && !accpoint);
+						if (moved) {
 							newstep = 2 * (f - *Fmin - gradproj * steplength);
 							if (newstep > 0) {
 								newstep = -(gradproj * steplength * steplength / newstep);
-								for (i = 0; i < n; i++)
-									Bvec[i] = X[i] + newstep * t[i];
+								moveAlong(newstep, false);
 								*Fmin = f;
 								f = fminfn(ex);
 								funcount++;
@@ -192,8 +247,7 @@ namespace DeepLearning {
 									if (trace) Rcout << " i< " << std::endl;
 								} else { /* reset Bvec to match lowest point */
 									if (trace) Rcout << " i> " << std::endl;
-									for (i = 0; i < n; i++)
-										Bvec[i] = X[i] + steplength * t[i];
+									moveAlong(steplength, false);
 								}
 							}
 						}
@@ -201,10 +255,10 @@ namespace DeepLearning {
 					oldstep = setstep * steplength;
 					if (oldstep > 1.0)
 						oldstep = 1.0;
-				} while ((count != n) && (G1 > tol) && (cycle != cyclimit));
+				} while (moved && (G1 > tol) && (cycle != cyclimit));
 				
 			} while ((cycle != 1) ||
-					  ((count != n) && (G1 > tol) && *Fmin > abstol));
+					  (moved && (G1 > tol) && *Fmin > abstol));
 			
 		}
 		if (trace) {
@@ -215,4 +269,200 @@ namespace DeepLearning {
 		*fncount = funcount;
 		*grcount = gradcount;
 	}
+	
+	namespace {
+		/** Dot product of two vectors of Scalars, accumulated in double as in cgmin */
+		template <typename A, typename B> double dot(const A& a, const B& b) {
+			return a.template cast<double>().matrix().dot(b.template cast<double>().matrix());
+		}
+	}
+	
+	/* Limited-memory BFGS (Nocedal and Wright, 2006 "Numerical Optimization", 2nd edition, algorithms 7.4 and 7.5),
+	 * with a line search satisfying the strong Wolfe conditions (algorithms 3.5 and 3.6, with quadratic interpolation in the zoom).
+	 * Same interface and evaluation conventions as cgmin: fminfn and fmingr are evaluated at the parameters currently in Bvec,
+	 * and X is a working vector of length n. The line search only computes the gradient at the points that pass the sufficient decrease test.
+	 * The directions are computed with the two-loop recursion on the last params.lmm pairs (s, y), stored as columns of n x lmm matrices.
+	 * *fail is 0 on convergence, 1 when maxit iterations were reached, and 2 when no step could decrease the function.
+	 */
+	void lbfgs(size_t n, Scalar *Bvec, Scalar *X, double *Fmin,
+	           optimfn fminfn, optimgr fmingr, int *fail,
+	           const CgMinParams& params, OptimParameters& ex,
+	           unsigned int *fncount, unsigned int *grcount)
+	{
+		const Eigen_size_type size = boost::numeric_cast<Eigen_size_type>(n);
+		const Eigen_size_type memory = boost::numeric_cast<Eigen_size_type>(std::max(params.lmm, 1u));
+		const double c1 = params.acctol, c2 = params.curvtol;
+		const unsigned int maxLineSearch = 20;
+		const unsigned int maxit = params.maxCgIters;
+		
+		Eigen::Map<ArrayX1s> x(Bvec, size), x0(X, size);
+		ArrayX1s g = ArrayX1s::Zero(size), gNew = ArrayX1s::Zero(size), d(size), s(size), y(size); // getGradient doesn't write the b of the first layer: keep it 0
+		ArrayXXs S(size, memory), Y(size, memory);
+		std::vector<double> rho(static_cast<size_t>(memory)), alpha(static_cast<size_t>(memory));
+		Eigen_size_type nPairs = 0, newest = -1;
+		unsigned int funcount = 0, gradcount = 0;
+		
+		*fail = 0;
+		double f = fminfn(ex);
+		funcount++;
+		if (!std::isfinite(f)) {
+			throw std::runtime_error("Function cannot be evaluated at initial parameters");
+		}
+		*Fmin = f;
+		if (maxit == 0) {
+			*fncount = funcount;
+			*grcount = gradcount;
+			return;
+		}
+		fmingr(gNew.data(), ex);
+		gradcount++;
+		g = gNew;
+		if (params.trace) Rcout << "  L-BFGS function minimizer, memory " << memory << std::endl;
+		
+		// The function and gradient at x0 + a * d: phi(a) and its derivative
+		auto evaluateF = [&](double a) {
+			x = x0 + a * d;
+			ex.weightsChanged();
+			funcount++;
+			return fminfn(ex);
+		};
+		auto evaluateDerivative = [&]() {
+			fmingr(gNew.data(), ex);
+			gradcount++;
+			return dot(gNew, d);
+		};
+		
+		unsigned int iter = 0;
+		while (true) {
+			if (iter++ == maxit) {
+				*fail = 1;
+				break;
+			}
+			
+			// Direction by the two-loop recursion, or steepest descent without history
+			d = -g;
+			if (nPairs > 0) {
+				for (Eigen_size_type k = 0; k < nPairs; ++k) {
+					const Eigen_size_type i = (newest - k + memory) % memory;
+					alpha[static_cast<size_t>(i)] = rho[static_cast<size_t>(i)] * dot(S.col(i), d);
+					d -= alpha[static_cast<size_t>(i)] * Y.col(i);
+				}
+				d *= dot(S.col(newest), Y.col(newest)) / dot(Y.col(newest), Y.col(newest));
+				for (Eigen_size_type k = nPairs; k-- > 0; ) {
+					const Eigen_size_type i = (newest - k + memory) % memory;
+					const double beta = rho[static_cast<size_t>(i)] * dot(Y.col(i), d);
+					d += (alpha[static_cast<size_t>(i)] - beta) * S.col(i);
+				}
+			}
+			double dphi0 = dot(g, d);
+			if (!(dphi0 < 0)) { // not a descent direction: forget the history
+				nPairs = 0;
+				d = -g;
+				dphi0 = dot(g, d);
+			}
+			if (dphi0 == 0) break; // null gradient: converged
+			
+			// Line search. Without history, the first step has the length steplength.
+			x0 = x;
+			const double phi0 = f;
+			double a = nPairs > 0 ? 1.0 : params.steplength / std::sqrt(-dphi0);
+			double aLo = 0, phiLo = phi0, dphiLo = dphi0, aHi = 0, phiHi = 0;
+			bool found = false, zoom = false;
+			unsigned int nEvaluations = 0;
+			while (!found && nEvaluations++ < maxLineSearch) {
+				if (zoom) {
+					// Minimum of the quadratic through phi(aLo), phi'(aLo) and phi(aHi), kept away from the ends of the interval
+					const double width = aHi - aLo;
+					const double curvature = phiHi - phiLo - dphiLo * width;
+					a = std::isfinite(phiHi) && curvature > 0 ? aLo - dphiLo * width * width / (2 * curvature) : aLo + width / 2;
+					const double low = std::min(aLo + 0.1 * width, aHi - 0.1 * width), high = std::max(aLo + 0.1 * width, aHi - 0.1 * width);
+					a = std::min(std::max(a, low), high);
+				}
+				const double phi = evaluateF(a);
+				if (!std::isfinite(phi) || phi > phi0 + c1 * a * dphi0 || (zoom && phi >= phiLo) || (!zoom && aLo > 0 && phi >= phiLo)) {
+					aHi = a;
+					phiHi = phi;
+					zoom = true;
+					continue;
+				}
+				const double dphi = evaluateDerivative();
+				if (std::abs(dphi) <= -c2 * dphi0) {
+					found = true;
+					f = phi;
+				}
+				else if (zoom) {
+					if (dphi * (aHi - aLo) >= 0) {
+						aHi = aLo;
+						phiHi = phiLo;
+					}
+					aLo = a;
+					phiLo = phi;
+					dphiLo = dphi;
+				}
+				else if (dphi >= 0) {
+					aHi = aLo;
+					phiHi = phiLo;
+					aLo = a;
+					phiLo = phi;
+					dphiLo = dphi;
+					zoom = true;
+				}
+				else {
+					aLo = a;
+					phiLo = phi;
+					dphiLo = dphi;
+					a *= 2;
+				}
+			}
+			if (!found) {
+				if (aLo > 0) { // accept the best point with a sufficient decrease
+					x = x0 + aLo * d;
+					ex.weightsChanged();
+					f = phiLo;
+					evaluateDerivative();
+				}
+				else { // no decrease at all: restore the parameters, and give up if even the steepest descent failed
+					x = x0;
+					ex.weightsChanged();
+					if (nPairs == 0) {
+						*fail = 2;
+						break;
+					}
+					nPairs = 0;
+					continue;
+				}
+			}
+			
+			// Update the history with s = x - x0 and y = gNew - g, if the curvature is positive. The step back to aLo doesn't satisfy
+			// the Wolfe conditions and may give a rejected pair: it must not overwrite the oldest pair, which is still in use with a full history.
+			s = x - x0;
+			y = gNew - g;
+			const double sy = dot(s, y);
+			if (sy > 1e-10 * dot(y, y)) {
+				const Eigen_size_type next = (newest + 1) % memory;
+				S.col(next) = s;
+				Y.col(next) = y;
+				rho[static_cast<size_t>(next)] = 1 / sy;
+				newest = next;
+				nPairs = std::min(nPairs + 1, memory);
+			}
+			else if (params.trace) {
+				Rcout << "curvature " << sy << ": pair skipped, " << nPairs << " of " << memory << " pairs in memory" << std::endl;
+			}
+			g = gNew;
+			
+			if (params.trace) Rcout << "iter " << iter << " value " << f << std::endl;
+			const double previousF = *Fmin;
+			*Fmin = f;
+			if (f <= params.abstol || std::abs(previousF - f) <= params.intol * (std::abs(previousF) + params.intol)) break;
+		}
+		
+		if (params.trace) {
+			Rcout << "Exiting from L-BFGS minimizer" << std::endl;
+			Rcout << "	" << funcount << " function evaluations used" << std::endl;
+			Rcout << "	" << gradcount << " gradient evaluations used" << std::endl;
+		}
+		*fncount = funcount;
+		*grcount = gradcount;
+	}
 }
@@ -1,25 +1,62 @@
 #pragma once
 
+#include <cstdint> // uint64_t
+
 #include <DeepLearning/TrainParameters.h>
 #include <DeepLearning/DeepBeliefNet.h>
 #include <DeepLearning/RBM.h>
+#include "ThreadPool.h"
 
 
 namespace DeepLearning {
-	/** Parameters passed to the optimization functions */
+	/** The gradients of the partitions of a batch computed on the threads of a pool, but the first one, which is written into the gradient itself.
+	 * reserve allocates and zeroes them when the number of partitions changes, so the evaluations of a training loop reuse them.
+	 */
+	struct PartitionGradients {
+		vector<shared_array_ptr<Scalar>> data; // data[p - 1] is the gradient of partition p
+		vector<vector<RBM>> rbms; // rbms[p] is bound to data[p - 1]; rbms[0] is unused
+		
+		PartitionGradients(): data(), rbms() {}
+		void reserve(const vector<Layer>& layers, size_t dataSize, size_t nPartitions);
+	};
+	
+	/** Parameters passed to the optimization functions.
+	 * The forward pass of the last evaluation is cached with the version of the weights it was computed at, so that evaluating the gradient where
+	 * the error was just evaluated (or the other way round) runs a single forward pass: optimfn then optimgr at the same point is a fused evaluation.
+	 * The minimizers must call weightsChanged() each time they write the parameters, and invalidateCache() must be called when the content of the batch changes.
+	 */
 	struct OptimParameters {
-		OptimParameters(DeepBeliefNet &aDBN, Eigen::MatrixXd &aMatrix): dbn(aDBN), batch(aMatrix), gradientRBMs() {}
+		OptimParameters(DeepBeliefNet &aDBN, MatrixXs &aMatrix, ThreadPool* aPool = nullptr): dbn(aDBN), batch(aMatrix), gradientRBMs(), partitionGradients(), pool(aPool),
+			cacheValid(false), weightsVersion(0), cachedVersion(0), cachedF(0), cachedActivations(), cachedActivities() {}
 		DeepBeliefNet &dbn;
-		Eigen::MatrixXd &batch;
+		MatrixXs &batch;
 		vector<RBM> gradientRBMs;
+		PartitionGradients partitionGradients; // with a pool, the gradients of the partitions of the batch
+		ThreadPool* pool; // if not null, the error and the gradient are computed in parallel over the columns of the batch, and the loops of cgmin over chunks of the parameters
+		
+		bool cacheValid;
+		uint64_t weightsVersion, cachedVersion; // key of the cache: the version of the weights of dbn now, and at the last forward pass
+		double cachedF;
+		vector<vector<MatrixXs>> cachedActivations, cachedActivities; // per partition of the batch (one without pool)
+		
+		void weightsChanged() {++weightsVersion;}
+		void invalidateCache() {cacheValid = false;}
 	};
 	
 	/** Optimization function typedefs */
 	typedef double optimfn(OptimParameters&);
-	typedef void optimgr(double *, OptimParameters&);
+	typedef void optimgr(Scalar *, OptimParameters&);
 	
 	/** contrasted divergence minimzer */
-	void cgmin(size_t n, double *Bvec, double *X, double *Fmin,
+	void cgmin(size_t n, Scalar *Bvec, Scalar *X, double *Fmin,
+	           optimfn fminfn, optimgr fmingr, int *fail,
+	           const CgMinParams& params, OptimParameters& ex,
+	           unsigned int *fncount, unsigned int *grcount);
+	
+	/** Limited-memory BFGS minimizer with a strong Wolfe line search, with the same interface as cgmin.
+	 * Keeps the last params.lmm corrections, and uses params.curvtol for the curvature condition.
+	 */
+	void lbfgs(size_t n, Scalar *Bvec, Scalar *X, double *Fmin,
 	           optimfn fminfn, optimgr fmingr, int *fail,
 	           const CgMinParams& params, OptimParameters& ex,
 	           unsigned int *fncount, unsigned int *grcount);
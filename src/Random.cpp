@@ -1,74 +1,249 @@
 #include <Eigen/Dense>
-#include <boost/numeric/conversion/cast.hpp>
 
+#include <algorithm> // std::copy, std::max, std::min, std::swap
+#include <cmath> // std::isnan
+#include <cstdint> // uint32_t, uint64_t
+#include <cstring> // std::memcpy
+#include <memory> // std::make_shared
+#include <mutex> // std::lock_guard
 #include <string>
-#include <random> // std::mt19937, std::random_device, std::uniform_int_distribution, std::uniform_real_distribution, std::normal_distribution
-#include <functional> // std::bind
-using std::bind;
-#include <stdexcept> // throw std::invalid_argument
+#include <stdexcept> // throw std::invalid_argument, std::logic_error
 
 #include "Random.h"
 
-using Eigen::ArrayXXd;
-using Eigen::MatrixXd;
-using Eigen::Map;
-
 
 namespace DeepLearning {
-	/*std::mt19937 warmup_mt19937() {
-		std::array<int, std::mt19937::state_size> seed_data;
-		std::random_device r;
-		std::generate_n(seed_data.data(), seed_data.size(), std::ref(r));
-		std::seed_seq seq(std::begin(seed_data), std::end(seed_data));
-		return std::mt19937(seq);
-	}*/
-	
-	void Random::build(const std::string& type) {
-		std::random_device rd;
-		std::mt19937 rng_engine(rd());
+	namespace {
+		// Philox4x32 multipliers and Weyl sequence constants for the key schedule
+		const uint32_t philoxM0 = 0xD2511F53u, philoxM1 = 0xCD9E8D57u;
+		const uint32_t philoxW0 = 0x9E3779B9u, philoxW1 = 0xBB67AE85u;
+		const int philoxRounds = 10;
+
+		/** Converts a block of Philox words to uniform Scalars in [0, 1).
+		 * The random bits are used as the mantissa of a number in [1, 2), then 1 is subtracted: this is exact and,
+		 * contrary to the integer to floating point conversions, it vectorizes.
+		 */
+		template <typename T> struct UniformFromWords;
+
+		template <> struct UniformFromWords<float> {
+			static const size_t perBlock = Philox::blockWords; // 23 bits from each word
+			static void convert(const uint32_t* words, float* dest) {
+				for (size_t i = 0; i < perBlock; ++i) {
+					const uint32_t bits = 0x3f800000u | (words[i] >> 9);
+					float value;
+					std::memcpy(&value, &bits, sizeof(value));
+					dest[i] = value - 1.0f;
+				}
+			}
+		};
+
+		template <> struct UniformFromWords<double> {
+			static const size_t perBlock = Philox::blockWords / 2; // 52 bits from each pair of words
+			static void convert(const uint32_t* words, double* dest) {
+				for (size_t i = 0; i < perBlock; ++i) {
+					const uint64_t bits = 0x3ff0000000000000u | (static_cast<uint64_t>(words[i]) << 20) | (words[i + perBlock] >> 12);
+					double value;
+					std::memcpy(&value, &bits, sizeof(value));
+					dest[i] = value - 1.0;
+				}
+			}
+		};
+
+		typedef UniformFromWords<Scalar> UniformScalars;
+	}
+
+	void Philox::nextBlock(uint32_t* words) {
+		uint32_t c0[lanes], c1[lanes], c2[lanes], c3[lanes];
+		for (size_t lane = 0; lane < lanes; ++lane) {
+			const uint64_t counter = position + lane;
+			c0[lane] = static_cast<uint32_t>(counter);
+			c1[lane] = static_cast<uint32_t>(counter >> 32);
+			c2[lane] = stream[0];
+			c3[lane] = stream[1];
+		}
+		uint32_t k0 = key[0], k1 = key[1];
+		for (int round = 0; round < philoxRounds; ++round) {
+			for (size_t lane = 0; lane < lanes; ++lane) {
+				const uint64_t product0 = static_cast<uint64_t>(philoxM0) * c0[lane];
+				const uint64_t product1 = static_cast<uint64_t>(philoxM1) * c2[lane];
+				const uint32_t n0 = static_cast<uint32_t>(product1 >> 32) ^ c1[lane] ^ k0;
+				const uint32_t n2 = static_cast<uint32_t>(product0 >> 32) ^ c3[lane] ^ k1;
+				c0[lane] = n0;
+				c1[lane] = static_cast<uint32_t>(product1);
+				c2[lane] = n2;
+				c3[lane] = static_cast<uint32_t>(product0);
+			}
+			k0 += philoxW0;
+			k1 += philoxW1;
+		}
+		// Word w of lane l goes to words[w * lanes + l]: stores of whole vectors
+		std::copy(c0, c0 + lanes, words);
+		std::copy(c1, c1 + lanes, words + lanes);
+		std::copy(c2, c2 + lanes, words + 2 * lanes);
+		std::copy(c3, c3 + lanes, words + 3 * lanes);
+		position += lanes;
+	}
+
+	Random::Distribution Random::distributionFromString(const std::string& type, bool hasMax) {
+		if (hasMax) {
+			if (type == "uniform_int") {
+				return uniformInt;
+			}
+			throw std::invalid_argument("'max' is ignored with type != 'uniform_int'");
+		}
 		if (type == "gaussian") {
-	        std::normal_distribution<double> dist(0.0, 1.0);
-	        rngDouble = bind(dist, rng_engine);
+			return gaussian;
 		}
 		else if (type == "uniform_int") {
 			throw std::invalid_argument("'max' is required with type = 'uniform_int'");
 		}
-		else {
-	        std::uniform_real_distribution<double> dist(0.0, 1.0);
-	        rngDouble = bind(dist, rng_engine);
+		return uniform;
+	}
+
+	uint32_t Random::nextWord32() {
+		if (nextWord == Philox::blockWords) {
+			engine.nextBlock(words);
+			nextWord = 0;
 		}
+		return words[nextWord++];
 	}
-	
-	void Random::build(const std::string& type, size_t max) {
-		std::random_device rd;
-		std::mt19937 rng_engine(rd());
-		if (type == "uniform_int") {
-	        std::uniform_int_distribution<int> dist(0.0, boost::numeric_cast<int>(max - 1));
-	        rngInt = bind(dist, rng_engine);
+
+	void Random::fillUniform(Scalar* dest, size_t n) {
+		uint32_t block[Philox::blockWords];
+		size_t i = 0;
+		for (; i + UniformScalars::perBlock <= n; i += UniformScalars::perBlock) {
+			engine.nextBlock(block);
+			UniformScalars::convert(block, dest + i);
 		}
-		else {
-			throw std::invalid_argument("'max' is ignored with type != 'uniform_int'");
+		if (i < n) {
+			Scalar tail[UniformScalars::perBlock];
+			engine.nextBlock(block);
+			UniformScalars::convert(block, tail);
+			std::copy(tail, tail + (n - i), dest + i);
+		}
+	}
+
+	/** Marsaglia's polar method: pairs (u, v) uniform in the unit disc give u * f and v * f, with f = sqrt(-2 log(s) / s) and s = u^2 + v^2.
+	 * It needs no sine or cosine, that Eigen cannot vectorize in double precision. The pairs are drawn, filtered and transformed on whole arrays.
+	 */
+	void Random::fillGaussian(Scalar* dest, size_t n) {
+		size_t filled = 0;
+		while (filled < n) {
+			// About pi / 4 of the pairs are in the disc: draw a few more than needed, and loop in the rare case it was not enough
+			const size_t nPairs = (n - filled + 1) / 2;
+			const Eigen_size_type nDrawn = static_cast<Eigen_size_type>(nPairs + nPairs / 3 + 8);
+			u.resize(nDrawn);
+			v.resize(nDrawn);
+			fillUniform(u.data(), static_cast<size_t>(nDrawn));
+			fillUniform(v.data(), static_cast<size_t>(nDrawn));
+			u = 2 * u - 1;
+			v = 2 * v - 1;
+			s = u.square() + v.square();
+			// Keep the pairs in the disc at the beginning of the arrays
+			Eigen_size_type nKept = 0;
+			for (Eigen_size_type i = 0; i < nDrawn; ++i) {
+				if (s(i) < 1 && s(i) > 0) {
+					u(nKept) = u(i);
+					v(nKept) = v(i);
+					s(nKept) = s(i);
+					++nKept;
+				}
+			}
+			s.head(nKept) = (Scalar(-2) * s.head(nKept).log() / s.head(nKept)).sqrt();
+			for (Eigen_size_type i = 0; i < nKept && filled < n; ++i) {
+				dest[filled++] = u(i) * s(i);
+				if (filled < n) {
+					dest[filled++] = v(i) * s(i);
+				}
+			}
 		}
 	}
-			
-	void Random::setBatch(const MatrixXd& data, MatrixXd& batch) {
-		auto batchsize = batch.cols();
-		for (auto i = 0; i < batchsize; i++) {
-			batch.col(i) = data.col(rngInt());
+
+	/** Fisher-Yates shuffle with the words of the part of the stream reserved to the iteration anEpoch: in epoch mode, the iterations draw no other number */
+	void Random::setEpoch(uint64_t anEpoch, const BatchSource& source, Eigen_size_type nFeatures) {
+		if (anEpoch == currentEpoch) return;
+		const Eigen_size_type nSamples = static_cast<Eigen_size_type>(maxInt);
+		permutation.resize(maxInt);
+		for (Eigen_size_type i = 0; i < nSamples; ++i) {
+			permutation[static_cast<size_t>(i)] = i;
+		}
+		engine.seek(anEpoch << 32);
+		nextWord = Philox::blockWords;
+		for (size_t i = maxInt; i > 1; --i) {
+			const size_t j = static_cast<size_t>((static_cast<uint64_t>(nextWord32()) * i) >> 32);
+			std::swap(permutation[i - 1], permutation[j]);
 		}
+		if (shuffledCopy) {
+			epochData.reset(); // the copy of the previous epoch can be freed before the next one is gathered
+			epochData = shuffledData->get(anEpoch, permutation, source, nFeatures);
+		}
+		currentEpoch = anEpoch;
 	}
-			
-	void Random::setRandom(ArrayXXd& array) {
-		for (int i = 0; i < array.size(); i++) {
-			*(array.data() + i) = rngDouble();
+	
+	std::shared_ptr<const MatrixXs> Random::ShuffledData::get(uint64_t anEpoch, const std::vector<Eigen_size_type>& aPermutation, const BatchSource& source, Eigen_size_type nFeatures) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (anEpoch != epoch) {
+			data.reset();
+			const Eigen_size_type nSamples = static_cast<Eigen_size_type>(aPermutation.size());
+			std::shared_ptr<MatrixXs> copy = std::make_shared<MatrixXs>(nFeatures, nSamples);
+			source.gather(aPermutation.data(), nSamples, *copy, 0);
+			data = copy;
+			epoch = anEpoch;
 		}
+		return data;
 	}
-			
-	void Random::fillMissing(ArrayXXd& array) {
-		for (int i = 0; i < array.size(); i++) {
-			double *currentValue = array.data() + i;
+	
+	void Random::setBatch(const BatchSource& source, MatrixXs& batch) {
+		if (distribution != uniformInt) throw std::logic_error("setBatch requires type = 'uniform_int'");
+		const Eigen_size_type batchsize = batch.cols();
+		if (epochs) {
+			// The batch may span the end of an epoch and the start of the next ones
+			const uint64_t nSamples = maxInt;
+			uint64_t position = (std::max<uint64_t>(iteration, 1) - 1) * static_cast<uint64_t>(batchsize);
+			Eigen_size_type filled = 0;
+			while (filled < batchsize) {
+				setEpoch(position / nSamples, source, batch.rows());
+				const Eigen_size_type offset = static_cast<Eigen_size_type>(position % nSamples);
+				const Eigen_size_type nColumns = std::min(batchsize - filled, static_cast<Eigen_size_type>(nSamples) - offset);
+				if (shuffledCopy) {
+					batch.middleCols(filled, nColumns) = epochData->middleCols(offset, nColumns);
+				}
+				else {
+					source.gather(permutation.data() + offset, nColumns, batch, filled);
+				}
+				filled += nColumns;
+				position += static_cast<uint64_t>(nColumns);
+			}
+			return;
+		}
+		batchColumns.resize(static_cast<size_t>(batchsize));
+		for (auto& column: batchColumns) {
+			// Multiply-shift maps a 32 bits word to [0, maxInt) with a negligible bias for any realistic number of samples
+			column = static_cast<Eigen_size_type>((static_cast<uint64_t>(nextWord32()) * maxInt) >> 32);
+		}
+		source.gather(batchColumns.data(), batchsize, batch, 0);
+	}
+	
+	void Random::setRandom(ArrayXXs& array) {
+		if (distribution == gaussian) {
+			fillGaussian(array.data(), static_cast<size_t>(array.size()));
+		}
+		else if (distribution == uniform) {
+			fillUniform(array.data(), static_cast<size_t>(array.size()));
+		}
+		else {
+			throw std::logic_error("setRandom requires type != 'uniform_int'");
+		}
+	}
+
+	void Random::fillMissing(ArrayXXs& array) {
+		ArrayXXs values(1, (array != array).count()); // NaN != NaN
+		setRandom(values);
+		Eigen_size_type nextValue = 0;
+		for (Eigen_size_type i = 0; i < array.size(); i++) {
+			Scalar *currentValue = array.data() + i;
 			if (std::isnan(*currentValue)) {
-				*currentValue = rngDouble();
+				*currentValue = values(nextValue++);
 			}
 		}
 	}
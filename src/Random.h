@@ -2,43 +2,146 @@
 
 #include <Eigen/Dense>
 
+#include <cstdint> // uint32_t, uint64_t
+#include <memory> // std::shared_ptr
+#include <mutex>
 #include <string>
+#include <vector>
 
+#include <DeepLearning/BatchSource.h>
 #include <DeepLearning/Layer.h>
 #include <DeepLearning/typedefs.h>
+#include <DeepLearning/utils.h> // randomSeed
 
 
 namespace DeepLearning {
+	/** Philox4x32-10 counter-based random number generator (Salmon, Moraes, Dror and Shaw, 2011
+	 * "Parallel random numbers: as easy as 1, 2, 3", SC11).
+	 * Each 128 bits counter is encrypted with a 64 bits key into 4 random 32 bits words. There is no state besides the counter,
+	 * so the counters of a block are independent and processed in fixed-size loops over lanes that the compilers vectorize.
+	 */
+	class Philox {
+		public:
+			/** Number of counters encrypted together by nextBlock */
+			static const size_t lanes = 8;
+			/** Number of 32 bits words returned by nextBlock */
+			static const size_t blockWords = 4 * lanes;
+
+			Philox(uint64_t aKey, uint64_t aStream = 0): key{static_cast<uint32_t>(aKey), static_cast<uint32_t>(aKey >> 32)},
+				stream{static_cast<uint32_t>(aStream), static_cast<uint32_t>(aStream >> 32)}, position(0) {}
+
+			/** Fills words with the next blockWords random words and advances the counter by lanes */
+			void nextBlock(uint32_t* words);
+			/** Moves to an arbitrary position of the stream: there is no state to replay */
+			void seek(uint64_t aPosition) {position = aPosition;}
+
+		private:
+			uint32_t key[2];
+			uint32_t stream[2]; // upper half of the counter
+			uint64_t position; // lower half of the counter
+	};
+
+	/** Random numbers for the RBMs and DBNs: uniform in [0, 1), standard normal and uniform integers in [0, max).
+	 * The values are generated in blocks from a Philox generator and converted with array loops, rather than one call per value.
+	 *
+	 * Reproducible streams: the seed is the Philox key, and the stream (upper half of the counter) is built by streamId from
+	 * the layer, the purpose of the numbers and the thread (or shard). setIteration moves to the part of the stream reserved to
+	 * an iteration, so the numbers drawn at a given (seed, layer, purpose, thread, iteration) don't depend on what was drawn before,
+	 * nor on which thread of the pool draws them.
+	 * The constructors without a seed use a random one from std::random_device.
+	 */
 	class Random  {
-		std::function<int()> rngInt;
-		std::function<double()> rngDouble;
-		void build(const std::string& type, size_t max);
-		void build(const std::string& type);
-	
 		public:
-			Random(const std::string type, size_t max): rngInt(), rngDouble() {build(type, max);}
-			Random(const std::string type): rngInt(), rngDouble() {build(type);}
-			Random(Layer::Type type): rngInt(), rngDouble() {
-				if (type == Layer::Type::gaussian) {
-					build("gaussian");
-				}
-				else {
-					build("");
-				}
+			enum Distribution {uniform, gaussian, uniformInt};
+			/** What the numbers are used for: each purpose has its own streams */
+			enum Purpose {batches, hiddenSamples, sampling, trainBatches};
+
+		private:
+			/** The shuffled copy of the data of the latest epoch, shared by the generators that draw the same permutations (see shareShuffledData).
+			 * A generator keeps the copy of its epoch until it moves to another one, so a copy is freed once no generator reads it anymore.
+			 */
+			class ShuffledData {
+				private:
+					std::mutex mutex;
+					uint64_t epoch;
+					std::shared_ptr<const MatrixXs> data;
+
+				public:
+					ShuffledData(): mutex(), epoch(UINT64_MAX), data() {}
+					/** The copy of the nFeatures rows of source in the order of aPermutation, the permutation of anEpoch, gathered by the first caller */
+					std::shared_ptr<const MatrixXs> get(uint64_t anEpoch, const std::vector<Eigen_size_type>& aPermutation, const BatchSource& source, Eigen_size_type nFeatures);
+			};
+
+			Philox engine;
+			Distribution distribution;
+			size_t maxInt; // uniformInt draws in [0, maxInt)
+			uint32_t words[Philox::blockWords]; // words of the current block not used yet
+			size_t nextWord;
+			ArrayX1s u, v, s; // polar method buffers, kept between calls to avoid allocations
+			std::vector<Eigen_size_type> batchColumns; // columns drawn by setBatch
+			// Epoch sampling (see setEpochs): the iteration of the next batch, and the permutation (and shuffled copy of the data) of the current epoch
+			bool epochs, shuffledCopy;
+			uint64_t iteration, currentEpoch;
+			std::vector<Eigen_size_type> permutation;
+			std::shared_ptr<ShuffledData> shuffledData;
+			std::shared_ptr<const MatrixXs> epochData; // the shuffled copy of the current epoch
+
+			static Distribution distributionFromString(const std::string& type, bool hasMax);
+			uint32_t nextWord32();
+			/** Fills dest with n uniform values in [0, 1) */
+			void fillUniform(Scalar* dest, size_t n);
+			/** Fills dest with n standard normal values */
+			void fillGaussian(Scalar* dest, size_t n);
+			/** Draws the permutation of anEpoch (and the shuffled copy of the nFeatures rows of source), unless it is the current one */
+			void setEpoch(uint64_t anEpoch, const BatchSource& source, Eigen_size_type nFeatures);
+
+		public:
+			Random(const std::string type, size_t max): engine(randomSeed()), distribution(distributionFromString(type, true)), maxInt(max), words(), nextWord(Philox::blockWords), u(), v(), s(), batchColumns(),
+				epochs(false), shuffledCopy(false), iteration(1), currentEpoch(UINT64_MAX), permutation(), shuffledData(), epochData() {}
+			Random(const std::string type): engine(randomSeed()), distribution(distributionFromString(type, false)), maxInt(0), words(), nextWord(Philox::blockWords), u(), v(), s(), batchColumns(),
+				epochs(false), shuffledCopy(false), iteration(1), currentEpoch(UINT64_MAX), permutation(), shuffledData(), epochData() {}
+			Random(Layer::Type type): engine(randomSeed()), distribution(type == Layer::Type::gaussian ? gaussian : uniform), maxInt(0), words(), nextWord(Philox::blockWords), u(), v(), s(), batchColumns(),
+				epochs(false), shuffledCopy(false), iteration(1), currentEpoch(UINT64_MAX), permutation(), shuffledData(), epochData() {}
+			Random(const std::string type, size_t max, uint64_t seed, uint64_t stream): engine(seed, stream), distribution(distributionFromString(type, true)), maxInt(max), words(), nextWord(Philox::blockWords), u(), v(), s(), batchColumns(),
+				epochs(false), shuffledCopy(false), iteration(1), currentEpoch(UINT64_MAX), permutation(), shuffledData(), epochData() {}
+			Random(Layer::Type type, uint64_t seed, uint64_t stream): engine(seed, stream), distribution(type == Layer::Type::gaussian ? gaussian : uniform), maxInt(0), words(), nextWord(Philox::blockWords), u(), v(), s(), batchColumns(),
+				epochs(false), shuffledCopy(false), iteration(1), currentEpoch(UINT64_MAX), permutation(), shuffledData(), epochData() {}
+			/** Stream of the numbers used for aPurpose by aThread (or shard) when training layer aLayer: 24 bits of layer, 8 of purpose and 32 of thread */
+			static uint64_t streamId(size_t aLayer, Purpose aPurpose, size_t aThread) {
+				return (static_cast<uint64_t>(aLayer) << 40) | (static_cast<uint64_t>(aPurpose) << 32) | static_cast<uint32_t>(aThread);
+			}
+			/** Moves to the start of the numbers of iteration anIteration. Each iteration has 2^32 counters, i.e. 2^34 words. */
+			void setIteration(uint64_t anIteration) {
+				engine.seek(anIteration << 32);
+				nextWord = Philox::blockWords; // discard the words left from the previous position
+				iteration = anIteration;
+			}
+			/** Switches setBatch to epochs: the columns are permuted once per epoch, and the batch of iteration i (from 1) is made of the consecutive
+			 * positions (i - 1) * batchSize to i * batchSize - 1 of the sequence of the permutations of the epochs. Each sample is then seen once per epoch.
+			 * The permutation of an epoch only depends on the seed, the stream and the epoch, so the batch of an iteration still only depends on them.
+			 * With aShuffledCopy, the data is gathered once per epoch in the order of the permutation, and the batches are copies of contiguous columns of it.
+			 * This costs a copy of the data, but reads it in order (one whole feature at a time with the samples as rows) rather than at random for each batch.
+			 * setBatch must then always be called with the same source, a dense matrix: the copy would load a memory-mapped dataset in memory and densify sparse data.
+			 */
+			void setEpochs(bool aShuffledCopy) {
+				epochs = true;
+				shuffledCopy = aShuffledCopy;
+				if (shuffledCopy && !shuffledData) shuffledData = std::make_shared<ShuffledData>();
+			}
+			/** Draws the batches of setBatch with aSampling: at random with replacement, or by epochs (see setEpochs) */
+			void setSampling(BatchSource::SamplingType aSampling) {
+				if (aSampling != BatchSource::replacement) setEpochs(aSampling == BatchSource::shuffled);
 			}
-			Random(Layer::Type type, size_t max): rngInt(), rngDouble() {
-				if (type == Layer::Type::gaussian) {
-					build("gaussian", max);
-				}
-				else {
-					build("", max);
-				}
+			/** Uses the shuffled copies of other, which must draw the same permutations (same seed and stream), rather than copying the data again */
+			void shareShuffledData(const Random& other) {
+				shuffledData = other.shuffledData;
 			}
-			/** Creates a batch by extracting random columns of data */
-			void setBatch(const Eigen::MatrixXd& data, Eigen::MatrixXd& batch);
+			/** Creates a batch by extracting random columns of source, or the next columns of the permutation of the current epoch (see setEpochs) */
+			void setBatch(const BatchSource& source, MatrixXs& batch);
+			void setBatch(const DataRef& data, MatrixXs& batch) {setBatch(BatchSource(data), batch);}
 			/** Fill an entire array with random values */
-			void setRandom(Eigen::ArrayXXd& array);
+			void setRandom(ArrayXXs& array);
 			/** Replace missing values in array with random values */
-			void fillMissing(Eigen::ArrayXXd& array);
+			void fillMissing(ArrayXXs& array);
 	};
 }
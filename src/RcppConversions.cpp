@@ -1,6 +1,8 @@
 #include <Rcpp.h>
 using Rcpp::List;
 using Rcpp::NumericVector;
+using Rcpp::IntegerVector;
+using Rcpp::RawVector;
 using Rcpp::Environment;
 using Rcpp::as;
 #include <RcppEigen.h> 
@@ -11,6 +13,7 @@ using Rcpp::as;
 using std::string;
 #include <stdexcept> // throw std::runtime_error, std::invalid_argument
 using std::runtime_error;
+#include <cstdint> // uint16_t
 #include <tuple>
 #include <vector>
 using std::vector;
@@ -19,9 +22,12 @@ using std::vector;
 using std::unique_ptr;
 
 #include <RcppConversions.h>
+#include <DeepLearning/CompactDeepBeliefNet.h>
 #include <DeepLearning/DeepBeliefNet.h>
 #include <DeepLearning/RBM.h>
 #include <DeepLearning/Layer.h>
+#include <DeepLearning/PrunedDeepBeliefNet.h>
+#include <DeepLearning/QuantizedDeepBeliefNet.h>
 
 // define template specialisations for as and wrap
 namespace Rcpp {
@@ -32,14 +38,30 @@ namespace Rcpp {
 		return boost::numeric_cast<size_t>(i);
 	}
 	
-	// shared_array_ptr<double>
-	template <> shared_array_ptr<double> as(SEXP ptr) {
+	// shared_array_ptr<Scalar>: R always stores doubles, converted to Scalar
+	template <> shared_array_ptr<Scalar> as(SEXP ptr) {
 		NumericVector NumericVectorPtr(as<NumericVector>(ptr));
-		return shared_array_ptr<double>(NumericVectorPtr.begin(), NumericVectorPtr.end(), true); // that's a copy, so clean-up
+		return shared_array_ptr<Scalar>(NumericVectorPtr.begin(), NumericVectorPtr.end(), true); // that's a copy, so clean-up
 	}
 
-	template <> SEXP wrap(const shared_array_ptr<double> &ptr) {
-		return wrap(ptr.toVector());
+	template <> SEXP wrap(const shared_array_ptr<Scalar> &ptr) {
+		return NumericVector(ptr.getOffsetData(), ptr.getOffsetData() + ptr.size()); // a single copy, straight into R's memory
+	}
+	
+	/** The weights of the RBMs and DBNs coming from R: when Scalar is double, the memory of the R vector is used directly, without a copy.
+	 * The vector is protected by the R object passed to the exported function for the whole call, and the shared_array_ptr doesn't own it
+	 * (cleanUp = false): functions that modify the weights in place must work on a clone (see writableCopy in RtoCppInterface.h).
+	 * Otherwise (or if the weights are not stored as doubles and must be coerced) the weights are converted into a new array owned by the shared_array_ptr.
+	 */
+	template <typename T> static shared_array_ptr<T> mapWeights(SEXP weights) {
+		return as<shared_array_ptr<T>>(weights);
+	}
+	
+	template <> shared_array_ptr<double> mapWeights(SEXP weights) {
+		if (!Rf_isReal(weights)) {
+			return as<shared_array_ptr<double>>(weights);
+		}
+		return shared_array_ptr<double>(REAL(weights), boost::numeric_cast<size_t>(Rf_xlength(weights)), false);
 	}
 	
 	SEXP wrap_with_additionalOffset(const offsets &someOffsets, size_t additionalOffset) {
@@ -82,10 +104,9 @@ namespace Rcpp {
 
 		// Grab weights in env
 		Environment env = as<Environment>(rbmList["weights.env"]);
-		NumericVector weights = as<NumericVector>(env["weights"]);
 		
 		// Make shared_array_ptr
-		shared_array_ptr<double> data(as<shared_array_ptr<double>>(weights));
+		shared_array_ptr<Scalar> data(mapWeights<Scalar>(env["weights"]));
 	
 		// Build the RBM
 		Layer input(as<Layer>(rbmList["input"]));
@@ -125,10 +146,9 @@ namespace Rcpp {
 
 		// Grab weights in env
 		Environment env = as<Environment>(dbnList["weights.env"]);
-		NumericVector weights = as<NumericVector>(env["weights"]);
 		
 		// Make shared_array_ptr
-		shared_array_ptr<double> dataPtr = as<shared_array_ptr<double>>(weights);
+		shared_array_ptr<Scalar> dataPtr = mapWeights<Scalar>(env["weights"]);
 		
 		// Build the list of layers
 		List LayersList = as<List>(dbnList["layers"]);
@@ -187,6 +207,226 @@ namespace Rcpp {
 		return wrap(dbnList);
 	}
 	
+	// CompactDeepBeliefNet
+	// The 16 bits weights are stored in a raw vector, 2 bytes per weight in little-endian order, so that saved models can be shared across platforms.
+	static bool isLittleEndian() {
+		const uint16_t probe = 1;
+		return *reinterpret_cast<const unsigned char*>(&probe) == 1;
+	}
+	
+	template <> CompactDeepBeliefNet as(SEXP compactDbn) {
+		List dbnList = as<List>(compactDbn);
+		if (as<string>(dbnList.attr("class")) != "CompactDeepBeliefNet") {
+			throw runtime_error("Expected a CompactDeepBeliefNet object, not " + as<string>(dbnList.attr("class")));
+		}
+		
+		std::vector<Layer> LayersVector;
+		for (auto aLayer : as<List>(dbnList["layers"])) {
+			LayersVector.push_back(as<Layer>(aLayer));
+		}
+		
+		// A vector of another type would be coerced into a new vector that only the local RawVector protects, and the network would point to freed memory
+		SEXP weightsSexp = dbnList["weights"];
+		if (TYPEOF(weightsSexp) != RAWSXP) {
+			throw runtime_error("The weights of a CompactDeepBeliefNet must be a raw vector");
+		}
+		RawVector weights(weightsSexp);
+		if (weights.size() % 2 != 0) {
+			throw runtime_error("The weights of a CompactDeepBeliefNet must have an even number of bytes");
+		}
+		size_t nWeights = boost::numeric_cast<size_t>(weights.size() / 2);
+		// On little-endian platforms, use the memory of the raw vector directly, without a copy: it is protected by the list passed from R for the whole call
+		shared_array_ptr<uint16_t> weightsPtr = isLittleEndian() ?
+			shared_array_ptr<uint16_t>(reinterpret_cast<uint16_t*>(weights.begin()), nWeights, false) :
+			shared_array_ptr<uint16_t>(nWeights);
+		if (!isLittleEndian()) {
+			for (size_t i = 0; i < nWeights; ++i) {
+				weightsPtr[i] = static_cast<uint16_t>(weights[2 * i] | (weights[2 * i + 1] << 8));
+			}
+		}
+		
+		NumericVector biases = as<NumericVector>(dbnList["biases"]);
+		
+		return CompactDeepBeliefNet(LayersVector, CompactDeepBeliefNet::formatFromString(as<string>(dbnList["format"])), weightsPtr,
+		                            vector<Scalar>(biases.begin(), biases.end()), as<bool>(dbnList["unrolled"]));
+	}
+	
+	template <> SEXP wrap(const CompactDeepBeliefNet &compactDbn) {
+		List layersList;
+		for (Layer layer: compactDbn.getLayers()) {
+			layersList.push_back(layer);
+		}
+		
+		shared_array_ptr<uint16_t> weightsPtr = compactDbn.getWeights();
+		RawVector weights(boost::numeric_cast<int>(2 * weightsPtr.size()));
+		for (size_t i = 0; i < weightsPtr.size(); ++i) {
+			weights[2 * i] = static_cast<Rbyte>(weightsPtr[i] & 0xffu);
+			weights[2 * i + 1] = static_cast<Rbyte>(weightsPtr[i] >> 8);
+		}
+		
+		vector<Scalar> biases = compactDbn.getBiases();
+		
+		List dbnList = List::create(
+			Named("layers") = wrap(layersList),
+			Named("weights") = weights,
+			Named("biases") = NumericVector(biases.begin(), biases.end()),
+			Named("format") = wrap(compactDbn.getFormatAsString()),
+			Named("unrolled") = wrap(compactDbn.isUnrolled())
+		);
+		dbnList.attr("class") = "CompactDeepBeliefNet";
+		return wrap(dbnList);
+	}
+	
+	// PrunedDeepBeliefNet
+	// Each RBM is a list with its biases b and c, and either a dense weights matrix W, or the compressed sparse columns of W
+	// as in the i, p and x slots of a dgCMatrix of the Matrix package (0-based row indices, column pointers and values).
+	template <> PrunedDeepBeliefNet as(SEXP prunedDbn) {
+		List dbnList = as<List>(prunedDbn);
+		if (as<string>(dbnList.attr("class")) != "PrunedDeepBeliefNet") {
+			throw runtime_error("Expected a PrunedDeepBeliefNet object, not " + as<string>(dbnList.attr("class")));
+		}
+		
+		std::vector<Layer> LayersVector;
+		for (auto aLayer : as<List>(dbnList["layers"])) {
+			LayersVector.push_back(as<Layer>(aLayer));
+		}
+		List rbmsList = as<List>(dbnList["rbms"]);
+		if (LayersVector.size() < 2 || boost::numeric_cast<size_t>(rbmsList.size()) != LayersVector.size() - 1) {
+			throw runtime_error("The RBMs of the PrunedDeepBeliefNet do not match its layers");
+		}
+		
+		vector<MatrixXs> denseW;
+		vector<SparseMatrixXs> sparseW;
+		vector<ArrayX1s> b, c;
+		for (R_xlen_t i = 0; i < rbmsList.size(); ++i) {
+			List rbmList = as<List>(rbmsList[i]);
+			const Eigen_size_type nInput = LayersVector[i].getSize(), nOutput = LayersVector[i + 1].getSize();
+			b.push_back(as<Eigen::Map<Eigen::VectorXd>>(rbmList["b"]).cast<Scalar>().array());
+			c.push_back(as<Eigen::Map<Eigen::VectorXd>>(rbmList["c"]).cast<Scalar>().array());
+			if (rbmList.containsElementNamed("W")) {
+				denseW.push_back(as<Eigen::Map<Eigen::MatrixXd>>(rbmList["W"]).cast<Scalar>());
+				sparseW.push_back(SparseMatrixXs());
+				continue;
+			}
+			IntegerVector rows = as<IntegerVector>(rbmList["i"]), pointers = as<IntegerVector>(rbmList["p"]);
+			NumericVector values = as<NumericVector>(rbmList["x"]);
+			if (pointers.size() != nInput + 1 || pointers[0] != 0 || pointers[nInput] != rows.size() || rows.size() != values.size()) {
+				throw runtime_error("Invalid sparse weights in the PrunedDeepBeliefNet");
+			}
+			// Checked as they are inserted, since the R object may have been modified
+			SparseMatrixXs W(nOutput, nInput);
+			W.reserve(values.size());
+			for (Eigen_size_type column = 0; column < nInput; ++column) {
+				if (pointers[column + 1] < pointers[column]) throw runtime_error("Invalid sparse weights in the PrunedDeepBeliefNet");
+				W.startVec(column);
+				for (int k = pointers[column]; k < pointers[column + 1]; ++k) {
+					if (rows[k] < 0 || rows[k] >= nOutput || (k > pointers[column] && rows[k] <= rows[k - 1])) {
+						throw runtime_error("Invalid sparse weights in the PrunedDeepBeliefNet");
+					}
+					W.insertBack(rows[k], column) = static_cast<Scalar>(values[k]);
+				}
+			}
+			W.finalize();
+			denseW.push_back(MatrixXs());
+			sparseW.push_back(W);
+		}
+		
+		return PrunedDeepBeliefNet(LayersVector, denseW, sparseW, b, c, as<bool>(dbnList["unrolled"]));
+	}
+	
+	template <> SEXP wrap(const PrunedDeepBeliefNet &prunedDbn) {
+		List layersList;
+		for (Layer layer: prunedDbn.getLayers()) {
+			layersList.push_back(layer);
+		}
+		
+		List rbmsList;
+		for (size_t i = 0; i < prunedDbn.nRBMs(); ++i) {
+			const NumericVector b = wrap(prunedDbn.getB(i).cast<double>().eval()), c = wrap(prunedDbn.getC(i).cast<double>().eval());
+			if (prunedDbn.isSparse(i)) {
+				const SparseMatrixXs& W = prunedDbn.getSparseW(i);
+				rbmsList.push_back(List::create(
+					Named("b") = b,
+					Named("c") = c,
+					Named("i") = IntegerVector(W.innerIndexPtr(), W.innerIndexPtr() + W.nonZeros()),
+					Named("p") = IntegerVector(W.outerIndexPtr(), W.outerIndexPtr() + W.outerSize() + 1),
+					Named("x") = NumericVector(W.valuePtr(), W.valuePtr() + W.nonZeros())
+				));
+			}
+			else {
+				rbmsList.push_back(List::create(
+					Named("b") = b,
+					Named("c") = c,
+					Named("W") = wrap(prunedDbn.getDenseW(i).cast<double>().eval())
+				));
+			}
+		}
+		
+		List dbnList = List::create(
+			Named("layers") = wrap(layersList),
+			Named("rbms") = rbmsList,
+			Named("unrolled") = wrap(prunedDbn.isUnrolled())
+		);
+		dbnList.attr("class") = "PrunedDeepBeliefNet";
+		return wrap(dbnList);
+	}
+	
+	// QuantizedDeepBeliefNet
+	// The 8 bits weights are stored in a raw vector, one byte per weight in two's complement, that is used directly without a copy.
+	template <> QuantizedDeepBeliefNet as(SEXP quantizedDbn) {
+		List dbnList = as<List>(quantizedDbn);
+		if (as<string>(dbnList.attr("class")) != "QuantizedDeepBeliefNet") {
+			throw runtime_error("Expected a QuantizedDeepBeliefNet object, not " + as<string>(dbnList.attr("class")));
+		}
+		
+		std::vector<Layer> LayersVector;
+		for (auto aLayer : as<List>(dbnList["layers"])) {
+			LayersVector.push_back(as<Layer>(aLayer));
+		}
+		
+		// The raw vector is protected by the list passed from R for the whole call. A vector of another type would be coerced into
+		// a new vector that only the local RawVector protects, and the network would point to freed memory.
+		SEXP weightsSexp = dbnList["weights"];
+		if (TYPEOF(weightsSexp) != RAWSXP) {
+			throw runtime_error("The weights of a QuantizedDeepBeliefNet must be a raw vector");
+		}
+		RawVector weights(weightsSexp);
+		shared_array_ptr<int8_t> weightsPtr(reinterpret_cast<int8_t*>(weights.begin()), boost::numeric_cast<size_t>(weights.size()), false);
+		
+		NumericVector rowScales = as<NumericVector>(dbnList["scales"]);
+		NumericVector dataScales = as<NumericVector>(dbnList["data.scales"]);
+		IntegerVector zeroPoints = as<IntegerVector>(dbnList["zero.points"]);
+		NumericVector biases = as<NumericVector>(dbnList["biases"]);
+		
+		return QuantizedDeepBeliefNet(LayersVector, weightsPtr, vector<Scalar>(rowScales.begin(), rowScales.end()),
+		                              vector<Scalar>(dataScales.begin(), dataScales.end()), vector<int>(zeroPoints.begin(), zeroPoints.end()),
+		                              vector<Scalar>(biases.begin(), biases.end()), as<bool>(dbnList["unrolled"]));
+	}
+	
+	template <> SEXP wrap(const QuantizedDeepBeliefNet &quantizedDbn) {
+		List layersList;
+		for (Layer layer: quantizedDbn.getLayers()) {
+			layersList.push_back(layer);
+		}
+		
+		shared_array_ptr<int8_t> weightsPtr = quantizedDbn.getWeights();
+		RawVector weights(weightsPtr.getOffsetData(), weightsPtr.getOffsetData() + weightsPtr.size());
+		
+		vector<Scalar> rowScales = quantizedDbn.getRowScales(), dataScales = quantizedDbn.getDataScales(), biases = quantizedDbn.getBiases();
+		
+		List dbnList = List::create(
+			Named("layers") = wrap(layersList),
+			Named("weights") = weights,
+			Named("scales") = NumericVector(rowScales.begin(), rowScales.end()),
+			Named("data.scales") = NumericVector(dataScales.begin(), dataScales.end()),
+			Named("zero.points") = wrap(quantizedDbn.getZeroPoints()),
+			Named("biases") = NumericVector(biases.begin(), biases.end()),
+			Named("unrolled") = wrap(quantizedDbn.isUnrolled())
+		);
+		dbnList.attr("class") = "QuantizedDeepBeliefNet";
+		return wrap(dbnList);
+	}
+	
 	// PretrainParameters
 	template <> PretrainParameters as(SEXP someParams) {
 		List paramList(as<List>(someParams));
@@ -222,6 +462,18 @@ namespace Rcpp {
 		if (paramList.containsElementNamed("maxiters")) params.setMaxIters(boost::numeric_cast<unsigned int>(as<int>(paramList["maxiters"])));
 		if (paramList.containsElementNamed("batchsize")) params.setBatchSize(boost::numeric_cast<size_t>(as<int>(paramList["batchsize"])));
 		if (paramList.containsElementNamed("n.proc")) params.setNbThreads(as<int>(paramList["n.proc"]));
+		if (paramList.containsElementNamed("parallel")) params.setParallelization(as<std::string>(paramList["parallel"]));
+		if (paramList.containsElementNamed("shard.size")) params.setShardSize(as<size_t>(paramList["shard.size"]));
+		if (paramList.containsElementNamed("persistent")) params.setPersistent(as<bool>(paramList["persistent"]));
+		if (paramList.containsElementNamed("gibbs.steps")) params.setGibbsSteps(boost::numeric_cast<unsigned int>(as<int>(paramList["gibbs.steps"])));
+		if (paramList.containsElementNamed("mean.field")) params.setMeanFieldLastStep(as<bool>(paramList["mean.field"]));
+		if (paramList.containsElementNamed("nesterov")) params.setNesterov(as<bool>(paramList["nesterov"]));
+		if (paramList.containsElementNamed("optimizer")) params.setOptimizer(as<std::string>(paramList["optimizer"]));
+		if (paramList.containsElementNamed("beta1")) params.setBeta1(as<double>(paramList["beta1"]));
+		if (paramList.containsElementNamed("beta2")) params.setBeta2(as<double>(paramList["beta2"]));
+		if (paramList.containsElementNamed("seed")) params.setSeed(static_cast<uint32_t>(as<int>(paramList["seed"])));
+		if (paramList.containsElementNamed("sampling")) params.setSampling(as<std::string>(paramList["sampling"]));
+		if (paramList.containsElementNamed("prefetch")) params.setPrefetch(as<bool>(paramList["prefetch"]));
 		params.ensureValidity();
 		return params;
 	}
@@ -245,6 +497,17 @@ namespace Rcpp {
 		if (paramList.containsElementNamed("n.proc")) params.setNbThreads(as<int>(paramList["n.proc"]));
 		if (paramList.containsElementNamed("miniters")) params.setMinIters(as<unsigned int>(paramList["miniters"]));
 		if (paramList.containsElementNamed("maxiters")) params.setMaxIters(as<unsigned int>(paramList["maxiters"]));
+		if (paramList.containsElementNamed("parallel")) params.setParallelization(as<std::string>(paramList["parallel"]));
+		if (paramList.containsElementNamed("seed")) params.setSeed(static_cast<uint32_t>(as<int>(paramList["seed"])));
+		if (paramList.containsElementNamed("optimizer")) params.setOptimizer(as<std::string>(paramList["optimizer"]));
+		if (paramList.containsElementNamed("learning.rate")) params.setLearningRate(as<double>(paramList["learning.rate"]));
+		if (paramList.containsElementNamed("schedule")) params.setSchedule(as<std::string>(paramList["schedule"]));
+		if (paramList.containsElementNamed("decay")) params.setLearningRateDecay(as<double>(paramList["decay"]));
+		if (paramList.containsElementNamed("momentum")) params.setMomentum(as<double>(paramList["momentum"]));
+		if (paramList.containsElementNamed("beta1")) params.setBeta1(as<double>(paramList["beta1"]));
+		if (paramList.containsElementNamed("beta2")) params.setBeta2(as<double>(paramList["beta2"]));
+		if (paramList.containsElementNamed("sampling")) params.setSampling(as<std::string>(paramList["sampling"]));
+		if (paramList.containsElementNamed("prefetch")) params.setPrefetch(as<bool>(paramList["prefetch"]));
 
 		if (paramList.containsElementNamed("optim.control")) {
 			params.setCgMinParams(as<CgMinParams>(paramList["optim.control"]));
@@ -258,7 +521,7 @@ namespace Rcpp {
 		CgMinParams params;
 		
 		if (paramList.containsElementNamed("type")) params.setAlgorithmType(as<int>(paramList["type"]));
-		if (paramList.containsElementNamed("trace")) params.setAlgorithmType(as<int>(paramList["trace"]));
+		if (paramList.containsElementNamed("trace")) params.setTrace(as<int>(paramList["trace"]));
 		if (paramList.containsElementNamed("maxit")) params.setMaxCgIters(as<unsigned int>(paramList["maxit"]));
 		if (paramList.containsElementNamed("steplength")) params.setStepLength(as<double>(paramList["steplength"]));
 		if (paramList.containsElementNamed("stepredn")) params.setSteredn(as<double>(paramList["stepredn"]));
@@ -267,6 +530,9 @@ namespace Rcpp {
 		if (paramList.containsElementNamed("abstol")) params.setAbstol(as<double>(paramList["abstol"]));
 		if (paramList.containsElementNamed("intol")) params.setIntol(as<double>(paramList["intol"]));
 		if (paramList.containsElementNamed("setstep")) params.setSetstep(as<double>(paramList["setstep"]));
+		if (paramList.containsElementNamed("method")) params.setMethod(as<string>(paramList["method"]));
+		if (paramList.containsElementNamed("lmm")) params.setLmm(as<unsigned int>(paramList["lmm"]));
+		if (paramList.containsElementNamed("curvtol")) params.setCurvtol(as<double>(paramList["curvtol"]));
 
 		return params;
 	}
@@ -293,19 +559,28 @@ namespace Rcpp {
 
 		if (aDiagList.containsElementNamed("data") && !Rf_isNull(aDiagList["data"])) {
 			const Eigen::Map<Eigen::MatrixXd> aTestData(as<Eigen::Map<Eigen::MatrixXd>>(aDiagList["data"]));
-			ptr->setData(aTestData.transpose());
+			ptr->setData(aTestData.transpose().cast<Scalar>());
 		}
 		if (aDiagList.containsElementNamed("f")) {
 			const Rcpp::Function myRFunction = as<Rcpp::Function>(aDiagList["f"]);
 			ptr->setFunction(
-				[myRFunction](const DeepBeliefNet& aDBN, const Eigen::MatrixXd& batch, const Eigen::MatrixXd& data, const unsigned int iter, const size_t batchsize, const unsigned int maxiters) -> void {
-					myRFunction(aDBN, batch.transpose(), data.transpose(), iter, batchsize, maxiters);
+				[myRFunction](const DeepBeliefNet& aDBN, const MatrixXs& batch, const MatrixXs& data, const unsigned int iter, const size_t batchsize, const unsigned int maxiters) -> void {
+					myRFunction(aDBN, Eigen::MatrixXd(batch.transpose().cast<double>()), Eigen::MatrixXd(data.transpose().cast<double>()), iter, batchsize, maxiters);
 				}
 			);
 		}
 		return ptr;
 	}
 	
+	// MappedDataset
+	template <> unique_ptr<MappedDataset> as(SEXP aDataset) {
+		const List aDatasetList(as<List>(aDataset));
+		return unique_ptr<MappedDataset>(new MappedDataset(as<string>(aDatasetList["file"]),
+			boost::numeric_cast<Eigen_size_type>(as<double>(aDatasetList["ncol"])), boost::numeric_cast<Eigen_size_type>(as<double>(aDatasetList["nrow"])),
+			MappedDataset::ElementTypeFromString(as<string>(aDatasetList["type"])), !as<bool>(aDatasetList["byrow"]),
+			as<double>(aDatasetList["scale"]), boost::numeric_cast<size_t>(as<double>(aDatasetList["offset"]))));
+	}
+	
 	// PretrainProgress
 	template <> unique_ptr<PretrainProgress> as(SEXP aDiag) {
 		const List aDiagList(as<List>(aDiag));
@@ -328,13 +603,13 @@ namespace Rcpp {
 
 		if (aDiagList.containsElementNamed("data") && !Rf_isNull(aDiagList["data"])) {
 			const Eigen::Map<Eigen::MatrixXd> aTestData(as<Eigen::Map<Eigen::MatrixXd>>(aDiagList["data"]));
-			ptr->setData(aTestData.transpose());
+			ptr->setData(aTestData.transpose().cast<Scalar>());
 		}
 		if (aDiagList.containsElementNamed("f")) {
 			const Rcpp::Function myRFunction = as<Rcpp::Function>(aDiagList["f"]);
 			ptr->setFunction(
-				[myRFunction](const RBM& anRBM, const Eigen::MatrixXd& batch, const Eigen::MatrixXd& data, const unsigned int iter, const size_t batchsize, const unsigned int maxiters, const size_t layer) -> void {
-					myRFunction(anRBM, batch.transpose(), data.transpose(), iter, batchsize, maxiters, layer + 1);
+				[myRFunction](const RBM& anRBM, const MatrixXs& batch, const MatrixXs& data, const unsigned int iter, const size_t batchsize, const unsigned int maxiters, const size_t layer) -> void {
+					myRFunction(anRBM, Eigen::MatrixXd(batch.transpose().cast<double>()), Eigen::MatrixXd(data.transpose().cast<double>()), iter, batchsize, maxiters, layer + 1);
 				}
 			);
 		}
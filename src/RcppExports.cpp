@@ -42,27 +42,219 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// predictRbmSparseCpp
+Eigen::MatrixXd predictRbmSparseCpp(const DeepLearning::RBM& anRBM, const Eigen::MappedSparseMatrix<double>& aDataMatrix);
+RcppExport SEXP _DeepLearning_predictRbmSparseCpp(SEXP anRBMSEXP, SEXP aDataMatrixSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const DeepLearning::RBM& >::type anRBM(anRBMSEXP);
+    Rcpp::traits::input_parameter< const Eigen::MappedSparseMatrix<double>& >::type aDataMatrix(aDataMatrixSEXP);
+    rcpp_result_gen = Rcpp::wrap(predictRbmSparseCpp(anRBM, aDataMatrix));
+    return rcpp_result_gen;
+END_RCPP
+}
+// predictDbnSparseCpp
+Eigen::MatrixXd predictDbnSparseCpp(const DeepLearning::DeepBeliefNet& aDBN, const Eigen::MappedSparseMatrix<double>& aDataMatrix);
+RcppExport SEXP _DeepLearning_predictDbnSparseCpp(SEXP aDBNSEXP, SEXP aDataMatrixSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const DeepLearning::DeepBeliefNet& >::type aDBN(aDBNSEXP);
+    Rcpp::traits::input_parameter< const Eigen::MappedSparseMatrix<double>& >::type aDataMatrix(aDataMatrixSEXP);
+    rcpp_result_gen = Rcpp::wrap(predictDbnSparseCpp(aDBN, aDataMatrix));
+    return rcpp_result_gen;
+END_RCPP
+}
+// compactDbnCpp
+DeepLearning::CompactDeepBeliefNet compactDbnCpp(const DeepLearning::DeepBeliefNet& aDBN, const std::string& aFormat);
+RcppExport SEXP _DeepLearning_compactDbnCpp(SEXP aDBNSEXP, SEXP aFormatSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const DeepLearning::DeepBeliefNet& >::type aDBN(aDBNSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type aFormat(aFormatSEXP);
+    rcpp_result_gen = Rcpp::wrap(compactDbnCpp(aDBN, aFormat));
+    return rcpp_result_gen;
+END_RCPP
+}
+// predictCompactDbnCpp
+Eigen::MatrixXd predictCompactDbnCpp(const DeepLearning::CompactDeepBeliefNet& aDBN, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix);
+RcppExport SEXP _DeepLearning_predictCompactDbnCpp(SEXP aDBNSEXP, SEXP aDataMatrixSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const DeepLearning::CompactDeepBeliefNet& >::type aDBN(aDBNSEXP);
+    Rcpp::traits::input_parameter< const Eigen::Map<Eigen::MatrixXd>& >::type aDataMatrix(aDataMatrixSEXP);
+    rcpp_result_gen = Rcpp::wrap(predictCompactDbnCpp(aDBN, aDataMatrix));
+    return rcpp_result_gen;
+END_RCPP
+}
+// reconstructCompactDbnCpp
+Eigen::MatrixXd reconstructCompactDbnCpp(const DeepLearning::CompactDeepBeliefNet& aDBN, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix);
+RcppExport SEXP _DeepLearning_reconstructCompactDbnCpp(SEXP aDBNSEXP, SEXP aDataMatrixSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const DeepLearning::CompactDeepBeliefNet& >::type aDBN(aDBNSEXP);
+    Rcpp::traits::input_parameter< const Eigen::Map<Eigen::MatrixXd>& >::type aDataMatrix(aDataMatrixSEXP);
+    rcpp_result_gen = Rcpp::wrap(reconstructCompactDbnCpp(aDBN, aDataMatrix));
+    return rcpp_result_gen;
+END_RCPP
+}
+// pruneDbnCpp
+DeepLearning::PrunedDeepBeliefNet pruneDbnCpp(const DeepLearning::DeepBeliefNet& aDBN, double aThreshold, double aMinSparsity);
+RcppExport SEXP _DeepLearning_pruneDbnCpp(SEXP aDBNSEXP, SEXP aThresholdSEXP, SEXP aMinSparsitySEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const DeepLearning::DeepBeliefNet& >::type aDBN(aDBNSEXP);
+    Rcpp::traits::input_parameter< double >::type aThreshold(aThresholdSEXP);
+    Rcpp::traits::input_parameter< double >::type aMinSparsity(aMinSparsitySEXP);
+    rcpp_result_gen = Rcpp::wrap(pruneDbnCpp(aDBN, aThreshold, aMinSparsity));
+    return rcpp_result_gen;
+END_RCPP
+}
+// predictPrunedDbnCpp
+Eigen::MatrixXd predictPrunedDbnCpp(const DeepLearning::PrunedDeepBeliefNet& aDBN, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix);
+RcppExport SEXP _DeepLearning_predictPrunedDbnCpp(SEXP aDBNSEXP, SEXP aDataMatrixSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const DeepLearning::PrunedDeepBeliefNet& >::type aDBN(aDBNSEXP);
+    Rcpp::traits::input_parameter< const Eigen::Map<Eigen::MatrixXd>& >::type aDataMatrix(aDataMatrixSEXP);
+    rcpp_result_gen = Rcpp::wrap(predictPrunedDbnCpp(aDBN, aDataMatrix));
+    return rcpp_result_gen;
+END_RCPP
+}
+// reconstructPrunedDbnCpp
+Eigen::MatrixXd reconstructPrunedDbnCpp(const DeepLearning::PrunedDeepBeliefNet& aDBN, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix);
+RcppExport SEXP _DeepLearning_reconstructPrunedDbnCpp(SEXP aDBNSEXP, SEXP aDataMatrixSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const DeepLearning::PrunedDeepBeliefNet& >::type aDBN(aDBNSEXP);
+    Rcpp::traits::input_parameter< const Eigen::Map<Eigen::MatrixXd>& >::type aDataMatrix(aDataMatrixSEXP);
+    rcpp_result_gen = Rcpp::wrap(reconstructPrunedDbnCpp(aDBN, aDataMatrix));
+    return rcpp_result_gen;
+END_RCPP
+}
+// quantizeDbnCpp
+DeepLearning::QuantizedDeepBeliefNet quantizeDbnCpp(const DeepLearning::DeepBeliefNet& aDBN, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix);
+RcppExport SEXP _DeepLearning_quantizeDbnCpp(SEXP aDBNSEXP, SEXP aDataMatrixSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const DeepLearning::DeepBeliefNet& >::type aDBN(aDBNSEXP);
+    Rcpp::traits::input_parameter< const Eigen::Map<Eigen::MatrixXd>& >::type aDataMatrix(aDataMatrixSEXP);
+    rcpp_result_gen = Rcpp::wrap(quantizeDbnCpp(aDBN, aDataMatrix));
+    return rcpp_result_gen;
+END_RCPP
+}
+// predictQuantizedDbnCpp
+Eigen::MatrixXd predictQuantizedDbnCpp(const DeepLearning::QuantizedDeepBeliefNet& aDBN, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix);
+RcppExport SEXP _DeepLearning_predictQuantizedDbnCpp(SEXP aDBNSEXP, SEXP aDataMatrixSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const DeepLearning::QuantizedDeepBeliefNet& >::type aDBN(aDBNSEXP);
+    Rcpp::traits::input_parameter< const Eigen::Map<Eigen::MatrixXd>& >::type aDataMatrix(aDataMatrixSEXP);
+    rcpp_result_gen = Rcpp::wrap(predictQuantizedDbnCpp(aDBN, aDataMatrix));
+    return rcpp_result_gen;
+END_RCPP
+}
+// reconstructQuantizedDbnCpp
+Eigen::MatrixXd reconstructQuantizedDbnCpp(const DeepLearning::QuantizedDeepBeliefNet& aDBN, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix);
+RcppExport SEXP _DeepLearning_reconstructQuantizedDbnCpp(SEXP aDBNSEXP, SEXP aDataMatrixSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const DeepLearning::QuantizedDeepBeliefNet& >::type aDBN(aDBNSEXP);
+    Rcpp::traits::input_parameter< const Eigen::Map<Eigen::MatrixXd>& >::type aDataMatrix(aDataMatrixSEXP);
+    rcpp_result_gen = Rcpp::wrap(reconstructQuantizedDbnCpp(aDBN, aDataMatrix));
+    return rcpp_result_gen;
+END_RCPP
+}
+// writeDbnCpp
+void writeDbnCpp(const DeepLearning::DeepBeliefNet& aDBN, const std::string& aFile);
+RcppExport SEXP _DeepLearning_writeDbnCpp(SEXP aDBNSEXP, SEXP aFileSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const DeepLearning::DeepBeliefNet& >::type aDBN(aDBNSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type aFile(aFileSEXP);
+    writeDbnCpp(aDBN, aFile);
+    return R_NilValue;
+END_RCPP
+}
+// readDbnCpp
+DeepLearning::DeepBeliefNet readDbnCpp(const std::string& aFile);
+RcppExport SEXP _DeepLearning_readDbnCpp(SEXP aFileSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::string& >::type aFile(aFileSEXP);
+    rcpp_result_gen = Rcpp::wrap(readDbnCpp(aFile));
+    return rcpp_result_gen;
+END_RCPP
+}
+// mapDbnCpp
+Rcpp::List mapDbnCpp(const std::string& aFile);
+RcppExport SEXP _DeepLearning_mapDbnCpp(SEXP aFileSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::string& >::type aFile(aFileSEXP);
+    rcpp_result_gen = Rcpp::wrap(mapDbnCpp(aFile));
+    return rcpp_result_gen;
+END_RCPP
+}
+// predictMappedDbnCpp
+Eigen::MatrixXd predictMappedDbnCpp(const Rcpp::List& aModel, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix);
+RcppExport SEXP _DeepLearning_predictMappedDbnCpp(SEXP aModelSEXP, SEXP aDataMatrixSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const Rcpp::List& >::type aModel(aModelSEXP);
+    Rcpp::traits::input_parameter< const Eigen::Map<Eigen::MatrixXd>& >::type aDataMatrix(aDataMatrixSEXP);
+    rcpp_result_gen = Rcpp::wrap(predictMappedDbnCpp(aModel, aDataMatrix));
+    return rcpp_result_gen;
+END_RCPP
+}
+// reconstructMappedDbnCpp
+Eigen::MatrixXd reconstructMappedDbnCpp(const Rcpp::List& aModel, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix);
+RcppExport SEXP _DeepLearning_reconstructMappedDbnCpp(SEXP aModelSEXP, SEXP aDataMatrixSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const Rcpp::List& >::type aModel(aModelSEXP);
+    Rcpp::traits::input_parameter< const Eigen::Map<Eigen::MatrixXd>& >::type aDataMatrix(aDataMatrixSEXP);
+    rcpp_result_gen = Rcpp::wrap(reconstructMappedDbnCpp(aModel, aDataMatrix));
+    return rcpp_result_gen;
+END_RCPP
+}
 // sampleRbmCpp
-Eigen::MatrixXd sampleRbmCpp(const DeepLearning::RBM& anRBM, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix);
-RcppExport SEXP _DeepLearning_sampleRbmCpp(SEXP anRBMSEXP, SEXP aDataMatrixSEXP) {
+Eigen::MatrixXd sampleRbmCpp(const DeepLearning::RBM& anRBM, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix, int seed);
+RcppExport SEXP _DeepLearning_sampleRbmCpp(SEXP anRBMSEXP, SEXP aDataMatrixSEXP, SEXP seedSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< const DeepLearning::RBM& >::type anRBM(anRBMSEXP);
     Rcpp::traits::input_parameter< const Eigen::Map<Eigen::MatrixXd>& >::type aDataMatrix(aDataMatrixSEXP);
-    rcpp_result_gen = Rcpp::wrap(sampleRbmCpp(anRBM, aDataMatrix));
+    Rcpp::traits::input_parameter< int >::type seed(seedSEXP);
+    rcpp_result_gen = Rcpp::wrap(sampleRbmCpp(anRBM, aDataMatrix, seed));
     return rcpp_result_gen;
 END_RCPP
 }
 // sampleDbnCpp
-Eigen::MatrixXd sampleDbnCpp(const DeepLearning::DeepBeliefNet& aDBN, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix);
-RcppExport SEXP _DeepLearning_sampleDbnCpp(SEXP aDBNSEXP, SEXP aDataMatrixSEXP) {
+Eigen::MatrixXd sampleDbnCpp(const DeepLearning::DeepBeliefNet& aDBN, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix, int seed);
+RcppExport SEXP _DeepLearning_sampleDbnCpp(SEXP aDBNSEXP, SEXP aDataMatrixSEXP, SEXP seedSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< const DeepLearning::DeepBeliefNet& >::type aDBN(aDBNSEXP);
     Rcpp::traits::input_parameter< const Eigen::Map<Eigen::MatrixXd>& >::type aDataMatrix(aDataMatrixSEXP);
-    rcpp_result_gen = Rcpp::wrap(sampleDbnCpp(aDBN, aDataMatrix));
+    Rcpp::traits::input_parameter< int >::type seed(seedSEXP);
+    rcpp_result_gen = Rcpp::wrap(sampleDbnCpp(aDBN, aDataMatrix, seed));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -91,12 +283,12 @@ BEGIN_RCPP
 END_RCPP
 }
 // pretrainRbmCpp
-DeepLearning::RBM pretrainRbmCpp(DeepLearning::RBM& anRBM, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix, const DeepLearning::PretrainParameters& params, const std::unique_ptr<DeepLearning::PretrainProgress>& diag, const DeepLearning::ContinueFunction& cont);
+DeepLearning::RBM pretrainRbmCpp(const DeepLearning::RBM& anRBM, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix, const DeepLearning::PretrainParameters& params, const std::unique_ptr<DeepLearning::PretrainProgress>& diag, const DeepLearning::ContinueFunction& cont);
 RcppExport SEXP _DeepLearning_pretrainRbmCpp(SEXP anRBMSEXP, SEXP aDataMatrixSEXP, SEXP paramsSEXP, SEXP diagSEXP, SEXP contSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< DeepLearning::RBM& >::type anRBM(anRBMSEXP);
+    Rcpp::traits::input_parameter< const DeepLearning::RBM& >::type anRBM(anRBMSEXP);
     Rcpp::traits::input_parameter< const Eigen::Map<Eigen::MatrixXd>& >::type aDataMatrix(aDataMatrixSEXP);
     Rcpp::traits::input_parameter< const DeepLearning::PretrainParameters& >::type params(paramsSEXP);
     Rcpp::traits::input_parameter< const std::unique_ptr<DeepLearning::PretrainProgress>& >::type diag(diagSEXP);
@@ -106,12 +298,12 @@ BEGIN_RCPP
 END_RCPP
 }
 // pretrainDbnCpp
-DeepLearning::DeepBeliefNet pretrainDbnCpp(DeepLearning::DeepBeliefNet& aDBN, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix, const std::vector<DeepLearning::PretrainParameters>& params, const std::unique_ptr<DeepLearning::PretrainProgress>& diag, DeepLearning::ContinueFunction& cont, const Rcpp::IntegerVector& aSkip);
+DeepLearning::DeepBeliefNet pretrainDbnCpp(const DeepLearning::DeepBeliefNet& aDBN, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix, const std::vector<DeepLearning::PretrainParameters>& params, const std::unique_ptr<DeepLearning::PretrainProgress>& diag, DeepLearning::ContinueFunction& cont, const Rcpp::IntegerVector& aSkip);
 RcppExport SEXP _DeepLearning_pretrainDbnCpp(SEXP aDBNSEXP, SEXP aDataMatrixSEXP, SEXP paramsSEXP, SEXP diagSEXP, SEXP contSEXP, SEXP aSkipSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< DeepLearning::DeepBeliefNet& >::type aDBN(aDBNSEXP);
+    Rcpp::traits::input_parameter< const DeepLearning::DeepBeliefNet& >::type aDBN(aDBNSEXP);
     Rcpp::traits::input_parameter< const Eigen::Map<Eigen::MatrixXd>& >::type aDataMatrix(aDataMatrixSEXP);
     Rcpp::traits::input_parameter< const std::vector<DeepLearning::PretrainParameters>& >::type params(paramsSEXP);
     Rcpp::traits::input_parameter< const std::unique_ptr<DeepLearning::PretrainProgress>& >::type diag(diagSEXP);
@@ -121,13 +313,75 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// pretrainRbmMappedCpp
+DeepLearning::RBM pretrainRbmMappedCpp(const DeepLearning::RBM& anRBM, const std::unique_ptr<DeepLearning::MappedDataset>& aDataset, const DeepLearning::PretrainParameters& params, const std::unique_ptr<DeepLearning::PretrainProgress>& diag, const DeepLearning::ContinueFunction& cont);
+RcppExport SEXP _DeepLearning_pretrainRbmMappedCpp(SEXP anRBMSEXP, SEXP aDatasetSEXP, SEXP paramsSEXP, SEXP diagSEXP, SEXP contSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const DeepLearning::RBM& >::type anRBM(anRBMSEXP);
+    Rcpp::traits::input_parameter< const std::unique_ptr<DeepLearning::MappedDataset>& >::type aDataset(aDatasetSEXP);
+    Rcpp::traits::input_parameter< const DeepLearning::PretrainParameters& >::type params(paramsSEXP);
+    Rcpp::traits::input_parameter< const std::unique_ptr<DeepLearning::PretrainProgress>& >::type diag(diagSEXP);
+    Rcpp::traits::input_parameter< const DeepLearning::ContinueFunction& >::type cont(contSEXP);
+    rcpp_result_gen = Rcpp::wrap(pretrainRbmMappedCpp(anRBM, aDataset, params, diag, cont));
+    return rcpp_result_gen;
+END_RCPP
+}
+// pretrainDbnMappedCpp
+DeepLearning::DeepBeliefNet pretrainDbnMappedCpp(const DeepLearning::DeepBeliefNet& aDBN, const std::unique_ptr<DeepLearning::MappedDataset>& aDataset, const std::vector<DeepLearning::PretrainParameters>& params, const std::unique_ptr<DeepLearning::PretrainProgress>& diag, DeepLearning::ContinueFunction& cont, const Rcpp::IntegerVector& aSkip);
+RcppExport SEXP _DeepLearning_pretrainDbnMappedCpp(SEXP aDBNSEXP, SEXP aDatasetSEXP, SEXP paramsSEXP, SEXP diagSEXP, SEXP contSEXP, SEXP aSkipSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const DeepLearning::DeepBeliefNet& >::type aDBN(aDBNSEXP);
+    Rcpp::traits::input_parameter< const std::unique_ptr<DeepLearning::MappedDataset>& >::type aDataset(aDatasetSEXP);
+    Rcpp::traits::input_parameter< const std::vector<DeepLearning::PretrainParameters>& >::type params(paramsSEXP);
+    Rcpp::traits::input_parameter< const std::unique_ptr<DeepLearning::PretrainProgress>& >::type diag(diagSEXP);
+    Rcpp::traits::input_parameter< DeepLearning::ContinueFunction& >::type cont(contSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::IntegerVector& >::type aSkip(aSkipSEXP);
+    rcpp_result_gen = Rcpp::wrap(pretrainDbnMappedCpp(aDBN, aDataset, params, diag, cont, aSkip));
+    return rcpp_result_gen;
+END_RCPP
+}
+// pretrainRbmSparseCpp
+DeepLearning::RBM pretrainRbmSparseCpp(const DeepLearning::RBM& anRBM, const Eigen::MappedSparseMatrix<double>& aDataMatrix, const DeepLearning::PretrainParameters& params, const std::unique_ptr<DeepLearning::PretrainProgress>& diag, const DeepLearning::ContinueFunction& cont);
+RcppExport SEXP _DeepLearning_pretrainRbmSparseCpp(SEXP anRBMSEXP, SEXP aDataMatrixSEXP, SEXP paramsSEXP, SEXP diagSEXP, SEXP contSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const DeepLearning::RBM& >::type anRBM(anRBMSEXP);
+    Rcpp::traits::input_parameter< const Eigen::MappedSparseMatrix<double>& >::type aDataMatrix(aDataMatrixSEXP);
+    Rcpp::traits::input_parameter< const DeepLearning::PretrainParameters& >::type params(paramsSEXP);
+    Rcpp::traits::input_parameter< const std::unique_ptr<DeepLearning::PretrainProgress>& >::type diag(diagSEXP);
+    Rcpp::traits::input_parameter< const DeepLearning::ContinueFunction& >::type cont(contSEXP);
+    rcpp_result_gen = Rcpp::wrap(pretrainRbmSparseCpp(anRBM, aDataMatrix, params, diag, cont));
+    return rcpp_result_gen;
+END_RCPP
+}
+// pretrainDbnSparseCpp
+DeepLearning::DeepBeliefNet pretrainDbnSparseCpp(const DeepLearning::DeepBeliefNet& aDBN, const Eigen::MappedSparseMatrix<double>& aDataMatrix, const std::vector<DeepLearning::PretrainParameters>& params, const std::unique_ptr<DeepLearning::PretrainProgress>& diag, DeepLearning::ContinueFunction& cont, const Rcpp::IntegerVector& aSkip);
+RcppExport SEXP _DeepLearning_pretrainDbnSparseCpp(SEXP aDBNSEXP, SEXP aDataMatrixSEXP, SEXP paramsSEXP, SEXP diagSEXP, SEXP contSEXP, SEXP aSkipSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const DeepLearning::DeepBeliefNet& >::type aDBN(aDBNSEXP);
+    Rcpp::traits::input_parameter< const Eigen::MappedSparseMatrix<double>& >::type aDataMatrix(aDataMatrixSEXP);
+    Rcpp::traits::input_parameter< const std::vector<DeepLearning::PretrainParameters>& >::type params(paramsSEXP);
+    Rcpp::traits::input_parameter< const std::unique_ptr<DeepLearning::PretrainProgress>& >::type diag(diagSEXP);
+    Rcpp::traits::input_parameter< DeepLearning::ContinueFunction& >::type cont(contSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::IntegerVector& >::type aSkip(aSkipSEXP);
+    rcpp_result_gen = Rcpp::wrap(pretrainDbnSparseCpp(aDBN, aDataMatrix, params, diag, cont, aSkip));
+    return rcpp_result_gen;
+END_RCPP
+}
 // trainDbnCpp
-DeepLearning::DeepBeliefNet trainDbnCpp(DeepLearning::DeepBeliefNet& aDBN, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix, const DeepLearning::TrainParameters& trainParams, const std::unique_ptr<DeepLearning::TrainProgress>& diag, const DeepLearning::ContinueFunction& cont);
+DeepLearning::DeepBeliefNet trainDbnCpp(const DeepLearning::DeepBeliefNet& aDBN, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix, const DeepLearning::TrainParameters& trainParams, const std::unique_ptr<DeepLearning::TrainProgress>& diag, const DeepLearning::ContinueFunction& cont);
 RcppExport SEXP _DeepLearning_trainDbnCpp(SEXP aDBNSEXP, SEXP aDataMatrixSEXP, SEXP trainParamsSEXP, SEXP diagSEXP, SEXP contSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< DeepLearning::DeepBeliefNet& >::type aDBN(aDBNSEXP);
+    Rcpp::traits::input_parameter< const DeepLearning::DeepBeliefNet& >::type aDBN(aDBNSEXP);
     Rcpp::traits::input_parameter< const Eigen::Map<Eigen::MatrixXd>& >::type aDataMatrix(aDataMatrixSEXP);
     Rcpp::traits::input_parameter< const DeepLearning::TrainParameters& >::type trainParams(trainParamsSEXP);
     Rcpp::traits::input_parameter< const std::unique_ptr<DeepLearning::TrainProgress>& >::type diag(diagSEXP);
@@ -136,6 +390,36 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// trainDbnMappedCpp
+DeepLearning::DeepBeliefNet trainDbnMappedCpp(const DeepLearning::DeepBeliefNet& aDBN, const std::unique_ptr<DeepLearning::MappedDataset>& aDataset, const DeepLearning::TrainParameters& trainParams, const std::unique_ptr<DeepLearning::TrainProgress>& diag, const DeepLearning::ContinueFunction& cont);
+RcppExport SEXP _DeepLearning_trainDbnMappedCpp(SEXP aDBNSEXP, SEXP aDatasetSEXP, SEXP trainParamsSEXP, SEXP diagSEXP, SEXP contSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const DeepLearning::DeepBeliefNet& >::type aDBN(aDBNSEXP);
+    Rcpp::traits::input_parameter< const std::unique_ptr<DeepLearning::MappedDataset>& >::type aDataset(aDatasetSEXP);
+    Rcpp::traits::input_parameter< const DeepLearning::TrainParameters& >::type trainParams(trainParamsSEXP);
+    Rcpp::traits::input_parameter< const std::unique_ptr<DeepLearning::TrainProgress>& >::type diag(diagSEXP);
+    Rcpp::traits::input_parameter< const DeepLearning::ContinueFunction& >::type cont(contSEXP);
+    rcpp_result_gen = Rcpp::wrap(trainDbnMappedCpp(aDBN, aDataset, trainParams, diag, cont));
+    return rcpp_result_gen;
+END_RCPP
+}
+// trainDbnSparseCpp
+DeepLearning::DeepBeliefNet trainDbnSparseCpp(const DeepLearning::DeepBeliefNet& aDBN, const Eigen::MappedSparseMatrix<double>& aDataMatrix, const DeepLearning::TrainParameters& trainParams, const std::unique_ptr<DeepLearning::TrainProgress>& diag, const DeepLearning::ContinueFunction& cont);
+RcppExport SEXP _DeepLearning_trainDbnSparseCpp(SEXP aDBNSEXP, SEXP aDataMatrixSEXP, SEXP trainParamsSEXP, SEXP diagSEXP, SEXP contSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const DeepLearning::DeepBeliefNet& >::type aDBN(aDBNSEXP);
+    Rcpp::traits::input_parameter< const Eigen::MappedSparseMatrix<double>& >::type aDataMatrix(aDataMatrixSEXP);
+    Rcpp::traits::input_parameter< const DeepLearning::TrainParameters& >::type trainParams(trainParamsSEXP);
+    Rcpp::traits::input_parameter< const std::unique_ptr<DeepLearning::TrainProgress>& >::type diag(diagSEXP);
+    Rcpp::traits::input_parameter< const DeepLearning::ContinueFunction& >::type cont(contSEXP);
+    rcpp_result_gen = Rcpp::wrap(trainDbnSparseCpp(aDBN, aDataMatrix, trainParams, diag, cont));
+    return rcpp_result_gen;
+END_RCPP
+}
 // reverseRbmCpp
 DeepLearning::RBM reverseRbmCpp(DeepLearning::RBM& anRBM);
 RcppExport SEXP _DeepLearning_reverseRbmCpp(SEXP anRBMSEXP) {
@@ -231,7 +515,7 @@ BEGIN_RCPP
 END_RCPP
 }
 // extractRbmWCpp
-DeepLearning::MatrixXdMap extractRbmWCpp(const DeepLearning::RBM& anRBM);
+Eigen::MatrixXd extractRbmWCpp(const DeepLearning::RBM& anRBM);
 RcppExport SEXP _DeepLearning_extractRbmWCpp(SEXP anRBMSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
@@ -264,41 +548,51 @@ BEGIN_RCPP
 END_RCPP
 }
 // setRbmWCpp
-DeepLearning::RBM& setRbmWCpp(DeepLearning::RBM& anRBM, const Eigen::Map<Eigen::MatrixXd>& aNewW);
+DeepLearning::RBM setRbmWCpp(const DeepLearning::RBM& anRBM, const Eigen::Map<Eigen::MatrixXd>& aNewW);
 RcppExport SEXP _DeepLearning_setRbmWCpp(SEXP anRBMSEXP, SEXP aNewWSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< DeepLearning::RBM& >::type anRBM(anRBMSEXP);
+    Rcpp::traits::input_parameter< const DeepLearning::RBM& >::type anRBM(anRBMSEXP);
     Rcpp::traits::input_parameter< const Eigen::Map<Eigen::MatrixXd>& >::type aNewW(aNewWSEXP);
     rcpp_result_gen = Rcpp::wrap(setRbmWCpp(anRBM, aNewW));
     return rcpp_result_gen;
 END_RCPP
 }
 // setRbmCCpp
-DeepLearning::RBM& setRbmCCpp(DeepLearning::RBM& anRBM, const DeepLearning::ArrayX1d& aNewC);
+DeepLearning::RBM setRbmCCpp(const DeepLearning::RBM& anRBM, const DeepLearning::ArrayX1d& aNewC);
 RcppExport SEXP _DeepLearning_setRbmCCpp(SEXP anRBMSEXP, SEXP aNewCSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< DeepLearning::RBM& >::type anRBM(anRBMSEXP);
+    Rcpp::traits::input_parameter< const DeepLearning::RBM& >::type anRBM(anRBMSEXP);
     Rcpp::traits::input_parameter< const DeepLearning::ArrayX1d& >::type aNewC(aNewCSEXP);
     rcpp_result_gen = Rcpp::wrap(setRbmCCpp(anRBM, aNewC));
     return rcpp_result_gen;
 END_RCPP
 }
 // setRbmBCpp
-DeepLearning::RBM& setRbmBCpp(DeepLearning::RBM& anRBM, const DeepLearning::ArrayX1d& aNewB);
+DeepLearning::RBM setRbmBCpp(const DeepLearning::RBM& anRBM, const DeepLearning::ArrayX1d& aNewB);
 RcppExport SEXP _DeepLearning_setRbmBCpp(SEXP anRBMSEXP, SEXP aNewBSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< DeepLearning::RBM& >::type anRBM(anRBMSEXP);
+    Rcpp::traits::input_parameter< const DeepLearning::RBM& >::type anRBM(anRBMSEXP);
     Rcpp::traits::input_parameter< const DeepLearning::ArrayX1d& >::type aNewB(aNewBSEXP);
     rcpp_result_gen = Rcpp::wrap(setRbmBCpp(anRBM, aNewB));
     return rcpp_result_gen;
 END_RCPP
 }
+// scalarTypeCpp
+std::string scalarTypeCpp();
+RcppExport SEXP _DeepLearning_scalarTypeCpp() {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    rcpp_result_gen = Rcpp::wrap(scalarTypeCpp());
+    return rcpp_result_gen;
+END_RCPP
+}
 // detectCores
 unsigned int detectCores();
 RcppExport SEXP _DeepLearning_detectCores() {
@@ -310,14 +604,15 @@ BEGIN_RCPP
 END_RCPP
 }
 // unit_DbnGradient
-SEXP unit_DbnGradient(SEXP& aDBN, SEXP& aDataMatrix);
-RcppExport SEXP _DeepLearning_unit_DbnGradient(SEXP aDBNSEXP, SEXP aDataMatrixSEXP) {
+SEXP unit_DbnGradient(SEXP& aDBN, SEXP& aDataMatrix, int aNProc);
+RcppExport SEXP _DeepLearning_unit_DbnGradient(SEXP aDBNSEXP, SEXP aDataMatrixSEXP, SEXP aNProcSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< SEXP& >::type aDBN(aDBNSEXP);
     Rcpp::traits::input_parameter< SEXP& >::type aDataMatrix(aDataMatrixSEXP);
-    rcpp_result_gen = Rcpp::wrap(unit_DbnGradient(aDBN, aDataMatrix));
+    Rcpp::traits::input_parameter< int >::type aNProc(aNProcSEXP);
+    rcpp_result_gen = Rcpp::wrap(unit_DbnGradient(aDBN, aDataMatrix, aNProc));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -326,13 +621,35 @@ static const R_CallMethodDef CallEntries[] = {
     {"_DeepLearning_unrollDbnCpp", (DL_FUNC) &_DeepLearning_unrollDbnCpp, 1},
     {"_DeepLearning_predictRbmCpp", (DL_FUNC) &_DeepLearning_predictRbmCpp, 2},
     {"_DeepLearning_predictDbnCpp", (DL_FUNC) &_DeepLearning_predictDbnCpp, 2},
-    {"_DeepLearning_sampleRbmCpp", (DL_FUNC) &_DeepLearning_sampleRbmCpp, 2},
-    {"_DeepLearning_sampleDbnCpp", (DL_FUNC) &_DeepLearning_sampleDbnCpp, 2},
+    {"_DeepLearning_predictRbmSparseCpp", (DL_FUNC) &_DeepLearning_predictRbmSparseCpp, 2},
+    {"_DeepLearning_predictDbnSparseCpp", (DL_FUNC) &_DeepLearning_predictDbnSparseCpp, 2},
+    {"_DeepLearning_compactDbnCpp", (DL_FUNC) &_DeepLearning_compactDbnCpp, 2},
+    {"_DeepLearning_predictCompactDbnCpp", (DL_FUNC) &_DeepLearning_predictCompactDbnCpp, 2},
+    {"_DeepLearning_reconstructCompactDbnCpp", (DL_FUNC) &_DeepLearning_reconstructCompactDbnCpp, 2},
+    {"_DeepLearning_pruneDbnCpp", (DL_FUNC) &_DeepLearning_pruneDbnCpp, 3},
+    {"_DeepLearning_predictPrunedDbnCpp", (DL_FUNC) &_DeepLearning_predictPrunedDbnCpp, 2},
+    {"_DeepLearning_reconstructPrunedDbnCpp", (DL_FUNC) &_DeepLearning_reconstructPrunedDbnCpp, 2},
+    {"_DeepLearning_quantizeDbnCpp", (DL_FUNC) &_DeepLearning_quantizeDbnCpp, 2},
+    {"_DeepLearning_predictQuantizedDbnCpp", (DL_FUNC) &_DeepLearning_predictQuantizedDbnCpp, 2},
+    {"_DeepLearning_reconstructQuantizedDbnCpp", (DL_FUNC) &_DeepLearning_reconstructQuantizedDbnCpp, 2},
+    {"_DeepLearning_writeDbnCpp", (DL_FUNC) &_DeepLearning_writeDbnCpp, 2},
+    {"_DeepLearning_readDbnCpp", (DL_FUNC) &_DeepLearning_readDbnCpp, 1},
+    {"_DeepLearning_mapDbnCpp", (DL_FUNC) &_DeepLearning_mapDbnCpp, 1},
+    {"_DeepLearning_predictMappedDbnCpp", (DL_FUNC) &_DeepLearning_predictMappedDbnCpp, 2},
+    {"_DeepLearning_reconstructMappedDbnCpp", (DL_FUNC) &_DeepLearning_reconstructMappedDbnCpp, 2},
+    {"_DeepLearning_sampleRbmCpp", (DL_FUNC) &_DeepLearning_sampleRbmCpp, 3},
+    {"_DeepLearning_sampleDbnCpp", (DL_FUNC) &_DeepLearning_sampleDbnCpp, 3},
     {"_DeepLearning_reconstructRbmCpp", (DL_FUNC) &_DeepLearning_reconstructRbmCpp, 2},
     {"_DeepLearning_reconstructDbnCpp", (DL_FUNC) &_DeepLearning_reconstructDbnCpp, 2},
     {"_DeepLearning_pretrainRbmCpp", (DL_FUNC) &_DeepLearning_pretrainRbmCpp, 5},
     {"_DeepLearning_pretrainDbnCpp", (DL_FUNC) &_DeepLearning_pretrainDbnCpp, 6},
+    {"_DeepLearning_pretrainRbmMappedCpp", (DL_FUNC) &_DeepLearning_pretrainRbmMappedCpp, 5},
+    {"_DeepLearning_pretrainDbnMappedCpp", (DL_FUNC) &_DeepLearning_pretrainDbnMappedCpp, 6},
+    {"_DeepLearning_pretrainRbmSparseCpp", (DL_FUNC) &_DeepLearning_pretrainRbmSparseCpp, 5},
+    {"_DeepLearning_pretrainDbnSparseCpp", (DL_FUNC) &_DeepLearning_pretrainDbnSparseCpp, 6},
     {"_DeepLearning_trainDbnCpp", (DL_FUNC) &_DeepLearning_trainDbnCpp, 5},
+    {"_DeepLearning_trainDbnMappedCpp", (DL_FUNC) &_DeepLearning_trainDbnMappedCpp, 5},
+    {"_DeepLearning_trainDbnSparseCpp", (DL_FUNC) &_DeepLearning_trainDbnSparseCpp, 5},
     {"_DeepLearning_reverseRbmCpp", (DL_FUNC) &_DeepLearning_reverseRbmCpp, 1},
     {"_DeepLearning_reverseDbnCpp", (DL_FUNC) &_DeepLearning_reverseDbnCpp, 1},
     {"_DeepLearning_energyRbmCpp", (DL_FUNC) &_DeepLearning_energyRbmCpp, 2},
@@ -347,8 +664,9 @@ static const R_CallMethodDef CallEntries[] = {
     {"_DeepLearning_setRbmWCpp", (DL_FUNC) &_DeepLearning_setRbmWCpp, 2},
     {"_DeepLearning_setRbmCCpp", (DL_FUNC) &_DeepLearning_setRbmCCpp, 2},
     {"_DeepLearning_setRbmBCpp", (DL_FUNC) &_DeepLearning_setRbmBCpp, 2},
+    {"_DeepLearning_scalarTypeCpp", (DL_FUNC) &_DeepLearning_scalarTypeCpp, 0},
     {"_DeepLearning_detectCores", (DL_FUNC) &_DeepLearning_detectCores, 0},
-    {"_DeepLearning_unit_DbnGradient", (DL_FUNC) &_DeepLearning_unit_DbnGradient, 2},
+    {"_DeepLearning_unit_DbnGradient", (DL_FUNC) &_DeepLearning_unit_DbnGradient, 3},
     {NULL, NULL, 0}
 };
 
@@ -5,6 +5,8 @@
 using std::vector;
 #include <memory> // std::unique_ptr
 using std::unique_ptr;
+#include <string>
+#include <utility> // std::move
 
 #include <DeepLearning/Layer.h>
 #include <DeepLearning/RBM.h>
@@ -19,64 +21,267 @@ DeepLearning::DeepBeliefNet unrollDbnCpp(DeepLearning::DeepBeliefNet& aDBN) {
 	return aDBN.unroll();
 }
 
+/* The R data matrices have the samples as rows. The pretrain, train and predict functions use them as such, through samplesAsColumns
+ * or predictSamplesAsRows, without transposing them. They are used in place in double precision; in single precision the conversion
+ * is a plain copy in the same layout.
+ */
+typedef Eigen::Ref<const DeepLearning::MatrixXs> RDataRef;
+
+/** Returns predictions as a MatrixXd, without copy when Scalar is double */
+inline Eigen::MatrixXd toDouble(Eigen::MatrixXd&& predictions) {
+	return std::move(predictions);
+}
+
+inline Eigen::MatrixXd toDouble(Eigen::MatrixXf&& predictions) {
+	return predictions.cast<double>();
+}
+
 /* PREDICT */
 
 // [[Rcpp::export]]
 Eigen::MatrixXd predictRbmCpp(const DeepLearning::RBM& anRBM, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix) {
-	return anRBM.predict(aDataMatrix.transpose()).transpose();
+	const RDataRef data(aDataMatrix.cast<DeepLearning::Scalar>());
+	DeepLearning::MatrixXs predictions;
+	anRBM.predictSamplesAsRows(data, predictions);
+	return toDouble(std::move(predictions));
 }
 
 // [[Rcpp::export]]
 Eigen::MatrixXd predictDbnCpp(const DeepLearning::DeepBeliefNet& aDBN, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix) {
-	return aDBN.predict(aDataMatrix.transpose()).transpose();
+	const RDataRef data(aDataMatrix.cast<DeepLearning::Scalar>());
+	DeepLearning::MatrixXs predictions;
+	aDBN.predictSamplesAsRows(data, predictions);
+	return toDouble(std::move(predictions));
+}
+
+/* The dgCMatrix objects of the Matrix package are compressed sparse columns with the samples as rows: they are transposed to have the samples
+ * as columns, in a pass over their non-zeros only.
+ */
+static DeepLearning::SparseMatrixXs sparseSamplesAsColumns(const Eigen::MappedSparseMatrix<double>& aDataMatrix) {
+	return aDataMatrix.transpose().cast<DeepLearning::Scalar>();
+}
+
+// [[Rcpp::export]]
+Eigen::MatrixXd predictRbmSparseCpp(const DeepLearning::RBM& anRBM, const Eigen::MappedSparseMatrix<double>& aDataMatrix) {
+	return anRBM.predict(sparseSamplesAsColumns(aDataMatrix)).transpose().cast<double>();
+}
+
+// [[Rcpp::export]]
+Eigen::MatrixXd predictDbnSparseCpp(const DeepLearning::DeepBeliefNet& aDBN, const Eigen::MappedSparseMatrix<double>& aDataMatrix) {
+	return aDBN.predict(sparseSamplesAsColumns(aDataMatrix)).transpose().cast<double>();
+}
+
+/* COMPACT */
+
+// [[Rcpp::export]]
+DeepLearning::CompactDeepBeliefNet compactDbnCpp(const DeepLearning::DeepBeliefNet& aDBN, const std::string& aFormat) {
+	return DeepLearning::CompactDeepBeliefNet(aDBN, DeepLearning::CompactDeepBeliefNet::formatFromString(aFormat));
+}
+
+// [[Rcpp::export]]
+Eigen::MatrixXd predictCompactDbnCpp(const DeepLearning::CompactDeepBeliefNet& aDBN, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix) {
+	return aDBN.predict(aDataMatrix.transpose().cast<DeepLearning::Scalar>()).transpose().cast<double>();
+}
+
+// [[Rcpp::export]]
+Eigen::MatrixXd reconstructCompactDbnCpp(const DeepLearning::CompactDeepBeliefNet& aDBN, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix) {
+	return aDBN.reconstruct(aDataMatrix.transpose().cast<DeepLearning::Scalar>()).transpose().cast<double>();
+}
+
+/* PRUNE */
+
+// [[Rcpp::export]]
+DeepLearning::PrunedDeepBeliefNet pruneDbnCpp(const DeepLearning::DeepBeliefNet& aDBN, double aThreshold, double aMinSparsity) {
+	return DeepLearning::PrunedDeepBeliefNet(aDBN, static_cast<DeepLearning::Scalar>(aThreshold), aMinSparsity);
+}
+
+// [[Rcpp::export]]
+Eigen::MatrixXd predictPrunedDbnCpp(const DeepLearning::PrunedDeepBeliefNet& aDBN, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix) {
+	return aDBN.predict(aDataMatrix.transpose().cast<DeepLearning::Scalar>()).transpose().cast<double>();
+}
+
+// [[Rcpp::export]]
+Eigen::MatrixXd reconstructPrunedDbnCpp(const DeepLearning::PrunedDeepBeliefNet& aDBN, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix) {
+	return aDBN.reconstruct(aDataMatrix.transpose().cast<DeepLearning::Scalar>()).transpose().cast<double>();
+}
+
+/* QUANTIZE */
+
+// [[Rcpp::export]]
+DeepLearning::QuantizedDeepBeliefNet quantizeDbnCpp(const DeepLearning::DeepBeliefNet& aDBN, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix) {
+	return DeepLearning::QuantizedDeepBeliefNet(aDBN, aDataMatrix.transpose().cast<DeepLearning::Scalar>());
+}
+
+// [[Rcpp::export]]
+Eigen::MatrixXd predictQuantizedDbnCpp(const DeepLearning::QuantizedDeepBeliefNet& aDBN, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix) {
+	return aDBN.predict(aDataMatrix.transpose().cast<DeepLearning::Scalar>()).transpose().cast<double>();
+}
+
+// [[Rcpp::export]]
+Eigen::MatrixXd reconstructQuantizedDbnCpp(const DeepLearning::QuantizedDeepBeliefNet& aDBN, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix) {
+	return aDBN.reconstruct(aDataMatrix.transpose().cast<DeepLearning::Scalar>()).transpose().cast<double>();
+}
+
+/* MODEL FILES */
+
+// [[Rcpp::export]]
+void writeDbnCpp(const DeepLearning::DeepBeliefNet& aDBN, const std::string& aFile) {
+	DeepLearning::MappedDeepBeliefNet::write(aDBN, aFile);
+}
+
+// [[Rcpp::export]]
+DeepLearning::DeepBeliefNet readDbnCpp(const std::string& aFile) {
+	const DeepLearning::MappedDeepBeliefNet model(aFile);
+	return model.getDeepBeliefNet().clone(); // the mapping is released on return
+}
+
+/** A MappedDeepBeliefNet object keeps the mapping in an external pointer in its pointer.env. The pointer is NULL after the object was
+ * saved and loaded back by R: the file is then mapped again.
+ */
+static const DeepLearning::DeepBeliefNet& mappedDbn(const Rcpp::List& aModel) {
+	Rcpp::Environment env(Rcpp::as<Rcpp::Environment>(aModel["pointer.env"]));
+	Rcpp::XPtr<DeepLearning::MappedDeepBeliefNet> pointer(env.get("pointer"));
+	if (pointer.get() == nullptr) {
+		pointer = Rcpp::XPtr<DeepLearning::MappedDeepBeliefNet>(new DeepLearning::MappedDeepBeliefNet(Rcpp::as<std::string>(aModel["file"])), true);
+		env.assign("pointer", pointer);
+	}
+	return pointer->getDeepBeliefNet();
+}
+
+// [[Rcpp::export]]
+Rcpp::List mapDbnCpp(const std::string& aFile) {
+	Rcpp::XPtr<DeepLearning::MappedDeepBeliefNet> pointer(new DeepLearning::MappedDeepBeliefNet(aFile), true);
+	const DeepLearning::DeepBeliefNet& dbn = pointer->getDeepBeliefNet();
+	Rcpp::Environment env = Rcpp::Environment::namespace_env("DeepLearning").new_child(true);
+	env.assign("pointer", pointer);
+	Rcpp::List layersList;
+	for (const DeepLearning::Layer& layer: dbn.getLayers()) {
+		layersList.push_back(layer);
+	}
+	Rcpp::List model = Rcpp::List::create(
+		Rcpp::Named("file") = aFile,
+		Rcpp::Named("layers") = layersList,
+		Rcpp::Named("pretrained") = dbn.isPretrained(),
+		Rcpp::Named("unrolled") = dbn.isUnrolled(),
+		Rcpp::Named("finetuned") = dbn.isFinetuned(),
+		Rcpp::Named("mapped") = pointer->isMapped(),
+		Rcpp::Named("pointer.env") = env
+	);
+	model.attr("class") = "MappedDeepBeliefNet";
+	return model;
+}
+
+// [[Rcpp::export]]
+Eigen::MatrixXd predictMappedDbnCpp(const Rcpp::List& aModel, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix) {
+	const RDataRef data(aDataMatrix.cast<DeepLearning::Scalar>());
+	DeepLearning::MatrixXs predictions;
+	mappedDbn(aModel).predictSamplesAsRows(data, predictions);
+	return toDouble(std::move(predictions));
+}
+
+// [[Rcpp::export]]
+Eigen::MatrixXd reconstructMappedDbnCpp(const Rcpp::List& aModel, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix) {
+	return mappedDbn(aModel).reconstruct(aDataMatrix.transpose().cast<DeepLearning::Scalar>()).transpose().cast<double>();
 }
 
 /* SAMPLE */
 
 // [[Rcpp::export]]
-Eigen::MatrixXd sampleRbmCpp(const DeepLearning::RBM& anRBM, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix) {
-	return anRBM.sample(aDataMatrix.transpose()).transpose();
+Eigen::MatrixXd sampleRbmCpp(const DeepLearning::RBM& anRBM, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix, int seed) {
+	return anRBM.sample(aDataMatrix.transpose().cast<DeepLearning::Scalar>(), static_cast<uint32_t>(seed)).transpose().cast<double>();
 }
 
 // [[Rcpp::export]]
-Eigen::MatrixXd sampleDbnCpp(const DeepLearning::DeepBeliefNet& aDBN, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix) {
-	return aDBN.sample(aDataMatrix.transpose()).transpose();
+Eigen::MatrixXd sampleDbnCpp(const DeepLearning::DeepBeliefNet& aDBN, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix, int seed) {
+	return aDBN.sample(aDataMatrix.transpose().cast<DeepLearning::Scalar>(), static_cast<uint32_t>(seed)).transpose().cast<double>();
 }
 
 /* RECONSTRUCT */
 
 // [[Rcpp::export]]
 Eigen::MatrixXd reconstructRbmCpp(const DeepLearning::RBM& anRBM, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix) {
-	return anRBM.reconstruct(aDataMatrix.transpose()).transpose();
+	return anRBM.reconstruct(aDataMatrix.transpose().cast<DeepLearning::Scalar>()).transpose().cast<double>();
 }
 
 // [[Rcpp::export]]
 Eigen::MatrixXd reconstructDbnCpp(const DeepLearning::DeepBeliefNet& aDBN, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix) {
-	return aDBN.reconstruct(aDataMatrix.transpose()).transpose();
+	return aDBN.reconstruct(aDataMatrix.transpose().cast<DeepLearning::Scalar>()).transpose().cast<double>();
 }
 
 /* PRETRAIN */
 
 // [[Rcpp::export]]
-DeepLearning::RBM pretrainRbmCpp(DeepLearning::RBM& anRBM, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix, const DeepLearning::PretrainParameters& params, const std::unique_ptr<DeepLearning::PretrainProgress>& diag, const DeepLearning::ContinueFunction& cont) {
-	anRBM.pretrain(aDataMatrix.transpose(), params, *diag, cont);
-	return anRBM;
+DeepLearning::RBM pretrainRbmCpp(const DeepLearning::RBM& anRBM, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix, const DeepLearning::PretrainParameters& params, const std::unique_ptr<DeepLearning::PretrainProgress>& diag, const DeepLearning::ContinueFunction& cont) {
+	DeepLearning::RBM pretrainedRBM = writableCopy(anRBM);
+	const RDataRef data(aDataMatrix.cast<DeepLearning::Scalar>());
+	pretrainedRBM.pretrain(DeepLearning::samplesAsColumns(data), params, *diag, cont);
+	return pretrainedRBM;
 }
 
 // [[Rcpp::export]]
-DeepLearning::DeepBeliefNet pretrainDbnCpp(DeepLearning::DeepBeliefNet& aDBN, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix, const std::vector<DeepLearning::PretrainParameters>& params, const std::unique_ptr<DeepLearning::PretrainProgress>& diag, DeepLearning::ContinueFunction& cont, const Rcpp::IntegerVector& aSkip) {
+DeepLearning::DeepBeliefNet pretrainDbnCpp(const DeepLearning::DeepBeliefNet& aDBN, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix, const std::vector<DeepLearning::PretrainParameters>& params, const std::unique_ptr<DeepLearning::PretrainProgress>& diag, DeepLearning::ContinueFunction& cont, const Rcpp::IntegerVector& aSkip) {
 	const std::vector<size_t> skip(Rcpp::as<std::vector<size_t>>(aSkip));
-	aDBN.pretrain(aDataMatrix.transpose(), params, *diag, cont, skip);
-	return aDBN;
+	DeepLearning::DeepBeliefNet pretrainedDBN = writableCopy(aDBN);
+	const RDataRef data(aDataMatrix.cast<DeepLearning::Scalar>());
+	pretrainedDBN.pretrain(DeepLearning::samplesAsColumns(data), params, *diag, cont, skip);
+	return pretrainedDBN;
 }
 
+/* The MappedData objects only describe a file: the batches are read from it as they are drawn, without R holding the data */
+
+// [[Rcpp::export]]
+DeepLearning::RBM pretrainRbmMappedCpp(const DeepLearning::RBM& anRBM, const std::unique_ptr<DeepLearning::MappedDataset>& aDataset, const DeepLearning::PretrainParameters& params, const std::unique_ptr<DeepLearning::PretrainProgress>& diag, const DeepLearning::ContinueFunction& cont) {
+	DeepLearning::RBM pretrainedRBM = writableCopy(anRBM);
+	pretrainedRBM.pretrain(DeepLearning::BatchSource(*aDataset), params, *diag, cont);
+	return pretrainedRBM;
+}
+
+// [[Rcpp::export]]
+DeepLearning::DeepBeliefNet pretrainDbnMappedCpp(const DeepLearning::DeepBeliefNet& aDBN, const std::unique_ptr<DeepLearning::MappedDataset>& aDataset, const std::vector<DeepLearning::PretrainParameters>& params, const std::unique_ptr<DeepLearning::PretrainProgress>& diag, DeepLearning::ContinueFunction& cont, const Rcpp::IntegerVector& aSkip) {
+	const std::vector<size_t> skip(Rcpp::as<std::vector<size_t>>(aSkip));
+	DeepLearning::DeepBeliefNet pretrainedDBN = writableCopy(aDBN);
+	pretrainedDBN.pretrain(*aDataset, params, *diag, cont, skip);
+	return pretrainedDBN;
+}
+
+
+// [[Rcpp::export]]
+DeepLearning::RBM pretrainRbmSparseCpp(const DeepLearning::RBM& anRBM, const Eigen::MappedSparseMatrix<double>& aDataMatrix, const DeepLearning::PretrainParameters& params, const std::unique_ptr<DeepLearning::PretrainProgress>& diag, const DeepLearning::ContinueFunction& cont) {
+	DeepLearning::RBM pretrainedRBM = writableCopy(anRBM);
+	pretrainedRBM.pretrain(sparseSamplesAsColumns(aDataMatrix), params, *diag, cont);
+	return pretrainedRBM;
+}
+
+// [[Rcpp::export]]
+DeepLearning::DeepBeliefNet pretrainDbnSparseCpp(const DeepLearning::DeepBeliefNet& aDBN, const Eigen::MappedSparseMatrix<double>& aDataMatrix, const std::vector<DeepLearning::PretrainParameters>& params, const std::unique_ptr<DeepLearning::PretrainProgress>& diag, DeepLearning::ContinueFunction& cont, const Rcpp::IntegerVector& aSkip) {
+	const std::vector<size_t> skip(Rcpp::as<std::vector<size_t>>(aSkip));
+	DeepLearning::DeepBeliefNet pretrainedDBN = writableCopy(aDBN);
+	pretrainedDBN.pretrain(sparseSamplesAsColumns(aDataMatrix), params, *diag, cont, skip);
+	return pretrainedDBN;
+}
 
 /* TRAIN */
 
 // [[Rcpp::export]]
-DeepLearning::DeepBeliefNet trainDbnCpp(DeepLearning::DeepBeliefNet& aDBN, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix, const DeepLearning::TrainParameters& trainParams, const std::unique_ptr<DeepLearning::TrainProgress>& diag, const DeepLearning::ContinueFunction& cont) {
-	aDBN.train(aDataMatrix.transpose(), trainParams, *diag, cont);
-	return aDBN;
+DeepLearning::DeepBeliefNet trainDbnCpp(const DeepLearning::DeepBeliefNet& aDBN, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix, const DeepLearning::TrainParameters& trainParams, const std::unique_ptr<DeepLearning::TrainProgress>& diag, const DeepLearning::ContinueFunction& cont) {
+	DeepLearning::DeepBeliefNet trainedDBN = writableCopy(aDBN);
+	const RDataRef data(aDataMatrix.cast<DeepLearning::Scalar>());
+	trainedDBN.train(DeepLearning::samplesAsColumns(data), trainParams, *diag, cont);
+	return trainedDBN;
+}
+
+// [[Rcpp::export]]
+DeepLearning::DeepBeliefNet trainDbnMappedCpp(const DeepLearning::DeepBeliefNet& aDBN, const std::unique_ptr<DeepLearning::MappedDataset>& aDataset, const DeepLearning::TrainParameters& trainParams, const std::unique_ptr<DeepLearning::TrainProgress>& diag, const DeepLearning::ContinueFunction& cont) {
+	DeepLearning::DeepBeliefNet trainedDBN = writableCopy(aDBN);
+	trainedDBN.train(DeepLearning::BatchSource(*aDataset), trainParams, *diag, cont);
+	return trainedDBN;
+}
+
+// [[Rcpp::export]]
+DeepLearning::DeepBeliefNet trainDbnSparseCpp(const DeepLearning::DeepBeliefNet& aDBN, const Eigen::MappedSparseMatrix<double>& aDataMatrix, const DeepLearning::TrainParameters& trainParams, const std::unique_ptr<DeepLearning::TrainProgress>& diag, const DeepLearning::ContinueFunction& cont) {
+	DeepLearning::DeepBeliefNet trainedDBN = writableCopy(aDBN);
+	trainedDBN.train(sparseSamplesAsColumns(aDataMatrix), trainParams, *diag, cont);
+	return trainedDBN;
 }
 
 /* REVERSE */
@@ -95,68 +300,81 @@ DeepLearning::DeepBeliefNet reverseDbnCpp(DeepLearning::DeepBeliefNet& aDBN) {
 
 // [[Rcpp::export]]
 DeepLearning::ArrayX1d energyRbmCpp(const DeepLearning::RBM& anRBM, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix) {
-	return anRBM.energy(aDataMatrix.transpose());
+	return anRBM.energy(aDataMatrix.transpose().cast<DeepLearning::Scalar>()).cast<double>();
 }
 
 // [[Rcpp::export]]
 DeepLearning::ArrayX1d energyDbnCpp(const DeepLearning::DeepBeliefNet& aDBN, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix) {
-	return aDBN.energy(aDataMatrix.transpose());
+	return aDBN.energy(aDataMatrix.transpose().cast<DeepLearning::Scalar>()).cast<double>();
 }
 
 /* Error */
 
 // [[Rcpp::export]]
 DeepLearning::ArrayX1d errorRbmCpp(const DeepLearning::RBM& anRBM, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix) {
-	return anRBM.error(aDataMatrix.transpose());
+	return anRBM.error(aDataMatrix.transpose().cast<DeepLearning::Scalar>()).cast<double>();
 }
 
 // [[Rcpp::export]]
 DeepLearning::ArrayX1d errorDbnCpp(const DeepLearning::DeepBeliefNet& aDBN, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix) {
-	return aDBN.error(aDataMatrix.transpose());
+	return aDBN.error(aDataMatrix.transpose().cast<DeepLearning::Scalar>()).cast<double>();
 }
 
 /* ErrorSum */
 
 // [[Rcpp::export]]
 double errorSumRbmCpp(const DeepLearning::RBM& anRBM, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix) {
-	return anRBM.errorSum(aDataMatrix.transpose());
+	return anRBM.errorSum(aDataMatrix.transpose().cast<DeepLearning::Scalar>());
 }
 
 // [[Rcpp::export]]
 double errorSumDbnCpp(const DeepLearning::DeepBeliefNet& aDBN, const Eigen::Map<Eigen::MatrixXd>& aDataMatrix) {
-	return aDBN.errorSum(aDataMatrix.transpose());
+	return aDBN.errorSum(aDataMatrix.transpose().cast<DeepLearning::Scalar>());
 }
 
 /* Extract weights */
 
 // [[Rcpp::export]]
-DeepLearning::MatrixXdMap extractRbmWCpp(const DeepLearning::RBM& anRBM) {
-	return anRBM.getW();
+Eigen::MatrixXd extractRbmWCpp(const DeepLearning::RBM& anRBM) {
+	return anRBM.getW().cast<double>();
 }
 
 // [[Rcpp::export]]
 DeepLearning::ArrayX1d extractRbmCCpp(const DeepLearning::RBM& anRBM) {
-	return anRBM.getC();
+	return anRBM.getC().cast<double>();
 }
 
 // [[Rcpp::export]]
 DeepLearning::ArrayX1d extractRbmBCpp(const DeepLearning::RBM& anRBM) {
-	return anRBM.getB();
+	return anRBM.getB().cast<double>();
 }
 
 /* Set weights */
 
 // [[Rcpp::export]]
-DeepLearning::RBM& setRbmWCpp(DeepLearning::RBM& anRBM, const Eigen::Map<Eigen::MatrixXd>& aNewW) {
-	return anRBM.setW(aNewW);
+DeepLearning::RBM setRbmWCpp(const DeepLearning::RBM& anRBM, const Eigen::Map<Eigen::MatrixXd>& aNewW) {
+	DeepLearning::RBM newRBM = writableCopy(anRBM);
+	newRBM.setW(DeepLearning::MatrixXs(aNewW.cast<DeepLearning::Scalar>()));
+	return newRBM;
 }
 
 // [[Rcpp::export]]
-DeepLearning::RBM& setRbmCCpp(DeepLearning::RBM& anRBM, const DeepLearning::ArrayX1d& aNewC) {
-	return anRBM.setC(aNewC);
+DeepLearning::RBM setRbmCCpp(const DeepLearning::RBM& anRBM, const DeepLearning::ArrayX1d& aNewC) {
+	DeepLearning::RBM newRBM = writableCopy(anRBM);
+	newRBM.setC(DeepLearning::ArrayX1s(aNewC.cast<DeepLearning::Scalar>()));
+	return newRBM;
 }
 
 // [[Rcpp::export]]
-DeepLearning::RBM& setRbmBCpp(DeepLearning::RBM& anRBM, const DeepLearning::ArrayX1d& aNewB) {
-	return anRBM.setB(aNewB);
+DeepLearning::RBM setRbmBCpp(const DeepLearning::RBM& anRBM, const DeepLearning::ArrayX1d& aNewB) {
+	DeepLearning::RBM newRBM = writableCopy(anRBM);
+	newRBM.setB(DeepLearning::ArrayX1s(aNewB.cast<DeepLearning::Scalar>()));
+	return newRBM;
+}
+
+/* Build */
+
+// [[Rcpp::export]]
+std::string scalarTypeCpp() {
+	return sizeof(DeepLearning::Scalar) == sizeof(float) ? "float" : "double";
 }
@@ -5,27 +5,66 @@
 
 #include <vector>
 #include <memory> // std::unique_ptr
+#include <string>
 
 #include <DeepLearning.h>
 
 
+/** RBMs and DBNs coming from R map the memory of their R weights vector (see mapWeights in RcppConversions.cpp).
+ * The functions that modify them in place must work on writableCopy(object) so that the R object is left untouched (copy-on-write):
+ * a clone if the weights belong to R, the object itself (sharing its already private data) otherwise.
+ */
+template <class T> T writableCopy(const T& anObject) {
+	return *anObject.getData().getCleanUp() ? anObject : anObject.clone();
+}
+
 /* UNROLL */
 DeepLearning::DeepBeliefNet unrollDbnCpp(DeepLearning::DeepBeliefNet&);
 
 /* PREDICT */
 Eigen::MatrixXd predictRbmCpp(const DeepLearning::RBM&, const Eigen::Map<Eigen::MatrixXd>&);
 Eigen::MatrixXd predictDbnCpp(const DeepLearning::DeepBeliefNet&, const Eigen::Map<Eigen::MatrixXd>&);
+Eigen::MatrixXd predictRbmSparseCpp(const DeepLearning::RBM&, const Eigen::MappedSparseMatrix<double>&);
+Eigen::MatrixXd predictDbnSparseCpp(const DeepLearning::DeepBeliefNet&, const Eigen::MappedSparseMatrix<double>&);
 
 /* RECONSTRUCT */
 Eigen::MatrixXd reconstructRbmCpp(const DeepLearning::RBM&, const Eigen::Map<Eigen::MatrixXd>&);
 Eigen::MatrixXd reconstructDbnCpp(const DeepLearning::DeepBeliefNet&, const Eigen::Map<Eigen::MatrixXd>&);
 
+/* COMPACT */
+DeepLearning::CompactDeepBeliefNet compactDbnCpp(const DeepLearning::DeepBeliefNet&, const std::string&);
+Eigen::MatrixXd predictCompactDbnCpp(const DeepLearning::CompactDeepBeliefNet&, const Eigen::Map<Eigen::MatrixXd>&);
+Eigen::MatrixXd reconstructCompactDbnCpp(const DeepLearning::CompactDeepBeliefNet&, const Eigen::Map<Eigen::MatrixXd>&);
+
+/* PRUNE */
+DeepLearning::PrunedDeepBeliefNet pruneDbnCpp(const DeepLearning::DeepBeliefNet&, double, double);
+Eigen::MatrixXd predictPrunedDbnCpp(const DeepLearning::PrunedDeepBeliefNet&, const Eigen::Map<Eigen::MatrixXd>&);
+Eigen::MatrixXd reconstructPrunedDbnCpp(const DeepLearning::PrunedDeepBeliefNet&, const Eigen::Map<Eigen::MatrixXd>&);
+
+/* QUANTIZE */
+DeepLearning::QuantizedDeepBeliefNet quantizeDbnCpp(const DeepLearning::DeepBeliefNet&, const Eigen::Map<Eigen::MatrixXd>&);
+Eigen::MatrixXd predictQuantizedDbnCpp(const DeepLearning::QuantizedDeepBeliefNet&, const Eigen::Map<Eigen::MatrixXd>&);
+Eigen::MatrixXd reconstructQuantizedDbnCpp(const DeepLearning::QuantizedDeepBeliefNet&, const Eigen::Map<Eigen::MatrixXd>&);
+
+/* MODEL FILES */
+void writeDbnCpp(const DeepLearning::DeepBeliefNet&, const std::string&);
+DeepLearning::DeepBeliefNet readDbnCpp(const std::string&);
+Rcpp::List mapDbnCpp(const std::string&);
+Eigen::MatrixXd predictMappedDbnCpp(const Rcpp::List&, const Eigen::Map<Eigen::MatrixXd>&);
+Eigen::MatrixXd reconstructMappedDbnCpp(const Rcpp::List&, const Eigen::Map<Eigen::MatrixXd>&);
+
 /* PRETRAIN */
-DeepLearning::RBM pretrainRbmCpp(DeepLearning::RBM&, const Eigen::Map<Eigen::MatrixXd>&, const DeepLearning::PretrainParameters&, const std::unique_ptr<DeepLearning::PretrainProgress>&, const DeepLearning::ContinueFunction&);
-DeepLearning::DeepBeliefNet pretrainDbnCpp(DeepLearning::DeepBeliefNet&, const Eigen::Map<Eigen::MatrixXd>&, const std::vector<DeepLearning::PretrainParameters>&, const std::unique_ptr<DeepLearning::PretrainProgress>&, DeepLearning::ContinueFunction&, const Rcpp::IntegerVector&);
+DeepLearning::RBM pretrainRbmCpp(const DeepLearning::RBM&, const Eigen::Map<Eigen::MatrixXd>&, const DeepLearning::PretrainParameters&, const std::unique_ptr<DeepLearning::PretrainProgress>&, const DeepLearning::ContinueFunction&);
+DeepLearning::DeepBeliefNet pretrainDbnCpp(const DeepLearning::DeepBeliefNet&, const Eigen::Map<Eigen::MatrixXd>&, const std::vector<DeepLearning::PretrainParameters>&, const std::unique_ptr<DeepLearning::PretrainProgress>&, DeepLearning::ContinueFunction&, const Rcpp::IntegerVector&);
+DeepLearning::RBM pretrainRbmMappedCpp(const DeepLearning::RBM&, const std::unique_ptr<DeepLearning::MappedDataset>&, const DeepLearning::PretrainParameters&, const std::unique_ptr<DeepLearning::PretrainProgress>&, const DeepLearning::ContinueFunction&);
+DeepLearning::DeepBeliefNet pretrainDbnMappedCpp(const DeepLearning::DeepBeliefNet&, const std::unique_ptr<DeepLearning::MappedDataset>&, const std::vector<DeepLearning::PretrainParameters>&, const std::unique_ptr<DeepLearning::PretrainProgress>&, DeepLearning::ContinueFunction&, const Rcpp::IntegerVector&);
+DeepLearning::RBM pretrainRbmSparseCpp(const DeepLearning::RBM&, const Eigen::MappedSparseMatrix<double>&, const DeepLearning::PretrainParameters&, const std::unique_ptr<DeepLearning::PretrainProgress>&, const DeepLearning::ContinueFunction&);
+DeepLearning::DeepBeliefNet pretrainDbnSparseCpp(const DeepLearning::DeepBeliefNet&, const Eigen::MappedSparseMatrix<double>&, const std::vector<DeepLearning::PretrainParameters>&, const std::unique_ptr<DeepLearning::PretrainProgress>&, DeepLearning::ContinueFunction&, const Rcpp::IntegerVector&);
 
 /* TRAIN */
-DeepLearning::DeepBeliefNet trainDbnCpp(DeepLearning::DeepBeliefNet&, const Eigen::Map<Eigen::MatrixXd>&, const DeepLearning::TrainParameters&, const std::unique_ptr<DeepLearning::TrainProgress>&, const DeepLearning::ContinueFunction&);
+DeepLearning::DeepBeliefNet trainDbnCpp(const DeepLearning::DeepBeliefNet&, const Eigen::Map<Eigen::MatrixXd>&, const DeepLearning::TrainParameters&, const std::unique_ptr<DeepLearning::TrainProgress>&, const DeepLearning::ContinueFunction&);
+DeepLearning::DeepBeliefNet trainDbnMappedCpp(const DeepLearning::DeepBeliefNet&, const std::unique_ptr<DeepLearning::MappedDataset>&, const DeepLearning::TrainParameters&, const std::unique_ptr<DeepLearning::TrainProgress>&, const DeepLearning::ContinueFunction&);
+DeepLearning::DeepBeliefNet trainDbnSparseCpp(const DeepLearning::DeepBeliefNet&, const Eigen::MappedSparseMatrix<double>&, const DeepLearning::TrainParameters&, const std::unique_ptr<DeepLearning::TrainProgress>&, const DeepLearning::ContinueFunction&);
 
 /* REVERSE */
 DeepLearning::RBM reverseRbmCpp(DeepLearning::RBM&);
@@ -42,11 +81,14 @@ double errorSumRbmCpp(const DeepLearning::RBM&, const Eigen::Map<Eigen::MatrixXd
 double errorSumDbnCpp(const DeepLearning::DeepBeliefNet&, const Eigen::Map<Eigen::MatrixXd>&);
 
 /* Extract weights */
-DeepLearning::MatrixXdMap extractRbmWCpp(const DeepLearning::RBM& anRBM);
+Eigen::MatrixXd extractRbmWCpp(const DeepLearning::RBM& anRBM);
 DeepLearning::ArrayX1d extractRbmCCpp(const DeepLearning::RBM& anRBM);
 DeepLearning::ArrayX1d extractRbmBCpp(const DeepLearning::RBM& anRBM);
 
 /* Set weights */
-DeepLearning::RBM& setRbmWCpp(DeepLearning::RBM& anRBM, const Eigen::Map<Eigen::MatrixXd>& aNewW);
-DeepLearning::RBM& setRbmCCpp(DeepLearning::RBM& anRBM, const DeepLearning::ArrayX1d& aNewC);
-DeepLearning::RBM& setRbmBCpp(DeepLearning::RBM& anRBM, const DeepLearning::ArrayX1d& aNewB);
\ No newline at end of file
+DeepLearning::RBM setRbmWCpp(const DeepLearning::RBM& anRBM, const Eigen::Map<Eigen::MatrixXd>& aNewW);
+DeepLearning::RBM setRbmCCpp(const DeepLearning::RBM& anRBM, const DeepLearning::ArrayX1d& aNewC);
+DeepLearning::RBM setRbmBCpp(const DeepLearning::RBM& anRBM, const DeepLearning::ArrayX1d& aNewB);
+
+/* Build */
+std::string scalarTypeCpp();
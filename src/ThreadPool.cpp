@@ -0,0 +1,91 @@
+#include <algorithm> // std::max
+#include <exception> // std::current_exception, std::rethrow_exception
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "ThreadPool.h"
+
+
+namespace DeepLearning {
+	ThreadPool::ThreadPool(int nThreads): workers(), mutex(), workAvailable(), workDone(), currentTask(nullptr),
+		nTasks(0), nextTask(0), pendingTasks(0), generation(0), stopping(false), firstException() {
+		size_t nWorkers = static_cast<size_t>(std::max(nThreads, 1)) - 1;
+		workers.reserve(nWorkers);
+		for (size_t i = 0; i < nWorkers; ++i) {
+			workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+		}
+	}
+	
+	ThreadPool::~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		workAvailable.notify_all();
+		for (std::thread& worker: workers) {
+			worker.join();
+		}
+	}
+	
+	/** Executes tasks of the current parallelFor until there is none left. Must be called with the lock held. */
+	void ThreadPool::runTasks(std::unique_lock<std::mutex>& lock) {
+		while (nextTask < nTasks) {
+			size_t task = nextTask++;
+			const std::function<void(size_t)>& taskFunction = *currentTask;
+			lock.unlock();
+			try {
+				taskFunction(task);
+			} catch (...) {
+				lock.lock();
+				if (!firstException) firstException = std::current_exception();
+				lock.unlock();
+			}
+			lock.lock();
+			if (--pendingTasks == 0) {
+				workDone.notify_all();
+			}
+		}
+	}
+	
+	void ThreadPool::workerLoop() {
+		unsigned long seenGeneration = 0;
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			workAvailable.wait(lock, [this, &seenGeneration]() {return stopping || generation != seenGeneration;});
+			if (stopping) return;
+			seenGeneration = generation;
+			runTasks(lock);
+		}
+	}
+	
+	void ThreadPool::parallelFor(size_t aNTasks, const std::function<void(size_t)>& task) {
+		if (workers.empty() || aNTasks == 1) { // nothing to share: run in the calling thread
+			for (size_t i = 0; i < aNTasks; ++i) {
+				task(i);
+			}
+			return;
+		}
+		
+		std::unique_lock<std::mutex> lock(mutex);
+		currentTask = &task;
+		nTasks = aNTasks;
+		nextTask = 0;
+		pendingTasks = aNTasks;
+		firstException = nullptr;
+		++generation;
+		workAvailable.notify_all();
+		
+		runTasks(lock); // take part in the work
+		workDone.wait(lock, [this]() {return pendingTasks == 0;});
+		currentTask = nullptr;
+		nTasks = 0;
+		nextTask = 0;
+		
+		if (firstException) {
+			std::exception_ptr toRethrow = firstException;
+			firstException = nullptr;
+			std::rethrow_exception(toRethrow);
+		}
+	}
+}
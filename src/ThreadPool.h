@@ -0,0 +1,51 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef> // std::size_t
+#include <exception> // std::exception_ptr
+#include <functional> // std::function
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace DeepLearning {
+	/** A minimal pool of worker threads to run data-parallel loops.
+	 *
+	 * The threads are started once upon construction and wait for work until the pool is destroyed, so that
+	 * parallelFor can be called at every iteration of a training loop without paying for thread creation.
+	 * A pool of size 0 or 1 starts no thread at all and runs everything in the calling thread.
+	 *
+	 * None of the tasks may call back into R (Rcpp::Rcout, Rcpp::checkUserInterrupt, diag functions...): R is single-threaded.
+	 * Copy and assignment are forbidden, the pool owns its threads.
+	 */
+	class ThreadPool {
+		private:
+			std::vector<std::thread> workers;
+			std::mutex mutex;
+			std::condition_variable workAvailable, workDone;
+			const std::function<void(size_t)>* currentTask;
+			size_t nTasks, nextTask, pendingTasks;
+			unsigned long generation; // incremented each time a new parallelFor starts
+			bool stopping;
+			std::exception_ptr firstException;
+			
+			void workerLoop();
+			void runTasks(std::unique_lock<std::mutex>& lock);
+		
+		public:
+			/** Starts nThreads - 1 worker threads: the thread calling parallelFor is the last worker. */
+			explicit ThreadPool(int nThreads);
+			ThreadPool(const ThreadPool&) = delete;
+			ThreadPool& operator=(const ThreadPool&) = delete;
+			~ThreadPool();
+			
+			/** Number of threads that run the tasks, including the calling thread. Always >= 1 */
+			size_t size() const {return workers.size() + 1;}
+			
+			/** Runs task(0) ... task(nTasks - 1) and returns when all of them are done.
+			 * The order in which the tasks are executed is not defined. If some of the tasks throw, the first exception is rethrown here.
+			 */
+			void parallelFor(size_t nTasks, const std::function<void(size_t)>& task);
+	};
+}
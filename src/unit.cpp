@@ -3,20 +3,31 @@
 #include <Rcpp.h>
 #include <RcppEigen.h> 
 
+#include <vector>
+
 #include <DeepLearning/DeepBeliefNet.h>
 #include <RcppConversions.h>
+#include "ThreadPool.h"
 using namespace DeepLearning;
 
 
-SEXP unit_DbnGradient(SEXP& aDBN, SEXP& aDataMatrix);
+SEXP unit_DbnGradient(SEXP& aDBN, SEXP& aDataMatrix, int aNProc);
 
 // [[Rcpp::export]]
-SEXP unit_DbnGradient(SEXP& aDBN, SEXP& aDataMatrix) {
+SEXP unit_DbnGradient(SEXP& aDBN, SEXP& aDataMatrix, int aNProc = 1) {
 	const Eigen::Map<Eigen::MatrixXd> dataAsEigen(Rcpp::as<Eigen::Map<Eigen::MatrixXd>>(aDataMatrix));
 	
 	DeepBeliefNet myDBN = Rcpp::as<DeepBeliefNet>(aDBN);
-	shared_array_ptr<double> df = myDBN.getData().clone();
-	myDBN.getGradient(dataAsEigen.transpose(), df); // Set gradient in df
+	shared_array_ptr<Scalar> df = myDBN.getData().clone();
+	if (aNProc > 1) { // Split the data across aNProc threads
+		ThreadPool pool(aNProc);
+		std::vector<RBM> gradientRBMs;
+		DeepBeliefNet::constructRBMs(gradientRBMs, myDBN.getLayers(), df);
+		myDBN.getGradient(dataAsEigen.transpose().cast<Scalar>(), gradientRBMs, pool);
+	}
+	else {
+		myDBN.getGradient(dataAsEigen.transpose().cast<Scalar>(), df); // Set gradient in df
+	}
 
 	return Rcpp::wrap(df);
 }